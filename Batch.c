@@ -0,0 +1,205 @@
+// Batch checksums for the sha executable: hashes many files concurrently and prints
+// sha256sum/sha512sum compatible lines in input order
+//
+// Three kinds of threads form a pipeline:
+//  - a prefetcher opens the files just ahead of the hash workers and asks the kernel to read them ahead,
+//    so the disk is busy while earlier files are being hashed
+//  - the hash workers take the next file in order, hash it and mark its slot done
+//  - the calling thread prints finished slots in input order as soon as each becomes available
+
+#define _DEFAULT_SOURCE
+#include <fcntl.h>
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "Batch.h"
+
+typedef struct BatchEntry {
+    const char *path;
+    int err;
+    int done;
+    FileDigests digests;
+} BatchEntry;
+
+typedef struct Batch {
+    BatchEntry *entries;
+    size_t count;
+    Mode mode;
+
+    pthread_mutex_t lock;
+    pthread_cond_t completed;   // signalled when an entry is done
+    pthread_cond_t progress;    // signalled when a worker takes a new entry
+    size_t nextToHash;
+} Batch;
+
+static void *prefetchMain(void *arg)
+{
+    Batch *batch = (Batch*)arg;
+    for (size_t i = 0; i < batch->count; ++i)
+    {
+        pthread_mutex_lock(&batch->lock);
+        while (i >= batch->nextToHash + BATCH_PREFETCH_DEPTH)
+            pthread_cond_wait(&batch->progress, &batch->lock);
+        int behind = i < batch->nextToHash;
+        pthread_mutex_unlock(&batch->lock);
+
+        // the workers already opened this one
+        if (behind)
+            continue;
+
+        int fd = open(batch->entries[i].path, O_RDONLY);
+        if (fd < 0)
+            continue;
+        posix_fadvise(fd, 0, BATCH_PREFETCH_BYTES, POSIX_FADV_WILLNEED);
+        close(fd);
+    }
+    return NULL;
+}
+
+static void *hashMain(void *arg)
+{
+    Batch *batch = (Batch*)arg;
+    for (;;)
+    {
+        pthread_mutex_lock(&batch->lock);
+        size_t i = batch->nextToHash;
+        if (i < batch->count)
+            ++batch->nextToHash;
+        pthread_cond_signal(&batch->progress);
+        pthread_mutex_unlock(&batch->lock);
+        if (i >= batch->count)
+            return NULL;
+
+        BatchEntry *entry = &batch->entries[i];
+        int err = hashFile(entry->path, batch->mode, &entry->digests);
+
+        pthread_mutex_lock(&batch->lock);
+        entry->err = err;
+        entry->done = 1;
+        pthread_cond_broadcast(&batch->completed);
+        pthread_mutex_unlock(&batch->lock);
+    }
+}
+
+// Prints one sha*sum style line
+static void printSumLine(const uint8_t *digest, size_t len, const char *path)
+{
+    char hex[2 * SHA512_HASH_SIZE + 1];
+    for (size_t i = 0; i < len; ++i)
+        sprintf(&hex[2 * i], "%02x", digest[i]);
+    printf("%s  %s\n", hex, path);
+}
+
+int batchChecksums(char **paths, size_t count, Mode mode, int numJobs)
+{
+    if (numJobs <= 0)
+    {
+        long cpus = sysconf(_SC_NPROCESSORS_ONLN);
+        numJobs = (cpus > 0) ? (int)cpus : 1;
+    }
+
+    Batch batch;
+    batch.entries = (BatchEntry*) calloc(count ? count : 1, sizeof(BatchEntry));
+    if (batch.entries == NULL)
+    {
+        fprintf(stderr, "Error: Unable to allocate memory for %zu files.\n", count);
+        return 1;
+    }
+    for (size_t i = 0; i < count; ++i)
+        batch.entries[i].path = paths[i];
+    batch.count = count;
+    batch.mode = mode;
+    batch.nextToHash = 0;
+    pthread_mutex_init(&batch.lock, NULL);
+    pthread_cond_init(&batch.completed, NULL);
+    pthread_cond_init(&batch.progress, NULL);
+
+    pthread_t prefetcher;
+    int havePrefetcher = pthread_create(&prefetcher, NULL, prefetchMain, &batch) == 0;
+    pthread_t *workers = (pthread_t*) malloc(numJobs * sizeof(pthread_t));
+    int numWorkers = 0;
+    while (workers != NULL && numWorkers < numJobs && pthread_create(&workers[numWorkers], NULL, hashMain, &batch) == 0)
+        ++numWorkers;
+    // without any worker thread, hash on this thread before printing
+    if (numWorkers == 0)
+        hashMain(&batch);
+
+    int status = 0;
+    for (size_t i = 0; i < count; ++i)
+    {
+        BatchEntry *entry = &batch.entries[i];
+        pthread_mutex_lock(&batch.lock);
+        while (!entry->done)
+            pthread_cond_wait(&batch.completed, &batch.lock);
+        pthread_mutex_unlock(&batch.lock);
+
+        if (entry->err != 0)
+        {
+            fprintf(stderr, "sha: %s: %s\n", entry->path, strerror(entry->err));
+            status = 1;
+            continue;
+        }
+        if (mode & MODE_512)
+            printSumLine(entry->digests.sha512, SHA512_HASH_SIZE, entry->path);
+        if (mode & MODE_256)
+            printSumLine(entry->digests.sha256, SHA256_HASH_SIZE, entry->path);
+    }
+
+    for (int i = 0; i < numWorkers; ++i)
+        pthread_join(workers[i], NULL);
+    if (havePrefetcher)
+        pthread_join(prefetcher, NULL);
+
+    free(workers);
+    pthread_mutex_destroy(&batch.lock);
+    pthread_cond_destroy(&batch.completed);
+    pthread_cond_destroy(&batch.progress);
+    free(batch.entries);
+    return status;
+}
+
+int readPathList(char ***paths, size_t *count)
+{
+    size_t capacity = 0;
+    char *line = NULL;
+    size_t lineCapacity = 0;
+    ssize_t len;
+    int ok = 1;
+
+    *paths = NULL;
+    *count = 0;
+    while ((len = getline(&line, &lineCapacity, stdin)) >= 0)
+    {
+        if (len > 0 && line[len - 1] == '\n')
+            line[--len] = '\0';
+        if (len == 0)
+            continue;
+
+        if (*count == capacity)
+        {
+            capacity = capacity ? capacity * 2 : 1024;
+            char **grown = (char**) realloc(*paths, capacity * sizeof(char*));
+            if (grown == NULL)
+            {
+                ok = 0;
+                break;
+            }
+            *paths = grown;
+        }
+        char *path = strdup(line);
+        if (path == NULL)
+        {
+            ok = 0;
+            break;
+        }
+        (*paths)[(*count)++] = path;
+    }
+    free(line);
+
+    if (!ok)
+        fprintf(stderr, "Error: Unable to allocate memory for %zu files.\n", *count + 1);
+    return ok;
+}
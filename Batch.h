@@ -0,0 +1,27 @@
+// Batch checksums for the sha executable: hashes many files concurrently and prints
+// sha256sum/sha512sum compatible lines in input order
+
+#ifndef __BATCH_H_
+#define __BATCH_H_
+
+#include <stddef.h>
+
+#include "FileHash.h"
+
+// Number of files the prefetcher may run ahead of the hash workers
+#define BATCH_PREFETCH_DEPTH 64
+
+// Bytes of each upcoming file the prefetcher asks the kernel to read ahead
+#define BATCH_PREFETCH_BYTES (4 << 20)
+
+/// Hashes count files with numJobs worker threads (one per CPU if numJobs <= 0) and prints a
+/// "<hex digest>  <path>" line per file and algorithm in mode, in the order of paths, SHA-512 first.
+/// Files that cannot be read are reported on stderr. Returns 0 if every file was hashed, otherwise 1
+int batchChecksums(char **paths, size_t count, Mode mode, int numJobs);
+
+/// Reads newline separated paths from stdin into *paths and their number into *count; the caller frees
+/// *paths along with each path, also on failure. Returns 0, after reporting it on stderr, if memory for
+/// the list runs out
+int readPathList(char ***paths, size_t *count);
+
+#endif //__BATCH_H_
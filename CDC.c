@@ -0,0 +1,344 @@
+// Content-defined chunking with SHA-256 fingerprints, for deduplicating streams
+
+#include <stdlib.h>
+#include <string.h>
+
+#include "CDC.h"
+#include "SHAInternal.h"
+
+// Seed of the Gear table; changing it moves every chunk boundary
+#define GEAR_SEED 0x2545F4914F6CDD1DULL
+
+typedef struct PendingChunk {
+    const uint8_t *data;
+    size_t len;
+    uint64_t offset;
+} PendingChunk;
+
+struct CDCChunker {
+    uint64_t gear[256];
+    uint64_t maskSmall;     // used before avgSize: one bit more than log2(avgSize)
+    uint64_t maskLarge;     // used after avgSize: one bit fewer
+    size_t minSize, avgSize, maxSize;
+    DedupIndex *index;
+    CDCChunkFn emit;
+    void *arg;
+
+    uint64_t fp;            // rolling hash of the current chunk
+    size_t chunkLen;        // bytes of the current chunk seen so far
+    uint64_t offset;        // stream offset of the next chunk to be added to the batch
+    uint8_t *carry;         // start of a chunk that continues in the next piece
+    size_t carryLen;
+
+    PendingChunk batch[CDC_BATCH];
+    size_t batchLen;
+    int indexFailed;        // a chunk of the stream could not be added to the index
+};
+
+typedef struct DedupEntry {
+    uint8_t digest[SHA256_HASH_SIZE];
+    uint64_t value;
+} DedupEntry;
+
+// Open addressing with linear probing. Digests are uniformly distributed, so their first word is the
+// hash, and an all zero digest marks a free slot; the one real all zero digest is kept aside
+struct DedupIndex {
+    DedupEntry *entries;
+    size_t mask;
+    size_t count;
+    int haveZero;
+    uint64_t zeroValue;
+};
+
+static uint64_t splitmix64(uint64_t *state)
+{
+    uint64_t z = (*state += 0x9E3779B97F4A7C15ULL);
+    z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ULL;
+    z = (z ^ (z >> 27)) * 0x94D049BB133111EBULL;
+    return z ^ (z >> 31);
+}
+
+CDCChunker *CDCChunkerCreate(size_t minSize, size_t avgSize, size_t maxSize, DedupIndex *index,
+                             CDCChunkFn emit, void *arg)
+{
+    if (minSize == 0 && avgSize == 0 && maxSize == 0)
+    {
+        minSize = CDC_DEFAULT_MIN_SIZE;
+        avgSize = CDC_DEFAULT_AVG_SIZE;
+        maxSize = CDC_DEFAULT_MAX_SIZE;
+    }
+    if (avgSize < 64 || avgSize > ((size_t)1 << 40) || (avgSize & (avgSize - 1)) != 0 ||
+        minSize == 0 || minSize > avgSize || avgSize > maxSize)
+        return NULL;
+
+    CDCChunker *chunker = (CDCChunker*) calloc(1, sizeof(CDCChunker));
+    if (chunker == NULL)
+        return NULL;
+    chunker->carry = (uint8_t*) malloc(maxSize);
+    if (chunker->carry == NULL)
+    {
+        free(chunker);
+        return NULL;
+    }
+
+    uint64_t state = GEAR_SEED;
+    for (int i = 0; i < 256; ++i)
+        chunker->gear[i] = splitmix64(&state);
+
+    int bits = 0;
+    while (((size_t)1 << bits) < avgSize)
+        ++bits;
+    chunker->maskSmall = ~0ULL << (64 - (bits + 1));
+    chunker->maskLarge = ~0ULL << (64 - (bits - 1));
+    chunker->minSize = minSize;
+    chunker->avgSize = avgSize;
+    chunker->maxSize = maxSize;
+    chunker->index = index;
+    chunker->emit = emit;
+    chunker->arg = arg;
+    return chunker;
+}
+
+void CDCChunkerDestroy(CDCChunker *chunker)
+{
+    if (chunker == NULL)
+        return;
+    free(chunker->carry);
+    free(chunker);
+}
+
+// Fingerprints the pending chunks and reports them
+static void flushBatch(CDCChunker *chunker)
+{
+    if (chunker->batchLen == 0)
+        return;
+
+    const uint8_t *msgs[CDC_BATCH];
+    size_t lens[CDC_BATCH];
+    uint8_t digests[CDC_BATCH][SHA256_HASH_SIZE];
+    for (size_t i = 0; i < chunker->batchLen; ++i)
+    {
+        msgs[i] = chunker->batch[i].data;
+        lens[i] = chunker->batch[i].len;
+    }
+    SHA256HashMany(msgs, lens, chunker->batchLen, digests);
+
+    for (size_t i = 0; i < chunker->batchLen; ++i)
+    {
+        CDCChunk chunk;
+        chunk.offset = chunker->batch[i].offset;
+        chunk.len = chunker->batch[i].len;
+        memcpy(chunk.digest, digests[i], SHA256_HASH_SIZE);
+        chunk.firstOffset = chunk.offset;
+        chunk.duplicate = 0;
+        if (chunker->index != NULL)
+        {
+            int found = DedupIndexInsert(chunker->index, chunk.digest, chunk.offset, &chunk.firstOffset);
+            if (found < 0)
+                chunker->indexFailed = 1;
+            chunk.duplicate = found == 1;
+        }
+        chunker->emit(chunker->arg, &chunk);
+    }
+    chunker->batchLen = 0;
+}
+
+static void addChunk(CDCChunker *chunker, const uint8_t *data, size_t len)
+{
+    PendingChunk *pending = &chunker->batch[chunker->batchLen++];
+    pending->data = data;
+    pending->len = len;
+    pending->offset = chunker->offset;
+    chunker->offset += len;
+    if (chunker->batchLen == CDC_BATCH)
+        flushBatch(chunker);
+}
+
+// Scans data for the end of the current chunk. Returns the number of bytes of data that belong to the
+// chunk and sets *cut if the chunk ends after them; otherwise all of data belongs to it
+static size_t findBoundary(CDCChunker *chunker, const uint8_t *data, size_t len, int *cut)
+{
+    size_t base = chunker->chunkLen;
+    size_t start = (base < chunker->minSize) ? chunker->minSize - base : 0;
+    size_t normalEnd = (base < chunker->avgSize) ? chunker->avgSize - base : 0;
+    size_t end = chunker->maxSize - base;
+    if (start > len)
+        start = len;
+    if (end > len)
+        end = len;
+    if (normalEnd < start)
+        normalEnd = start;
+    if (normalEnd > end)
+        normalEnd = end;
+
+    const uint64_t *gear = chunker->gear;
+    uint64_t fp = chunker->fp;
+    size_t i = start;
+    int found = 0;
+    for (; i < normalEnd && !found; ++i)
+    {
+        fp = (fp << 1) + gear[data[i]];
+        found = (fp & chunker->maskSmall) == 0;
+    }
+    for (; i < end && !found; ++i)
+    {
+        fp = (fp << 1) + gear[data[i]];
+        found = (fp & chunker->maskLarge) == 0;
+    }
+
+    *cut = found || base + i == chunker->maxSize;
+    if (*cut)
+    {
+        chunker->fp = 0;
+        chunker->chunkLen = 0;
+        return i;
+    }
+    chunker->fp = fp;
+    chunker->chunkLen = base + len;
+    return len;
+}
+
+int CDCChunkerUpdate(CDCChunker *chunker, const uint8_t *data, size_t len)
+{
+    while (len > 0)
+    {
+        int cut;
+        size_t n = findBoundary(chunker, data, len, &cut);
+        if (!cut)
+        {
+            // the carry buffer may still back a pending chunk until the batch is flushed
+            flushBatch(chunker);
+            memcpy(&chunker->carry[chunker->carryLen], data, n);
+            chunker->carryLen += n;
+            return !chunker->indexFailed;
+        }
+
+        if (chunker->carryLen > 0)
+        {
+            memcpy(&chunker->carry[chunker->carryLen], data, n);
+            addChunk(chunker, chunker->carry, chunker->carryLen + n);
+            chunker->carryLen = 0;
+        }
+        else
+            addChunk(chunker, data, n);
+        data += n;
+        len -= n;
+    }
+    // pending chunks point into data, which the caller may reuse
+    flushBatch(chunker);
+    return !chunker->indexFailed;
+}
+
+int CDCChunkerFinal(CDCChunker *chunker)
+{
+    if (chunker->carryLen > 0)
+        addChunk(chunker, chunker->carry, chunker->carryLen);
+    flushBatch(chunker);
+    int ok = !chunker->indexFailed;
+    chunker->fp = 0;
+    chunker->chunkLen = 0;
+    chunker->carryLen = 0;
+    chunker->offset = 0;
+    chunker->indexFailed = 0;
+    return ok;
+}
+
+static int isZeroDigest(const uint8_t *digest)
+{
+    uint8_t any = 0;
+    for (int i = 0; i < SHA256_HASH_SIZE; ++i)
+        any |= digest[i];
+    return any == 0;
+}
+
+static DedupEntry *findSlot(DedupEntry *entries, size_t mask, const uint8_t *digest)
+{
+    size_t slot = (size_t)loadBigEndian64(digest) & mask;
+    while (!isZeroDigest(entries[slot].digest) && memcmp(entries[slot].digest, digest, SHA256_HASH_SIZE) != 0)
+        slot = (slot + 1) & mask;
+    return &entries[slot];
+}
+
+static int growIndex(DedupIndex *index)
+{
+    size_t capacity = 2 * (index->mask + 1);
+    DedupEntry *entries = (DedupEntry*) calloc(capacity, sizeof(DedupEntry));
+    if (entries == NULL)
+        return 0;
+    for (size_t i = 0; i <= index->mask; ++i)
+    {
+        if (!isZeroDigest(index->entries[i].digest))
+            *findSlot(entries, capacity - 1, index->entries[i].digest) = index->entries[i];
+    }
+    free(index->entries);
+    index->entries = entries;
+    index->mask = capacity - 1;
+    return 1;
+}
+
+DedupIndex *DedupIndexCreate(size_t expected)
+{
+    size_t capacity = 16;
+    while (capacity < expected + expected / 2)
+        capacity <<= 1;
+
+    DedupIndex *index = (DedupIndex*) calloc(1, sizeof(DedupIndex));
+    if (index == NULL)
+        return NULL;
+    index->entries = (DedupEntry*) calloc(capacity, sizeof(DedupEntry));
+    if (index->entries == NULL)
+    {
+        free(index);
+        return NULL;
+    }
+    index->mask = capacity - 1;
+    return index;
+}
+
+int DedupIndexInsert(DedupIndex *index, const uint8_t digest[SHA256_HASH_SIZE], uint64_t value, uint64_t *firstValue)
+{
+    if (isZeroDigest(digest))
+    {
+        if (index->haveZero)
+        {
+            *firstValue = index->zeroValue;
+            return 1;
+        }
+        index->haveZero = 1;
+        index->zeroValue = value;
+        ++index->count;
+        return 0;
+    }
+
+    DedupEntry *entry = findSlot(index->entries, index->mask, digest);
+    if (!isZeroDigest(entry->digest))
+    {
+        *firstValue = entry->value;
+        return 1;
+    }
+
+    // keep the table at most three quarters full, so probe sequences stay short
+    if (4 * (index->count + 1) > 3 * (index->mask + 1))
+    {
+        if (!growIndex(index))
+            return -1;
+        entry = findSlot(index->entries, index->mask, digest);
+    }
+    memcpy(entry->digest, digest, SHA256_HASH_SIZE);
+    entry->value = value;
+    ++index->count;
+    return 0;
+}
+
+size_t DedupIndexCount(const DedupIndex *index)
+{
+    return index->count;
+}
+
+void DedupIndexDestroy(DedupIndex *index)
+{
+    if (index == NULL)
+        return;
+    free(index->entries);
+    free(index);
+}
@@ -0,0 +1,74 @@
+// Content-defined chunking with SHA-256 fingerprints, for deduplicating streams
+//
+// Chunk boundaries are found with a FastCDC style Gear rolling hash, fp = (fp << 1) + G[byte], whose top
+// bits depend on the last 64 bytes only, so an edit moves the boundaries around it and no others:
+//  - no boundary is looked for in the first minSize bytes of a chunk (cut-point skipping),
+//  - up to avgSize bytes a boundary needs one more zero bit than the average calls for, and after it one
+//    fewer (normalized chunking), which keeps chunk sizes close to avgSize,
+//  - a chunk that reaches maxSize ends there.
+// The chunker scans each piece of input once. Finished chunks are fingerprinted in batches with
+// SHA256HashMany while they are still in cache, straight from the caller's buffer. Only a chunk that
+// spans two pieces is copied, into a single buffer of maxSize bytes.
+
+#ifndef __CDC_H_
+#define __CDC_H_
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "SHA256.h"
+
+#define CDC_DEFAULT_MIN_SIZE (2 << 10)
+#define CDC_DEFAULT_AVG_SIZE (8 << 10)
+#define CDC_DEFAULT_MAX_SIZE (64 << 10)
+
+// Chunks fingerprinted per SHA256HashMany call
+#define CDC_BATCH 16
+
+typedef struct CDCChunker CDCChunker;
+typedef struct DedupIndex DedupIndex;
+
+typedef struct CDCChunk {
+    uint64_t offset;            // position of the chunk in its stream
+    size_t len;
+    uint8_t digest[SHA256_HASH_SIZE];
+    int duplicate;              // the digest was already in the chunker's index
+    uint64_t firstOffset;       // value stored with the digest when it was first indexed, if duplicate
+} CDCChunk;
+
+/// Called with every chunk, in stream order. The chunk's bytes are not passed, as they may no longer be
+/// available by the time the batch holding the chunk has been fingerprinted
+typedef void (*CDCChunkFn)(void *arg, const CDCChunk *chunk);
+
+/// Creates a chunker that reports chunks to emit. avgSize must be a power of two of at least 64 and
+/// 0 < minSize <= avgSize <= maxSize; 0 for all three selects the defaults above. With an index, every
+/// chunk is looked up in it and added with its offset if it is new. Returns NULL for invalid sizes or
+/// if memory cannot be allocated
+CDCChunker *CDCChunkerCreate(size_t minSize, size_t avgSize, size_t maxSize, DedupIndex *index,
+                             CDCChunkFn emit, void *arg);
+
+/// Chunks the next len bytes of the stream. Every chunk that ends within them is reported before returning.
+/// Returns 0 if the index could not grow to hold a chunk of the stream so far; such chunks are reported
+/// as not duplicate, so the duplicates of the stream are then incomplete
+int CDCChunkerUpdate(CDCChunker *chunker, const uint8_t *data, size_t len);
+
+/// Reports the last chunk of the stream and prepares the chunker for a new stream, whose offsets start at 0.
+/// Returns 0 if the index could not grow to hold a chunk of the stream, as CDCChunkerUpdate
+int CDCChunkerFinal(CDCChunker *chunker);
+
+void CDCChunkerDestroy(CDCChunker *chunker);
+
+/// Creates an empty fingerprint index sized for about expected digests; it grows as needed.
+/// Returns NULL if memory cannot be allocated
+DedupIndex *DedupIndexCreate(size_t expected);
+
+/// Adds digest with the given value unless it is already indexed. Returns 1, and the value stored
+/// with it in *firstValue, if it was; 0 if it was added; -1 if the index could not grow
+int DedupIndexInsert(DedupIndex *index, const uint8_t digest[SHA256_HASH_SIZE], uint64_t value, uint64_t *firstValue);
+
+/// Returns the number of distinct digests in the index
+size_t DedupIndexCount(const DedupIndex *index);
+
+void DedupIndexDestroy(DedupIndex *index);
+
+#endif //__CDC_H_
@@ -0,0 +1,81 @@
+// Chunk listing for the sha executable: splits a file at content-defined boundaries and reports duplicates
+
+#include <errno.h>
+#include <stdio.h>
+#include <string.h>
+
+#include "CDC.h"
+#include "Dedup.h"
+#include "FileHash.h"
+
+typedef struct ChunkTotals {
+    unsigned long long chunks;
+    unsigned long long bytes;
+    unsigned long long uniqueChunks;
+    unsigned long long uniqueBytes;
+} ChunkTotals;
+
+static void printChunk(void *arg, const CDCChunk *chunk)
+{
+    ChunkTotals *totals = (ChunkTotals*)arg;
+    char hex[2 * SHA256_HASH_SIZE + 1];
+    for (int i = 0; i < SHA256_HASH_SIZE; ++i)
+        sprintf(&hex[2 * i], "%02x", chunk->digest[i]);
+
+    if (chunk->duplicate)
+        printf("%llu %zu %s dup %llu\n", (unsigned long long)chunk->offset, chunk->len, hex,
+               (unsigned long long)chunk->firstOffset);
+    else
+    {
+        printf("%llu %zu %s\n", (unsigned long long)chunk->offset, chunk->len, hex);
+        ++totals->uniqueChunks;
+        totals->uniqueBytes += chunk->len;
+    }
+    ++totals->chunks;
+    totals->bytes += chunk->len;
+}
+
+static void feedChunker(void *arg, const uint8_t *data, size_t len)
+{
+    CDCChunkerUpdate((CDCChunker*)arg, data, len);
+}
+
+int printChunks(const char *path, size_t avgSize)
+{
+    ChunkTotals totals;
+    memset(&totals, 0, sizeof(totals));
+
+    DedupIndex *index = DedupIndexCreate(0);
+    if (index == NULL)
+    {
+        fprintf(stderr, "Error: Unable to allocate memory for the chunk index.\n");
+        return 1;
+    }
+    CDCChunker *chunker;
+    if (avgSize == 0)
+        chunker = CDCChunkerCreate(0, 0, 0, index, printChunk, &totals);
+    else
+        chunker = CDCChunkerCreate(avgSize / 4 > 0 ? avgSize / 4 : 1, avgSize, avgSize * 8, index, printChunk, &totals);
+    if (chunker == NULL)
+    {
+        fprintf(stderr, "sha: invalid chunk size %zu, must be a power of two of at least 64\n", avgSize);
+        DedupIndexDestroy(index);
+        return 1;
+    }
+
+    int err = readFileChunks(path, feedChunker, chunker);
+    int indexed = 1;
+    if (err == 0)
+        indexed = CDCChunkerFinal(chunker);
+    else
+        fprintf(stderr, "sha: %s: %s\n", path, strerror(err));
+
+    if (!indexed)
+        fprintf(stderr, "Error: Unable to allocate memory for the chunk index; duplicates are incomplete.\n");
+    else if (err == 0)
+        fprintf(stderr, "%llu chunks, %llu bytes; %llu unique chunks, %llu unique bytes\n", totals.chunks,
+                totals.bytes, totals.uniqueChunks, totals.uniqueBytes);
+    CDCChunkerDestroy(chunker);
+    DedupIndexDestroy(index);
+    return (err == 0 && indexed) ? 0 : 1;
+}
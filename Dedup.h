@@ -0,0 +1,14 @@
+// Chunk listing for the sha executable: splits a file at content-defined boundaries and reports duplicates
+
+#ifndef __DEDUP_H_
+#define __DEDUP_H_
+
+#include <stddef.h>
+
+/// Splits the file at path into content-defined chunks averaging avgSize bytes (the CDC.h defaults if 0;
+/// chunks are at least avgSize / 4 and at most avgSize * 8 bytes) and prints "<offset> <length> <sha-256>"
+/// for each, followed by " dup <offset>" when an identical chunk came earlier. A summary of the unique
+/// chunks and bytes goes to stderr. Returns 0 on success, otherwise 1
+int printChunks(const char *path, size_t avgSize);
+
+#endif //__DEDUP_H_
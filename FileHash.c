@@ -0,0 +1,182 @@
+// File input for the sha executable: hashes files through a memory mapping or a bounded read() loop,
+// so memory use does not grow with the file size
+
+#define _DEFAULT_SOURCE
+#include <errno.h>
+#include <fcntl.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "FileHash.h"
+
+// Streaming state of hashFile
+typedef struct FileHashState {
+    Mode mode;
+    SHADualContext ctx;
+} FileHashState;
+
+// Maps a regular, non empty file. Returns NULL if the file cannot be mapped
+static const uint8_t *mapFile(int fd, size_t *len)
+{
+    struct stat st;
+    if (fstat(fd, &st) != 0 || !S_ISREG(st.st_mode) || st.st_size <= 0)
+        return NULL;
+
+    void *map = mmap(NULL, (size_t)st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    if (map == MAP_FAILED)
+        return NULL;
+    *len = (size_t)st.st_size;
+    return (const uint8_t*)map;
+}
+
+int readFileChunks(const char *path, FileChunkFn consume, void *arg)
+{
+    int fd = open(path, O_RDONLY);
+    if (fd < 0)
+        return errno;
+
+    size_t len = 0;
+    const uint8_t *map = mapFile(fd, &len);
+    if (map != NULL)
+    {
+        madvise((void*)map, len, MADV_SEQUENTIAL);
+        for (size_t offset = 0; offset < len; offset += FILE_CHUNK_SIZE)
+        {
+            size_t n = (len - offset < FILE_CHUNK_SIZE) ? len - offset : FILE_CHUNK_SIZE;
+            consume(arg, &map[offset], n);
+            // the pages stay in the page cache; dropping them from the mapping bounds our resident memory
+            madvise((void*)&map[offset], n, MADV_DONTNEED);
+        }
+        munmap((void*)map, len);
+        close(fd);
+        return 0;
+    }
+
+    // pipes, devices and empty or unmappable files go through one fixed size buffer
+    posix_fadvise(fd, 0, 0, POSIX_FADV_SEQUENTIAL);
+    uint8_t *buf = (uint8_t*) malloc(FILE_CHUNK_SIZE);
+    if (buf == NULL)
+    {
+        close(fd);
+        return ENOMEM;
+    }
+
+    int err = 0;
+    for (;;)
+    {
+        ssize_t n = read(fd, buf, FILE_CHUNK_SIZE);
+        if (n < 0)
+        {
+            if (errno == EINTR)
+                continue;
+            err = errno;
+            break;
+        }
+        if (n == 0)
+            break;
+        consume(arg, buf, (size_t)n);
+    }
+
+    free(buf);
+    close(fd);
+    return err;
+}
+
+static void hashChunk(void *arg, const uint8_t *chunk, size_t len)
+{
+    FileHashState *state = (FileHashState*)arg;
+    if (state->mode == MODE_BOTH)
+        SHADualUpdate(&state->ctx, chunk, len);
+    else if (state->mode & MODE_512)
+        SHA512Update(&state->ctx.ctx512, chunk, len);
+    else
+        SHA256Update(&state->ctx.ctx256, chunk, len);
+}
+
+int hashFile(const char *path, Mode mode, FileDigests *out)
+{
+    FileHashState state;
+    state.mode = mode;
+    SHADualInit(&state.ctx);
+
+    int err = readFileChunks(path, hashChunk, &state);
+    if (err != 0)
+        return err;
+
+    if (mode == MODE_BOTH)
+        SHADualFinal(&state.ctx, out->sha512, out->sha256);
+    else if (mode & MODE_512)
+        SHA512Final(&state.ctx.ctx512, out->sha512);
+    else
+        SHA256Final(&state.ctx.ctx256, out->sha256);
+    return 0;
+}
+
+int loadFile(const char *path, FileContents *contents)
+{
+    int fd = open(path, O_RDONLY);
+    if (fd < 0)
+        return errno;
+
+    contents->data = mapFile(fd, &contents->len);
+    contents->mapped = contents->data != NULL;
+    if (contents->mapped)
+    {
+        close(fd);
+        return 0;
+    }
+
+    // not mappable: read everything into a growing buffer
+    uint8_t *buf = NULL;
+    size_t len = 0, capacity = 0;
+    int err = 0;
+    for (;;)
+    {
+        if (len == capacity)
+        {
+            capacity = capacity ? capacity * 2 : FILE_CHUNK_SIZE;
+            uint8_t *grown = (uint8_t*) realloc(buf, capacity);
+            if (grown == NULL)
+            {
+                err = ENOMEM;
+                break;
+            }
+            buf = grown;
+        }
+
+        ssize_t n = read(fd, &buf[len], capacity - len);
+        if (n < 0)
+        {
+            if (errno == EINTR)
+                continue;
+            err = errno;
+            break;
+        }
+        if (n == 0)
+            break;
+        len += (size_t)n;
+    }
+    close(fd);
+
+    if (err != 0)
+    {
+        free(buf);
+        return err;
+    }
+    contents->data = buf;
+    contents->len = len;
+    return 0;
+}
+
+void unloadFile(FileContents *contents)
+{
+    if (contents->mapped)
+        munmap((void*)contents->data, contents->len);
+    else
+        free((void*)contents->data);
+    contents->data = NULL;
+    contents->len = 0;
+}
@@ -0,0 +1,53 @@
+// File input for the sha executable: hashes files through a memory mapping or a bounded read() loop,
+// so memory use does not grow with the file size
+
+#ifndef __FILE_HASH_H_
+#define __FILE_HASH_H_
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "SHA256.h"
+#include "SHA512.h"
+#include "SHADual.h"
+
+// Bytes handed to the hashers at a time, and the size of the read() buffer
+#define FILE_CHUNK_SIZE (1 << 20)
+
+typedef enum Mode
+{
+    MODE_256 = 0x01,
+    MODE_512 = 0x02,
+    MODE_BOTH = (MODE_256 | MODE_512)
+} Mode;
+
+typedef struct FileDigests {
+    uint8_t sha512[SHA512_HASH_SIZE];
+    uint8_t sha256[SHA256_HASH_SIZE];
+} FileDigests;
+
+/// The whole contents of a file, mapped when possible
+typedef struct FileContents {
+    const uint8_t *data;
+    size_t len;
+    int mapped;
+} FileContents;
+
+/// Called with consecutive pieces of a file
+typedef void (*FileChunkFn)(void *arg, const uint8_t *chunk, size_t len);
+
+/// Passes the contents of the file at path to consume, in order and in chunks of at most FILE_CHUNK_SIZE bytes.
+/// Regular files are mapped and read sequentially; other files are read through a fixed size buffer.
+/// Returns 0 on success, otherwise an errno value
+int readFileChunks(const char *path, FileChunkFn consume, void *arg);
+
+/// Hashes the file at path with every algorithm in mode. Returns 0 on success, otherwise an errno value
+int hashFile(const char *path, Mode mode, FileDigests *out);
+
+/// Makes the whole file available at once, for random access. Returns 0 on success, otherwise an errno value
+int loadFile(const char *path, FileContents *contents);
+
+/// Releases the memory of loadFile
+void unloadFile(FileContents *contents);
+
+#endif //__FILE_HASH_H_
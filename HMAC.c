@@ -0,0 +1,153 @@
+// HMAC-SHA256 and HMAC-SHA512 (RFC 2104, FIPS 198-1)
+
+#include <string.h>
+
+#include "HMAC.h"
+#include "SHAInternal.h"
+
+// HashMany batches are split into groups of this many messages, so the inner digests fit on the stack
+#define HMAC_MANY_GROUP 64
+
+void HMACSHA256SetKey(HMACSHA256Key *key, const uint8_t *secret, size_t len)
+{
+    uint8_t block[SHA256_MESSAGE_BLOCK_SIZE];
+    memset(block, 0, sizeof(block));
+    if (len > SHA256_MESSAGE_BLOCK_SIZE)
+        SHA256HashInto(secret, len, block);
+    else if (len > 0)
+        memcpy(block, secret, len);
+
+    for (int i = 0; i < SHA256_MESSAGE_BLOCK_SIZE; ++i)
+        block[i] ^= HMAC_IPAD;
+    SHA256MidstateInit(&key->inner, block, SHA256_MESSAGE_BLOCK_SIZE);
+
+    for (int i = 0; i < SHA256_MESSAGE_BLOCK_SIZE; ++i)
+        block[i] ^= HMAC_IPAD ^ HMAC_OPAD;
+    SHA256MidstateInit(&key->outer, block, SHA256_MESSAGE_BLOCK_SIZE);
+
+    secureWipe(block, sizeof(block));
+}
+
+void HMACSHA512SetKey(HMACSHA512Key *key, const uint8_t *secret, size_t len)
+{
+    uint8_t block[SHA512_MESSAGE_BLOCK_SIZE];
+    memset(block, 0, sizeof(block));
+    if (len > SHA512_MESSAGE_BLOCK_SIZE)
+        SHA512HashInto(secret, len, block);
+    else if (len > 0)
+        memcpy(block, secret, len);
+
+    for (int i = 0; i < SHA512_MESSAGE_BLOCK_SIZE; ++i)
+        block[i] ^= HMAC_IPAD;
+    SHA512MidstateInit(&key->inner, block, SHA512_MESSAGE_BLOCK_SIZE);
+
+    for (int i = 0; i < SHA512_MESSAGE_BLOCK_SIZE; ++i)
+        block[i] ^= HMAC_IPAD ^ HMAC_OPAD;
+    SHA512MidstateInit(&key->outer, block, SHA512_MESSAGE_BLOCK_SIZE);
+
+    secureWipe(block, sizeof(block));
+}
+
+void HMACSHA256ClearKey(HMACSHA256Key *key)
+{
+    secureWipe(key, sizeof(*key));
+}
+
+void HMACSHA512ClearKey(HMACSHA512Key *key)
+{
+    secureWipe(key, sizeof(*key));
+}
+
+void HMACSHA256HashInto(const HMACSHA256Key *key, const uint8_t *msg, size_t len, uint8_t out[SHA256_HASH_SIZE])
+{
+    uint8_t inner[SHA256_HASH_SIZE];
+    SHA256MidstateHashInto(&key->inner, msg, len, inner);
+    SHA256MidstateHashInto(&key->outer, inner, SHA256_HASH_SIZE, out);
+}
+
+void HMACSHA512HashInto(const HMACSHA512Key *key, const uint8_t *msg, size_t len, uint8_t out[SHA512_HASH_SIZE])
+{
+    uint8_t inner[SHA512_HASH_SIZE];
+    SHA512MidstateHashInto(&key->inner, msg, len, inner);
+    SHA512MidstateHashInto(&key->outer, inner, SHA512_HASH_SIZE, out);
+}
+
+void HMACSHA256HashMany(const HMACSHA256Key *key, const uint8_t **msgs, const size_t *lens, size_t n,
+                        uint8_t (*out)[SHA256_HASH_SIZE])
+{
+    uint8_t inner[HMAC_MANY_GROUP][SHA256_HASH_SIZE];
+    const uint8_t *innerPtrs[HMAC_MANY_GROUP];
+    size_t innerLens[HMAC_MANY_GROUP];
+
+    for (size_t first = 0; first < n; first += HMAC_MANY_GROUP)
+    {
+        size_t count = (n - first < HMAC_MANY_GROUP) ? n - first : HMAC_MANY_GROUP;
+        SHA256MidstateHashMany(&key->inner, &msgs[first], &lens[first], count, inner);
+
+        for (size_t i = 0; i < count; ++i)
+        {
+            innerPtrs[i] = inner[i];
+            innerLens[i] = SHA256_HASH_SIZE;
+        }
+        SHA256MidstateHashMany(&key->outer, innerPtrs, innerLens, count, &out[first]);
+    }
+}
+
+void HMACSHA512HashMany(const HMACSHA512Key *key, const uint8_t **msgs, const size_t *lens, size_t n,
+                        uint8_t (*out)[SHA512_HASH_SIZE])
+{
+    uint8_t inner[HMAC_MANY_GROUP][SHA512_HASH_SIZE];
+    const uint8_t *innerPtrs[HMAC_MANY_GROUP];
+    size_t innerLens[HMAC_MANY_GROUP];
+
+    for (size_t first = 0; first < n; first += HMAC_MANY_GROUP)
+    {
+        size_t count = (n - first < HMAC_MANY_GROUP) ? n - first : HMAC_MANY_GROUP;
+        SHA512MidstateHashMany(&key->inner, &msgs[first], &lens[first], count, inner);
+
+        for (size_t i = 0; i < count; ++i)
+        {
+            innerPtrs[i] = inner[i];
+            innerLens[i] = SHA512_HASH_SIZE;
+        }
+        SHA512MidstateHashMany(&key->outer, innerPtrs, innerLens, count, &out[first]);
+    }
+}
+
+void HMACSHA256Init(HMACSHA256Context *ctx, const HMACSHA256Key *key)
+{
+    SHA256InitFromMidstate(&ctx->inner, &key->inner);
+    ctx->outer = key->outer;
+}
+
+void HMACSHA512Init(HMACSHA512Context *ctx, const HMACSHA512Key *key)
+{
+    SHA512InitFromMidstate(&ctx->inner, &key->inner);
+    ctx->outer = key->outer;
+}
+
+void HMACSHA256Update(HMACSHA256Context *ctx, const uint8_t *data, size_t len)
+{
+    SHA256Update(&ctx->inner, data, len);
+}
+
+void HMACSHA512Update(HMACSHA512Context *ctx, const uint8_t *data, size_t len)
+{
+    SHA512Update(&ctx->inner, data, len);
+}
+
+void HMACSHA256Final(HMACSHA256Context *ctx, uint8_t mac[SHA256_HASH_SIZE])
+{
+    uint8_t inner[SHA256_HASH_SIZE];
+    SHA256Final(&ctx->inner, inner);
+    SHA256MidstateHashInto(&ctx->outer, inner, SHA256_HASH_SIZE, mac);
+    secureWipe(ctx, sizeof(*ctx));
+}
+
+void HMACSHA512Final(HMACSHA512Context *ctx, uint8_t mac[SHA512_HASH_SIZE])
+{
+    uint8_t inner[SHA512_HASH_SIZE];
+    SHA512Final(&ctx->inner, inner);
+    SHA512MidstateHashInto(&ctx->outer, inner, SHA512_HASH_SIZE, mac);
+    secureWipe(ctx, sizeof(*ctx));
+}
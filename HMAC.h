@@ -0,0 +1,73 @@
+// HMAC-SHA256 and HMAC-SHA512 (RFC 2104, FIPS 198-1)
+//
+// A key is prepared once: the blocks key ^ ipad and key ^ opad are compressed into two midstates, so every
+// MAC under that key costs only the message blocks plus one block for the outer hash.
+
+#ifndef __HMAC_H_
+#define __HMAC_H_
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "SHA256.h"
+#include "SHA512.h"
+
+#define HMAC_IPAD 0x36
+#define HMAC_OPAD 0x5c
+
+/// A key prepared for HMAC-SHA256: the midstates after the inner and outer padded key blocks
+typedef struct HMACSHA256Key {
+    SHA256Midstate inner;
+    SHA256Midstate outer;
+} HMACSHA256Key;
+
+/// A key prepared for HMAC-SHA512
+typedef struct HMACSHA512Key {
+    SHA512Midstate inner;
+    SHA512Midstate outer;
+} HMACSHA512Key;
+
+/// Streaming state of one HMAC-SHA256 computation
+typedef struct HMACSHA256Context {
+    SHA256Context inner;
+    SHA256Midstate outer;
+} HMACSHA256Context;
+
+/// Streaming state of one HMAC-SHA512 computation
+typedef struct HMACSHA512Context {
+    SHA512Context inner;
+    SHA512Midstate outer;
+} HMACSHA512Context;
+
+/// Prepares a key of len bytes for any number of MACs. Keys longer than one block are hashed first
+void HMACSHA256SetKey(HMACSHA256Key *key, const uint8_t *secret, size_t len);
+void HMACSHA512SetKey(HMACSHA512Key *key, const uint8_t *secret, size_t len);
+
+/// Overwrites the key state, so the secret does not linger in memory once it is no longer needed
+void HMACSHA256ClearKey(HMACSHA256Key *key);
+void HMACSHA512ClearKey(HMACSHA512Key *key);
+
+/// Writes the MAC of the len byte message at msg into out, without allocating any memory
+void HMACSHA256HashInto(const HMACSHA256Key *key, const uint8_t *msg, size_t len, uint8_t out[SHA256_HASH_SIZE]);
+void HMACSHA512HashInto(const HMACSHA512Key *key, const uint8_t *msg, size_t len, uint8_t out[SHA512_HASH_SIZE]);
+
+/// Writes the MAC of msgs[i] into out[i] for n messages under the same key, using the multi-buffer
+/// lanes of SHA256HashMany/SHA512HashMany for both the inner and the outer hashes
+void HMACSHA256HashMany(const HMACSHA256Key *key, const uint8_t **msgs, const size_t *lens, size_t n,
+                        uint8_t (*out)[SHA256_HASH_SIZE]);
+void HMACSHA512HashMany(const HMACSHA512Key *key, const uint8_t **msgs, const size_t *lens, size_t n,
+                        uint8_t (*out)[SHA512_HASH_SIZE]);
+
+/// Prepares ctx to MAC a new message under key; the key may be changed or cleared afterwards
+void HMACSHA256Init(HMACSHA256Context *ctx, const HMACSHA256Key *key);
+void HMACSHA512Init(HMACSHA512Context *ctx, const HMACSHA512Key *key);
+
+/// Absorbs the next len bytes of the message
+void HMACSHA256Update(HMACSHA256Context *ctx, const uint8_t *data, size_t len);
+void HMACSHA512Update(HMACSHA512Context *ctx, const uint8_t *data, size_t len);
+
+/// Writes the MAC of the message
+void HMACSHA256Final(HMACSHA256Context *ctx, uint8_t mac[SHA256_HASH_SIZE]);
+void HMACSHA512Final(HMACSHA512Context *ctx, uint8_t mac[SHA512_HASH_SIZE]);
+
+#endif //__HMAC_H_
@@ -0,0 +1,325 @@
+// Persistent, incrementally updated Merkle trees over fixed-size chunks, with inclusion proofs
+
+#define _DEFAULT_SOURCE
+#include <fcntl.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "MerkleTree.h"
+#include "SHAInternal.h"
+#include "TreeHash.h"
+
+static const char merkleMagic[8] = { 'S', 'H', 'A', 'M', 'R', 'K', 'L', '1' };
+
+// Number of nodes on every level, leaves first
+typedef struct MerkleShape {
+    int numLevels;
+    size_t count[MERKLE_TREE_MAX_LEVELS];
+    size_t start[MERKLE_TREE_MAX_LEVELS];   // index of the level's first digest
+    size_t numNodes;
+} MerkleShape;
+
+struct MerkleTree {
+    SHAAlgorithm algorithm;
+    const TreeHashFns *fns;
+    size_t leafSize;
+    MerkleShape shape;
+    uint8_t *nodes;         // every digest, level by level
+
+    uint8_t *map;           // the whole file, for a file backed tree
+    size_t mapLen;
+    int fd;
+};
+
+static const TreeHashFns *fnsFor(SHAAlgorithm algorithm)
+{
+    if (algorithm == SHA_ALGORITHM_SHA256)
+        return &treeHashSHA256Fns;
+    if (algorithm == SHA_ALGORITHM_SHA512)
+        return &treeHashSHA512Fns;
+    return NULL;
+}
+
+static void computeShape(size_t numLeaves, MerkleShape *shape)
+{
+    size_t count = numLeaves;
+    shape->numLevels = 0;
+    shape->numNodes = 0;
+    for (;;)
+    {
+        shape->start[shape->numLevels] = shape->numNodes;
+        shape->count[shape->numLevels++] = count;
+        shape->numNodes += count;
+        if (count == 1)
+            break;
+        count = (count + 1) / 2;
+    }
+}
+
+static uint8_t *nodeAt(const MerkleTree *tree, int level, size_t index)
+{
+    return &tree->nodes[(tree->shape.start[level] + index) * tree->fns->hashSize];
+}
+
+static void writeHeader(uint8_t *header, SHAAlgorithm algorithm, size_t leafSize, size_t numLeaves)
+{
+    memset(header, 0, MERKLE_TREE_HEADER_SIZE);
+    memcpy(header, merkleMagic, sizeof(merkleMagic));
+    storeBigEndian32(&header[8], (uint32_t)algorithm);
+    storeBigEndian64(&header[16], (uint64_t)leafSize);
+    storeBigEndian64(&header[24], (uint64_t)numLeaves);
+}
+
+// Allocates the digest storage of tree, mapping it from a new file at path if there is one
+static int allocateNodes(MerkleTree *tree, const char *path)
+{
+    size_t nodesLen = tree->shape.numNodes * tree->fns->hashSize;
+    if (path == NULL)
+    {
+        tree->nodes = (uint8_t*) malloc(nodesLen);
+        return tree->nodes != NULL;
+    }
+
+    tree->fd = open(path, O_RDWR | O_CREAT | O_TRUNC, 0644);
+    if (tree->fd < 0)
+        return 0;
+    tree->mapLen = MERKLE_TREE_HEADER_SIZE + nodesLen;
+    if (ftruncate(tree->fd, (off_t)tree->mapLen) != 0)
+        return 0;
+    void *map = mmap(NULL, tree->mapLen, PROT_READ | PROT_WRITE, MAP_SHARED, tree->fd, 0);
+    if (map == MAP_FAILED)
+        return 0;
+    tree->map = (uint8_t*)map;
+    tree->nodes = tree->map + MERKLE_TREE_HEADER_SIZE;
+    return 1;
+}
+
+static MerkleTree *newTree(SHAAlgorithm algorithm, size_t leafSize, size_t numLeaves)
+{
+    const TreeHashFns *fns = fnsFor(algorithm);
+    // a tree has fewer than 2 * numLeaves nodes, which must be addressable
+    if (fns == NULL || leafSize == 0 || numLeaves == 0 || numLeaves > SIZE_MAX / (2 * fns->hashSize))
+        return NULL;
+
+    MerkleTree *tree = (MerkleTree*) calloc(1, sizeof(MerkleTree));
+    if (tree == NULL)
+        return NULL;
+    tree->algorithm = algorithm;
+    tree->fns = fns;
+    tree->leafSize = leafSize;
+    tree->fd = -1;
+    computeShape(numLeaves, &tree->shape);
+    return tree;
+}
+
+MerkleTree *MerkleTreeBuild(SHAAlgorithm algorithm, const uint8_t *data, size_t len, size_t leafSize,
+                            ThreadPool *pool, const char *path)
+{
+    size_t numLeaves = (len == 0 || leafSize == 0) ? 1 : (len - 1) / leafSize + 1;
+    MerkleTree *tree = newTree(algorithm, leafSize, numLeaves);
+    if (tree == NULL)
+        return NULL;
+    if (!allocateNodes(tree, path))
+    {
+        MerkleTreeClose(tree);
+        return NULL;
+    }
+
+    // the same levels as TreeHash.c computes, kept rather than discarded
+    treeHashLeaves(tree->fns, data, len, leafSize, numLeaves, pool, tree->nodes);
+    for (int k = 1; k < tree->shape.numLevels; ++k)
+        treeHashLevel(tree->fns, nodeAt(tree, k - 1, 0), tree->shape.count[k - 1], pool, nodeAt(tree, k, 0));
+
+    // the header goes last, so a file is only recognized once its digests are complete
+    if (tree->map != NULL)
+        writeHeader(tree->map, algorithm, leafSize, numLeaves);
+    return tree;
+}
+
+MerkleTree *MerkleTreeOpen(const char *path)
+{
+    int fd = open(path, O_RDWR);
+    if (fd < 0)
+        return NULL;
+
+    struct stat st;
+    uint8_t header[MERKLE_TREE_HEADER_SIZE];
+    if (fstat(fd, &st) != 0 || st.st_size < MERKLE_TREE_HEADER_SIZE ||
+        pread(fd, header, sizeof(header), 0) != (ssize_t)sizeof(header) ||
+        memcmp(header, merkleMagic, sizeof(merkleMagic)) != 0)
+    {
+        close(fd);
+        return NULL;
+    }
+
+    uint64_t numLeaves = loadBigEndian64(&header[24]);
+    MerkleTree *tree = NULL;
+    if (numLeaves <= SIZE_MAX)
+        tree = newTree((SHAAlgorithm)loadBigEndian32(&header[8]), (size_t)loadBigEndian64(&header[16]),
+                       (size_t)numLeaves);
+    if (tree == NULL)
+    {
+        close(fd);
+        return NULL;
+    }
+    tree->fd = fd;
+    tree->mapLen = MERKLE_TREE_HEADER_SIZE + tree->shape.numNodes * tree->fns->hashSize;
+    if ((uint64_t)st.st_size != (uint64_t)tree->mapLen)
+    {
+        MerkleTreeClose(tree);
+        return NULL;
+    }
+
+    void *map = mmap(NULL, tree->mapLen, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    if (map == MAP_FAILED)
+    {
+        MerkleTreeClose(tree);
+        return NULL;
+    }
+    tree->map = (uint8_t*)map;
+    tree->nodes = tree->map + MERKLE_TREE_HEADER_SIZE;
+    return tree;
+}
+
+int MerkleTreeSync(MerkleTree *tree)
+{
+    if (tree->map == NULL)
+        return 1;
+    return msync(tree->map, tree->mapLen, MS_SYNC) == 0;
+}
+
+void MerkleTreeClose(MerkleTree *tree)
+{
+    if (tree == NULL)
+        return;
+
+    if (tree->map != NULL)
+        munmap(tree->map, tree->mapLen);
+    else
+        free(tree->nodes);
+    if (tree->fd >= 0)
+        close(tree->fd);
+    free(tree);
+}
+
+SHAAlgorithm MerkleTreeAlgorithm(const MerkleTree *tree)
+{
+    return tree->algorithm;
+}
+
+size_t MerkleTreeHashSize(const MerkleTree *tree)
+{
+    return tree->fns->hashSize;
+}
+
+size_t MerkleTreeLeafSize(const MerkleTree *tree)
+{
+    return tree->leafSize;
+}
+
+size_t MerkleTreeNumLeaves(const MerkleTree *tree)
+{
+    return tree->shape.count[0];
+}
+
+const uint8_t *MerkleTreeRoot(const MerkleTree *tree)
+{
+    return nodeAt(tree, tree->shape.numLevels - 1, 0);
+}
+
+const uint8_t *MerkleTreeLeaf(const MerkleTree *tree, size_t index)
+{
+    return (index < tree->shape.count[0]) ? nodeAt(tree, 0, index) : NULL;
+}
+
+int MerkleTreeUpdateDigest(MerkleTree *tree, size_t index, const uint8_t *leafDigest)
+{
+    if (index >= tree->shape.count[0])
+        return 0;
+
+    size_t hashSize = tree->fns->hashSize;
+    memcpy(nodeAt(tree, 0, index), leafDigest, hashSize);
+
+    // one node per level: the parent of the changed node, from its pair or carried up alone
+    for (int k = 1; k < tree->shape.numLevels; ++k)
+    {
+        size_t left = index & ~(size_t)1;
+        uint8_t *parent = nodeAt(tree, k, index / 2);
+        if (left + 1 < tree->shape.count[k - 1])
+            tree->fns->node(nodeAt(tree, k - 1, left), nodeAt(tree, k - 1, left + 1), parent);
+        else
+            memcpy(parent, nodeAt(tree, k - 1, left), hashSize);
+        index /= 2;
+    }
+    return 1;
+}
+
+int MerkleTreeUpdate(MerkleTree *tree, size_t index, const uint8_t *chunk, size_t len)
+{
+    size_t numLeaves = tree->shape.count[0];
+    if (index >= numLeaves || len > tree->leafSize || (index + 1 < numLeaves && len != tree->leafSize) ||
+        (len == 0 && numLeaves > 1))
+        return 0;
+
+    uint8_t digest[SHA512_HASH_SIZE];
+    tree->fns->leaf(chunk, len, digest);
+    return MerkleTreeUpdateDigest(tree, index, digest);
+}
+
+size_t MerkleTreeProofSize(const MerkleTree *tree)
+{
+    return (size_t)(tree->shape.numLevels - 1) * tree->fns->hashSize;
+}
+
+int MerkleTreeProve(const MerkleTree *tree, size_t index, uint8_t *proof, size_t *proofLen)
+{
+    if (index >= tree->shape.count[0])
+        return 0;
+
+    size_t hashSize = tree->fns->hashSize;
+    size_t len = 0;
+    for (int k = 0; k + 1 < tree->shape.numLevels; ++k)
+    {
+        size_t sibling = index ^ 1;
+        if (sibling < tree->shape.count[k])
+        {
+            memcpy(&proof[len], nodeAt(tree, k, sibling), hashSize);
+            len += hashSize;
+        }
+        index /= 2;
+    }
+    *proofLen = len;
+    return 1;
+}
+
+int MerkleTreeVerify(SHAAlgorithm algorithm, size_t numLeaves, size_t index, const uint8_t *leafDigest,
+                     const uint8_t *proof, size_t proofLen, const uint8_t *root)
+{
+    const TreeHashFns *fns = fnsFor(algorithm);
+    if (fns == NULL || index >= numLeaves)
+        return 0;
+
+    uint8_t digest[SHA512_HASH_SIZE];
+    size_t used = 0;
+    memcpy(digest, leafDigest, fns->hashSize);
+    for (size_t count = numLeaves; count > 1; count = (count + 1) / 2)
+    {
+        size_t sibling = index ^ 1;
+        if (sibling < count)
+        {
+            if (proofLen - used < fns->hashSize)
+                return 0;
+            if (index & 1)
+                fns->node(&proof[used], digest, digest);
+            else
+                fns->node(digest, &proof[used], digest);
+            used += fns->hashSize;
+        }
+        index /= 2;
+    }
+    return used == proofLen && SHADigestEqual(digest, root, fns->hashSize);
+}
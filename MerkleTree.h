@@ -0,0 +1,81 @@
+// Persistent, incrementally updated Merkle trees over fixed-size chunks, with inclusion proofs
+//
+// The tree has exactly the shape and digests of TreeHash.h: leaf = H(0x00 || chunk),
+// node = H(0x01 || left || right), an unpaired last node is carried up unchanged, so the root equals
+// SHA256TreeHash/SHA512TreeHash of the same data and leaf size. Every level is kept, which makes
+// replacing a chunk cost one leaf hash plus one node hash per level instead of rehashing the object.
+//
+// A tree can live in memory or in a file that is mapped shared, so updates reach the file without
+// any serialization step. The file is a 64 byte header followed by the digests level by level,
+// leaves first and the root last:
+//   magic "SHAMRKL1" | algorithm (u32) | reserved (u32) | leaf size (u64) | leaf count (u64) | zeros
+// with all integers big endian.
+//
+// An inclusion proof for a leaf is the digest of its sibling on every level where it has one, from
+// the leaves up; the leaf count and index tell the verifier which levels those are and which side
+// each sibling is on.
+
+#ifndef __MERKLE_TREE_H_
+#define __MERKLE_TREE_H_
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "SHAHasher.h"
+#include "ThreadPool.h"
+
+#define MERKLE_TREE_HEADER_SIZE 64
+
+// Levels of a tree of 2^63 leaves; bounds the number of digests in a proof
+#define MERKLE_TREE_MAX_LEVELS 64
+
+typedef struct MerkleTree MerkleTree;
+
+/// Builds the tree of the len bytes at data, split into chunks of leafSize bytes, for SHA_ALGORITHM_SHA256 or
+/// SHA_ALGORITHM_SHA512. Leaves are hashed on the threads of pool, or on the calling thread if it is NULL.
+/// With a path, the tree is written to that file, replacing it, and stays mapped; with a NULL path it is kept
+/// in memory. Returns NULL for another algorithm, a leafSize of 0, or if memory or the file cannot be set up
+MerkleTree *MerkleTreeBuild(SHAAlgorithm algorithm, const uint8_t *data, size_t len, size_t leafSize,
+                            ThreadPool *pool, const char *path);
+
+/// Maps a tree file written by MerkleTreeBuild for reading and updating. Returns NULL if the file cannot be
+/// opened or is not a complete tree
+MerkleTree *MerkleTreeOpen(const char *path);
+
+/// Flushes the changes to a file backed tree to disk. Returns 0 on failure
+int MerkleTreeSync(MerkleTree *tree);
+
+/// Unmaps or frees the tree
+void MerkleTreeClose(MerkleTree *tree);
+
+SHAAlgorithm MerkleTreeAlgorithm(const MerkleTree *tree);
+size_t MerkleTreeHashSize(const MerkleTree *tree);
+size_t MerkleTreeLeafSize(const MerkleTree *tree);
+size_t MerkleTreeNumLeaves(const MerkleTree *tree);
+
+/// Returns the root digest, valid until the tree is next updated or closed
+const uint8_t *MerkleTreeRoot(const MerkleTree *tree);
+
+/// Returns the digest of leaf index, or NULL if there is no such leaf
+const uint8_t *MerkleTreeLeaf(const MerkleTree *tree, size_t index);
+
+/// Replaces chunk index with the len bytes at chunk and rehashes the path from it to the root. Every chunk
+/// but the last must be exactly the leaf size; the last may be shorter. Returns 0, leaving the tree
+/// unchanged, if the index or length is not valid
+int MerkleTreeUpdate(MerkleTree *tree, size_t index, const uint8_t *chunk, size_t len);
+
+/// MerkleTreeUpdate for a caller that already has the leaf digest H(0x00 || chunk)
+int MerkleTreeUpdateDigest(MerkleTree *tree, size_t index, const uint8_t *leafDigest);
+
+/// Writes the inclusion proof of leaf index into proof, which must hold MerkleTreeProofSize bytes, and its
+/// length in bytes into proofLen. Returns 0 if there is no such leaf
+int MerkleTreeProve(const MerkleTree *tree, size_t index, uint8_t *proof, size_t *proofLen);
+
+/// Returns the most bytes an inclusion proof of the tree takes
+size_t MerkleTreeProofSize(const MerkleTree *tree);
+
+/// Returns 1 if proof shows that leafDigest is leaf index of a tree with numLeaves leaves and the given root
+int MerkleTreeVerify(SHAAlgorithm algorithm, size_t numLeaves, size_t index, const uint8_t *leafDigest,
+                     const uint8_t *proof, size_t proofLen, const uint8_t *root);
+
+#endif //__MERKLE_TREE_H_
@@ -0,0 +1,182 @@
+// PBKDF2 with HMAC-SHA256 and HMAC-SHA512 as the pseudorandom function (RFC 8018, NIST SP 800-132)
+
+#include <string.h>
+
+#include "HMAC.h"
+#include "PBKDF2.h"
+#include "SHAInternal.h"
+
+// Shared state of the tasks of one derivation; task i derives output block T_(i+1)
+typedef struct PBKDF2Job {
+    const void *key;        // HMACSHA256Key or HMACSHA512Key
+    const uint8_t *salt;
+    size_t saltLen;
+    uint32_t iterations;
+    uint8_t *out;
+    size_t outLen;
+} PBKDF2Job;
+
+// Writes the big endian 32 bit block index INT(i) that follows the salt in U_1
+static void blockIndex(uint8_t index[4], size_t i)
+{
+    storeBigEndian32(index, (uint32_t)(i + 1));
+}
+
+static void pbkdf2BlockSHA256(void *arg, size_t i)
+{
+    const PBKDF2Job *job = (const PBKDF2Job*)arg;
+    const HMACSHA256Key *key = (const HMACSHA256Key*)job->key;
+    uint8_t index[4], u1[SHA256_HASH_SIZE];
+    uint32_t u[SHA256_ARRAY_LEN], t[SHA256_ARRAY_LEN], h[SHA256_ARRAY_LEN];
+
+    // U_1 = HMAC(P, S || INT(i))
+    HMACSHA256Context ctx;
+    blockIndex(index, i);
+    HMACSHA256Init(&ctx, key);
+    HMACSHA256Update(&ctx, job->salt, job->saltLen);
+    HMACSHA256Update(&ctx, index, sizeof(index));
+    HMACSHA256Final(&ctx, u1);
+    for (int k = 0; k < SHA256_ARRAY_LEN; ++k)
+        t[k] = u[k] = loadBigEndian32(&u1[k * 4]);
+
+    // U_j = HMAC(P, U_(j-1)): both the inner and the outer message are one digest after the key block,
+    // so a single padded block serves both, and only its first SHA256_HASH_SIZE bytes change
+    uint8_t block[SHA256_MESSAGE_BLOCK_SIZE];
+    memset(block, 0, sizeof(block));
+    block[SHA256_HASH_SIZE] = 0x80;
+    storeBigEndian64(&block[SHA256_MESSAGE_BLOCK_SIZE - 8], (SHA256_MESSAGE_BLOCK_SIZE + SHA256_HASH_SIZE) * 8);
+
+    for (uint32_t j = 1; j < job->iterations; ++j)
+    {
+        for (int k = 0; k < SHA256_ARRAY_LEN; ++k)
+            storeBigEndian32(&block[k * 4], u[k]);
+        memcpy(h, key->inner.h, sizeof(h));
+        sha256Blocks(h, block, 1);
+
+        for (int k = 0; k < SHA256_ARRAY_LEN; ++k)
+            storeBigEndian32(&block[k * 4], h[k]);
+        memcpy(u, key->outer.h, sizeof(u));
+        sha256Blocks(u, block, 1);
+
+        for (int k = 0; k < SHA256_ARRAY_LEN; ++k)
+            t[k] ^= u[k];
+    }
+
+    // T_i, truncated if it is the last block
+    size_t offset = i * SHA256_HASH_SIZE;
+    size_t len = (job->outLen - offset < SHA256_HASH_SIZE) ? job->outLen - offset : SHA256_HASH_SIZE;
+    for (int k = 0; k < SHA256_ARRAY_LEN; ++k)
+        storeBigEndian32(&u1[k * 4], t[k]);
+    memcpy(&job->out[offset], u1, len);
+
+    secureWipe(u1, sizeof(u1));
+    secureWipe(u, sizeof(u));
+    secureWipe(t, sizeof(t));
+    secureWipe(h, sizeof(h));
+    secureWipe(block, sizeof(block));
+}
+
+static void pbkdf2BlockSHA512(void *arg, size_t i)
+{
+    const PBKDF2Job *job = (const PBKDF2Job*)arg;
+    const HMACSHA512Key *key = (const HMACSHA512Key*)job->key;
+    uint8_t index[4], u1[SHA512_HASH_SIZE];
+    uint64_t u[HASH_ARRAY_LEN], t[HASH_ARRAY_LEN], h[HASH_ARRAY_LEN];
+
+    // U_1 = HMAC(P, S || INT(i))
+    HMACSHA512Context ctx;
+    blockIndex(index, i);
+    HMACSHA512Init(&ctx, key);
+    HMACSHA512Update(&ctx, job->salt, job->saltLen);
+    HMACSHA512Update(&ctx, index, sizeof(index));
+    HMACSHA512Final(&ctx, u1);
+    for (int k = 0; k < HASH_ARRAY_LEN; ++k)
+        t[k] = u[k] = loadBigEndian64(&u1[k * 8]);
+
+    // U_j = HMAC(P, U_(j-1)), from one pre-padded block as in pbkdf2BlockSHA256
+    uint8_t block[SHA512_MESSAGE_BLOCK_SIZE];
+    memset(block, 0, sizeof(block));
+    block[SHA512_HASH_SIZE] = 0x80;
+    storeBigEndian64(&block[SHA512_MESSAGE_BLOCK_SIZE - 8], (SHA512_MESSAGE_BLOCK_SIZE + SHA512_HASH_SIZE) * 8);
+
+    for (uint32_t j = 1; j < job->iterations; ++j)
+    {
+        for (int k = 0; k < HASH_ARRAY_LEN; ++k)
+            storeBigEndian64(&block[k * 8], u[k]);
+        memcpy(h, key->inner.h, sizeof(h));
+        sha512Blocks(h, block, 1);
+
+        for (int k = 0; k < HASH_ARRAY_LEN; ++k)
+            storeBigEndian64(&block[k * 8], h[k]);
+        memcpy(u, key->outer.h, sizeof(u));
+        sha512Blocks(u, block, 1);
+
+        for (int k = 0; k < HASH_ARRAY_LEN; ++k)
+            t[k] ^= u[k];
+    }
+
+    size_t offset = i * SHA512_HASH_SIZE;
+    size_t len = (job->outLen - offset < SHA512_HASH_SIZE) ? job->outLen - offset : SHA512_HASH_SIZE;
+    for (int k = 0; k < HASH_ARRAY_LEN; ++k)
+        storeBigEndian64(&u1[k * 8], t[k]);
+    memcpy(&job->out[offset], u1, len);
+
+    secureWipe(u1, sizeof(u1));
+    secureWipe(u, sizeof(u));
+    secureWipe(t, sizeof(t));
+    secureWipe(h, sizeof(h));
+    secureWipe(block, sizeof(block));
+}
+
+// Returns non zero if the parameters are within the limits of RFC 8018: at least one iteration and
+// at most 2^32 - 1 output blocks
+static int validParameters(uint32_t iterations, size_t numBlocks)
+{
+    return iterations > 0 && (uint64_t)numBlocks <= 0xFFFFFFFFULL;
+}
+
+int PBKDF2HMACSHA256(const uint8_t *password, size_t passwordLen, const uint8_t *salt, size_t saltLen,
+                     uint32_t iterations, ThreadPool *pool, uint8_t *out, size_t outLen)
+{
+    size_t numBlocks = (outLen + SHA256_HASH_SIZE - 1) / SHA256_HASH_SIZE;
+    if (!validParameters(iterations, numBlocks))
+        return 0;
+
+    HMACSHA256Key key;
+    HMACSHA256SetKey(&key, password, passwordLen);
+
+    PBKDF2Job job;
+    job.key = &key;
+    job.salt = salt;
+    job.saltLen = saltLen;
+    job.iterations = iterations;
+    job.out = out;
+    job.outLen = outLen;
+    ThreadPoolRun(pool, numBlocks, pbkdf2BlockSHA256, &job);
+
+    HMACSHA256ClearKey(&key);
+    return 1;
+}
+
+int PBKDF2HMACSHA512(const uint8_t *password, size_t passwordLen, const uint8_t *salt, size_t saltLen,
+                     uint32_t iterations, ThreadPool *pool, uint8_t *out, size_t outLen)
+{
+    size_t numBlocks = (outLen + SHA512_HASH_SIZE - 1) / SHA512_HASH_SIZE;
+    if (!validParameters(iterations, numBlocks))
+        return 0;
+
+    HMACSHA512Key key;
+    HMACSHA512SetKey(&key, password, passwordLen);
+
+    PBKDF2Job job;
+    job.key = &key;
+    job.salt = salt;
+    job.saltLen = saltLen;
+    job.iterations = iterations;
+    job.out = out;
+    job.outLen = outLen;
+    ThreadPoolRun(pool, numBlocks, pbkdf2BlockSHA512, &job);
+
+    HMACSHA512ClearKey(&key);
+    return 1;
+}
@@ -0,0 +1,28 @@
+// PBKDF2 with HMAC-SHA256 and HMAC-SHA512 as the pseudorandom function (RFC 8018, NIST SP 800-132)
+//
+// The password is turned into HMAC inner and outer midstates once. Every iteration after the first then
+// compresses exactly two blocks, one inner and one outer, from a fixed pre-padded block that only has
+// its first digest-sized bytes rewritten; nothing is allocated inside the iteration loop.
+// The output blocks T_1, T_2, ... are independent and can be derived on the threads of a pool.
+
+#ifndef __PBKDF2_H_
+#define __PBKDF2_H_
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "SHA256.h"
+#include "SHA512.h"
+#include "ThreadPool.h"
+
+/// Derives outLen bytes from the password and salt with the given iteration count and writes them into out.
+/// Output blocks are derived on the threads of pool; a NULL pool derives them on the calling thread.
+/// Returns 1 on success, or 0, leaving out untouched, if iterations is 0 or outLen exceeds (2^32 - 1) * SHA256_HASH_SIZE
+int PBKDF2HMACSHA256(const uint8_t *password, size_t passwordLen, const uint8_t *salt, size_t saltLen,
+                     uint32_t iterations, ThreadPool *pool, uint8_t *out, size_t outLen);
+
+/// HMAC-SHA512 version of PBKDF2HMACSHA256
+int PBKDF2HMACSHA512(const uint8_t *password, size_t passwordLen, const uint8_t *salt, size_t saltLen,
+                     uint32_t iterations, ThreadPool *pool, uint8_t *out, size_t outLen);
+
+#endif //__PBKDF2_H_
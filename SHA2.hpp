@@ -0,0 +1,206 @@
+// Header-only constexpr SHA-2 for C++17
+//
+// The SHA-2 compression function is written once, as templates on the word size: SHA-256 is the 32 bit
+// instantiation, and SHA-512 and its truncated variants the 64 bit one. The round constants and initial hash
+// values come from SHAConstants.h, like those of the C library. Every function is constexpr, so digests of
+// literals can be computed by the compiler instead of at startup:
+//
+//   constexpr std::array<uint8_t, 32> configId = sha2::sha256("config-v3");
+//   static_assert(sha2::sha256("abc")[0] == 0xba);
+//
+// Called at runtime, the same functions hash any buffer and return the same digests as SHA256HashInto,
+// SHA512HashInto and friends. They run the plain round loop, so buffers of more than a few blocks are hashed
+// faster by the C library's engines.
+
+#ifndef __SHA2_HPP
+#define __SHA2_HPP
+
+#if __cplusplus < 201703L
+#error "SHA2.hpp requires C++17"
+#endif
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <string_view>
+
+#include "SHAConstants.h"
+
+namespace sha2 {
+
+/// Round count, rotation and shift amounts and round constants of the compression function on Word
+template <typename Word> struct Traits;
+
+template <> struct Traits<std::uint32_t>
+{
+    static constexpr int rounds = 64;
+    static constexpr int bigSigma0[3] = { 2, 13, 22 };
+    static constexpr int bigSigma1[3] = { 6, 11, 25 };
+    static constexpr int smallSigma0[3] = { 7, 18, 3 };     // two rotations, then a shift
+    static constexpr int smallSigma1[3] = { 17, 19, 10 };
+    static constexpr std::uint32_t K[rounds] = { SHA256_K_WORDS };
+};
+
+template <> struct Traits<std::uint64_t>
+{
+    static constexpr int rounds = 80;
+    static constexpr int bigSigma0[3] = { 28, 34, 39 };
+    static constexpr int bigSigma1[3] = { 14, 18, 41 };
+    static constexpr int smallSigma0[3] = { 1, 8, 7 };
+    static constexpr int smallSigma1[3] = { 19, 61, 6 };
+    static constexpr std::uint64_t K[rounds] = { SHA512_K_WORDS };
+};
+
+template <typename Word> using State = std::array<Word, 8>;
+
+inline constexpr State<std::uint32_t> SHA256_IV = { SHA256_H0_WORDS };
+inline constexpr State<std::uint64_t> SHA512_IV = { SHA512_H0_WORDS };
+inline constexpr State<std::uint64_t> SHA384_IV = { SHA384_H0_WORDS };
+inline constexpr State<std::uint64_t> SHA512_224_IV = { SHA512_224_H0_WORDS };
+inline constexpr State<std::uint64_t> SHA512_256_IV = { SHA512_256_H0_WORDS };
+
+template <typename Word>
+constexpr Word rotr(Word x, int numBits)
+{
+    return (x >> numBits) | (x << (8 * sizeof(Word) - numBits));
+}
+
+template <typename Word>
+constexpr Word bigSigma(Word x, const int (&r)[3])
+{
+    return rotr(x, r[0]) ^ rotr(x, r[1]) ^ rotr(x, r[2]);
+}
+
+template <typename Word>
+constexpr Word smallSigma(Word x, const int (&r)[3])
+{
+    return rotr(x, r[0]) ^ rotr(x, r[1]) ^ (x >> r[2]);
+}
+
+/// Reads a big endian word; Byte is any byte-sized type, so char literals can be hashed directly
+template <typename Word, typename Byte>
+constexpr Word loadBigEndian(const Byte *p)
+{
+    Word w = 0;
+    for (std::size_t i = 0; i < sizeof(Word); ++i)
+        w = (w << 8) | static_cast<std::uint8_t>(p[i]);
+    return w;
+}
+
+/// Compresses one block of 16 big endian words into the intermediate hash value h
+template <typename Word, typename Byte>
+constexpr void compress(State<Word> &h, const Byte *block)
+{
+    using T = Traits<Word>;
+    Word w[T::rounds] = {};
+    for (int i = 0; i < 16; ++i)
+        w[i] = loadBigEndian<Word>(&block[i * sizeof(Word)]);
+    for (int i = 16; i < T::rounds; ++i)
+        w[i] = smallSigma(w[i - 2], T::smallSigma1) + w[i - 7] + smallSigma(w[i - 15], T::smallSigma0) + w[i - 16];
+
+    Word a = h[0], b = h[1], c = h[2], d = h[3], e = h[4], f = h[5], g = h[6], k = h[7];
+    for (int i = 0; i < T::rounds; ++i)
+    {
+        Word T1 = k + bigSigma(e, T::bigSigma1) + ((e & f) ^ (~e & g)) + T::K[i] + w[i];
+        Word T2 = bigSigma(a, T::bigSigma0) + ((a & b) ^ (a & c) ^ (b & c));
+        k = g;
+        g = f;
+        f = e;
+        e = d + T1;
+        d = c;
+        c = b;
+        b = a;
+        a = T1 + T2;
+    }
+    h[0] += a; h[1] += b; h[2] += c; h[3] += d;
+    h[4] += e; h[5] += f; h[6] += g; h[7] += k;
+}
+
+/// Hashes len bytes starting from the initial hash value iv and returns the leftmost HashSize bytes of the result
+template <typename Word, std::size_t HashSize, typename Byte>
+constexpr std::array<std::uint8_t, HashSize> hash(const State<Word> &iv, const Byte *data, std::size_t len)
+{
+    constexpr std::size_t blockSize = 16 * sizeof(Word);
+    // the message length takes two words, of which only the low 64 bits are ever non zero here
+    constexpr std::size_t lengthSize = 2 * sizeof(Word);
+
+    State<Word> h = iv;
+    std::size_t numBlocks = len / blockSize;
+    for (std::size_t n = 0; n < numBlocks; ++n)
+        compress(h, &data[n * blockSize]);
+
+    std::uint8_t tail[2 * blockSize] = {};
+    std::size_t rem = len % blockSize;
+    for (std::size_t i = 0; i < rem; ++i)
+        tail[i] = static_cast<std::uint8_t>(data[numBlocks * blockSize + i]);
+    tail[rem] = 0x80;
+    std::size_t end = (rem + 1 + lengthSize > blockSize) ? 2 * blockSize : blockSize;
+    std::uint64_t bits = static_cast<std::uint64_t>(len) * 8;
+    for (std::size_t i = 0; i < 8; ++i)
+        tail[end - 1 - i] = static_cast<std::uint8_t>(bits >> (8 * i));
+    if constexpr (lengthSize > 8)
+        tail[end - 9] = static_cast<std::uint8_t>(static_cast<std::uint64_t>(len) >> 61);
+    compress(h, tail);
+    if (end > blockSize)
+        compress(h, &tail[blockSize]);
+
+    std::array<std::uint8_t, HashSize> out = {};
+    for (std::size_t i = 0; i < HashSize; ++i)
+        out[i] = static_cast<std::uint8_t>(h[i / sizeof(Word)] >> (8 * (sizeof(Word) - 1 - i % sizeof(Word))));
+    return out;
+}
+
+/// One-shot digests of a buffer, or of a string without its terminating null
+constexpr std::array<std::uint8_t, 32> sha256(const std::uint8_t *data, std::size_t len)
+{
+    return hash<std::uint32_t, 32>(SHA256_IV, data, len);
+}
+
+constexpr std::array<std::uint8_t, 32> sha256(std::string_view str)
+{
+    return hash<std::uint32_t, 32>(SHA256_IV, str.data(), str.size());
+}
+
+constexpr std::array<std::uint8_t, 64> sha512(const std::uint8_t *data, std::size_t len)
+{
+    return hash<std::uint64_t, 64>(SHA512_IV, data, len);
+}
+
+constexpr std::array<std::uint8_t, 64> sha512(std::string_view str)
+{
+    return hash<std::uint64_t, 64>(SHA512_IV, str.data(), str.size());
+}
+
+constexpr std::array<std::uint8_t, 48> sha384(const std::uint8_t *data, std::size_t len)
+{
+    return hash<std::uint64_t, 48>(SHA384_IV, data, len);
+}
+
+constexpr std::array<std::uint8_t, 48> sha384(std::string_view str)
+{
+    return hash<std::uint64_t, 48>(SHA384_IV, str.data(), str.size());
+}
+
+constexpr std::array<std::uint8_t, 28> sha512_224(const std::uint8_t *data, std::size_t len)
+{
+    return hash<std::uint64_t, 28>(SHA512_224_IV, data, len);
+}
+
+constexpr std::array<std::uint8_t, 28> sha512_224(std::string_view str)
+{
+    return hash<std::uint64_t, 28>(SHA512_224_IV, str.data(), str.size());
+}
+
+constexpr std::array<std::uint8_t, 32> sha512_256(const std::uint8_t *data, std::size_t len)
+{
+    return hash<std::uint64_t, 32>(SHA512_256_IV, data, len);
+}
+
+constexpr std::array<std::uint8_t, 32> sha512_256(std::string_view str)
+{
+    return hash<std::uint64_t, 32>(SHA512_256_IV, str.data(), str.size());
+}
+
+} // namespace sha2
+
+#endif //__SHA2_HPP
@@ -2,24 +2,45 @@
 // Based on the hashing algorithm details from http://csrc.nist.gov/publications/fips/fips180-4/fips-180-4.pdf
 // and http://www.iwar.org.uk/comsec/resources/cipher/sha256-384-512.pdf
 
+#include <stdatomic.h>
 #include <stdlib.h>
 #include <string.h>
 
 #include "SHA256.h"
+#include "SHAConstants.h"
+#include "SHAInternal.h"
 #include "config.h"
 
-//K: The first thirty-two bits of the fractional parts of the cube roots of the first sixty-four primes.
-const static uint32_t K[64] =
+//SHA256_K: The first thirty-two bits of the fractional parts of the cube roots of the first sixty-four primes.
+const uint32_t SHA256_K[64] =
 {
-    0x428a2f98, 0x71374491, 0xb5c0fbcf, 0xe9b5dba5, 0x3956c25b, 0x59f111f1, 0x923f82a4, 0xab1c5ed5,
-    0xd807aa98, 0x12835b01, 0x243185be, 0x550c7dc3, 0x72be5d74, 0x80deb1fe, 0x9bdc06a7, 0xc19bf174,
-    0xe49b69c1, 0xefbe4786, 0x0fc19dc6, 0x240ca1cc, 0x2de92c6f, 0x4a7484aa, 0x5cb0a9dc, 0x76f988da,
-    0x983e5152, 0xa831c66d, 0xb00327c8, 0xbf597fc7, 0xc6e00bf3, 0xd5a79147, 0x06ca6351, 0x14292967,
-    0x27b70a85, 0x2e1b2138, 0x4d2c6dfc, 0x53380d13, 0x650a7354, 0x766a0abb, 0x81c2c92e, 0x92722c85,
-    0xa2bfe8a1, 0xa81a664b, 0xc24b8b70, 0xc76c51a3, 0xd192e819, 0xd6990624, 0xf40e3585, 0x106aa070,
-    0x19a4c116, 0x1e376c08, 0x2748774c, 0x34b0bcb5, 0x391c0cb3, 0x4ed8aa4a, 0x5b9cca4f, 0x682e6ff3,
-    0x748f82ee, 0x78a5636f, 0x84c87814, 0x8cc70208, 0x90befffa, 0xa4506ceb, 0xbef9a3f7, 0xc67178f2
-}; 
+    SHA256_K_WORDS
+};
+
+// SHA256_H0: initial hash value, the first 32 bits of the fractional parts of the square roots of the first 8 primes
+const uint32_t SHA256_H0[SHA256_ARRAY_LEN] =
+{
+    SHA256_H0_WORDS
+};
+
+const uint32_t SHA256_PAD64_SCHEDULE[64] =
+{
+    0x80000000, 0x00000000, 0x00000000, 0x00000000, 0x00000000, 0x00000000, 0x00000000, 0x00000000,
+    0x00000000, 0x00000000, 0x00000000, 0x00000000, 0x00000000, 0x00000000, 0x00000000, 0x00000200,
+    0x80000000, 0x01400000, 0x00205000, 0x00005088, 0x22000800, 0x22550014, 0x05089742, 0xa0000020,
+    0x5a880000, 0x005c9400, 0x0016d49d, 0xfa801f00, 0xd33225d0, 0x11675959, 0xf6e6bfda, 0xb30c1549,
+    0x08b2b050, 0x9d7c4c27, 0x0ce2a393, 0x88e6e1ea, 0xa52b4335, 0x67a16f49, 0xd732016f, 0x4eeb2e91,
+    0x5dbf55e5, 0x8eee2335, 0xe2bc5ec2, 0xa83f4394, 0x45ad78f7, 0x36f3d0cd, 0xd99c05e8, 0xb0511dc7,
+    0x69bc7ac4, 0xbd11375b, 0xe3ba71e5, 0x3b209ff2, 0x18feee17, 0xe25ad9e7, 0x13375046, 0x0515089d,
+    0x4f0d0f04, 0x2627484e, 0x310128d2, 0xc668b434, 0x420841cc, 0x62d311b8, 0xe59ba771, 0x85a7a484
+};
+
+// Last 32 bytes of the single block of a 32 byte message: the 1 bit, zeros and the bit length 256
+static const uint8_t digestPadding[SHA256_HASH_SIZE] =
+{
+    0x80, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+    0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0x01, 0x00
+};
 
 // Utility functions
 // Rotate x to the right by numBits
@@ -36,26 +57,226 @@ const static uint32_t K[64] =
 #define SmallSigma1(x) ( ROTR(x,17) ^ ROTR(x,19) ^ (x >> 10) )
 
 // SHA256 message schedule
-// Calculate the Nth block of W
-uint32_t *W256(int N, uint32_t *M)
+// Expands the 16 words of block M into the 64 word schedule w
+static void W256(uint32_t w[64], const uint32_t *M)
 {
-    uint32_t *w = (uint32_t*) malloc(sizeof(uint32_t) * 64);
-    uint32_t *mPtr = &M[(N * 16)];
-    
-    //printf("Message block %d : ", N);
     for (int i = 0; i < 16; ++i)
+        w[i] = M[i];
+    for (int i = 16; i < 64; ++i)
+        w[i] = SmallSigma1(w[i - 2]) + w[i - 7] + SmallSigma0(w[i - 15]) + w[i - 16];
+}
+
+// Applies the SHA256 compression function to N consecutive blocks of M, whose words are
+// already in host byte order, updating the intermediate hash value h
+static void compress256(uint32_t h[SHA256_ARRAY_LEN], const uint32_t *M, size_t N)
+{
+    for (size_t i = 0; i < N; ++i)
     {
-        w[i] = *mPtr;
-        ++mPtr;
+        uint32_t T1, T2;
+        // initialize registers
+        uint32_t reg[SHA256_ARRAY_LEN];
+        for (int i = 0; i < SHA256_ARRAY_LEN; ++i)
+            reg[i] = h[i];
+        
+        uint32_t w[64];
+        W256(w, &M[i * 16]);
         
-    //printf("%" PRIx64 , w[i]);
+        // Apply the SHA256 compression function to update registers
+        for (int j = 0; j < 64; ++j)
+        {   
+            T1 = reg[7] + BigSigma1(reg[4]) + Ch(reg[4], reg[5], reg[6]) + SHA256_K[j] + w[j];
+            T2 = BigSigma0(reg[0]) + Maj(reg[0], reg[1], reg[2]);
+            
+            reg[7] = reg[6];
+            reg[6] = reg[5];
+            reg[5] = reg[4];
+            reg[4] = reg[3] + T1;
+            reg[3] = reg[2];
+            reg[2] = reg[1];
+            reg[1] = reg[0];
+            reg[0] = T1 + T2;
+        }
+        
+        // Compute the ith intermediate hash values 
+        for (int i = 0; i < SHA256_ARRAY_LEN; ++i)
+            h[i] += reg[i];
     }
-    //printf("\n");
-    for (int i = 16; i < 64; ++i)
+}
+
+// Compresses numBlocks consecutive 64 byte blocks stored in big endian byte order with the reference
+// round loop above; the padded messages of get256Hash always take this path
+static void sha256BlocksReference(uint32_t h[SHA256_ARRAY_LEN], const uint8_t *blocks, size_t numBlocks)
+{
+    uint32_t M[16];
+    for (size_t n = 0; n < numBlocks; ++n, blocks += SHA256_MESSAGE_BLOCK_SIZE)
     {
-        w[i] = SmallSigma1(w[i - 2]) + w[i - 7] + SmallSigma0(w[i - 15]) + w[i - 16];
+        for (int i = 0; i < 16; ++i)
+            M[i] = loadBigEndian32(&blocks[i * 4]);
+        compress256(h, M, 1);
+    }
+}
+
+// Unrolled compression function of the scalar engine. The working variables are renamed from round to round
+// instead of shifted, and the message schedule is computed on the fly in a circular window of 16 words, so
+// everything can stay in registers
+
+// Schedule word i: the message word itself for the first 16 rounds, then expanded in place over word i - 16
+#define WORD256(i) (W[i] = loadBigEndian32(&blocks[(i) * 4]))
+#define SCHEDULE256(i) (W[(i) & 15] += SmallSigma1(W[((i) - 2) & 15]) + W[((i) - 7) & 15] + SmallSigma0(W[((i) - 15) & 15]))
+
+// Ch and Maj with fewer operations than the textbook forms above
+#define ChFast(x, y, z) ( (z) ^ ((x) & ((y) ^ (z))) )
+#define MajFast(x, y, z) ( ((x) & (y)) | ((z) & ((x) | (y))) )
+
+// One round; the caller rotates the roles of a..h, so the new a is written into h and the new e into d
+#define ROUND256(a, b, c, d, e, f, g, h, i, w) \
+    do { \
+        uint32_t T1 = h + BigSigma1(e) + ChFast(e, f, g) + SHA256_K[i] + w(i); \
+        d += T1; \
+        h = T1 + BigSigma0(a) + MajFast(a, b, c); \
+    } while (0)
+
+#define ROUNDS8_256(i, w) \
+    ROUND256(a, b, c, d, e, f, g, h, (i) + 0, w); \
+    ROUND256(h, a, b, c, d, e, f, g, (i) + 1, w); \
+    ROUND256(g, h, a, b, c, d, e, f, (i) + 2, w); \
+    ROUND256(f, g, h, a, b, c, d, e, (i) + 3, w); \
+    ROUND256(e, f, g, h, a, b, c, d, (i) + 4, w); \
+    ROUND256(d, e, f, g, h, a, b, c, (i) + 5, w); \
+    ROUND256(c, d, e, f, g, h, a, b, (i) + 6, w); \
+    ROUND256(b, c, d, e, f, g, h, a, (i) + 7, w)
+
+// Compresses numBlocks consecutive 64 byte blocks stored in big endian byte order
+static void sha256BlocksScalar(uint32_t state[SHA256_ARRAY_LEN], const uint8_t *blocks, size_t numBlocks)
+{
+    uint32_t W[16];
+    for (size_t n = 0; n < numBlocks; ++n, blocks += SHA256_MESSAGE_BLOCK_SIZE)
+    {
+        uint32_t a = state[0], b = state[1], c = state[2], d = state[3];
+        uint32_t e = state[4], f = state[5], g = state[6], h = state[7];
+
+        ROUNDS8_256(0, WORD256);
+        ROUNDS8_256(8, WORD256);
+        ROUNDS8_256(16, SCHEDULE256);
+        ROUNDS8_256(24, SCHEDULE256);
+        ROUNDS8_256(32, SCHEDULE256);
+        ROUNDS8_256(40, SCHEDULE256);
+        ROUNDS8_256(48, SCHEDULE256);
+        ROUNDS8_256(56, SCHEDULE256);
+
+        state[0] += a; state[1] += b; state[2] += c; state[3] += d;
+        state[4] += e; state[5] += f; state[6] += g; state[7] += h;
     }
-    return w;
+}
+
+// Schedule word i of a block whose whole message schedule is known in advance
+#define SCHEDULED256(i) (schedule[i])
+
+// Compresses one block with the given message schedule; only the rounds are left to compute
+static void sha256ScheduledScalar(uint32_t state[SHA256_ARRAY_LEN], const uint32_t schedule[64])
+{
+    uint32_t a = state[0], b = state[1], c = state[2], d = state[3];
+    uint32_t e = state[4], f = state[5], g = state[6], h = state[7];
+
+    ROUNDS8_256(0, SCHEDULED256);
+    ROUNDS8_256(8, SCHEDULED256);
+    ROUNDS8_256(16, SCHEDULED256);
+    ROUNDS8_256(24, SCHEDULED256);
+    ROUNDS8_256(32, SCHEDULED256);
+    ROUNDS8_256(40, SCHEDULED256);
+    ROUNDS8_256(48, SCHEDULED256);
+    ROUNDS8_256(56, SCHEDULED256);
+
+    state[0] += a; state[1] += b; state[2] += c; state[3] += d;
+    state[4] += e; state[5] += f; state[6] += g; state[7] += h;
+}
+
+#ifdef SHA_HAVE_X86_SIMD
+static int cpuHasSSSE3(void) { return __builtin_cpu_supports("ssse3"); }
+static int cpuHasAVX2(void) { return __builtin_cpu_supports("avx2"); }
+#endif
+
+static int cpuAlways(void) { return 1; }
+
+// Dispatch table of block functions, indexed by SHA256Engine
+static const struct
+{
+    const char *name;
+    void (*blocks)(uint32_t h[SHA256_ARRAY_LEN], const uint8_t *blocks, size_t numBlocks);
+    int (*supported)(void);
+} engines[SHA256_ENGINE_COUNT] =
+{
+    { "scalar", sha256BlocksScalar, cpuAlways },
+#ifdef SHA_HAVE_X86_SIMD
+    { "ssse3", sha256BlocksSSSE3, cpuHasSSSE3 },
+    { "avx2", sha256BlocksAVX2, cpuHasAVX2 },
+    { "sha-ni", sha256BlocksSHANI, sha256CpuHasSHANI },
+#else
+    { "ssse3", sha256BlocksScalar, NULL },
+    { "avx2", sha256BlocksScalar, NULL },
+    { "sha-ni", sha256BlocksScalar, NULL },
+#endif
+};
+
+// The engine is a single index into the constant table, so a switch while other threads hash is seen by each
+// call as either the old engine or the new one, never a mix of the two
+static atomic_int activeEngine = SHA256_ENGINE_SCALAR;
+
+#ifdef __GNUC__
+// Picks the fastest engine the CPU supports once, before main() runs
+__attribute__((constructor))
+#endif
+static void selectEngine(void)
+{
+#ifdef SHA_HAVE_X86_SIMD
+    __builtin_cpu_init();
+#endif
+    for (int e = SHA256_ENGINE_COUNT - 1; e >= 0; --e)
+    {
+        if (SHA256SetEngine((SHA256Engine)e))
+            break;
+    }
+}
+
+void sha256Blocks(uint32_t h[SHA256_ARRAY_LEN], const uint8_t *blocks, size_t numBlocks)
+{
+    if (numBlocks == 0)
+        return;
+    int engine = atomic_load_explicit(&activeEngine, memory_order_relaxed);
+    engines[engine].blocks(h, blocks, numBlocks);
+    SHA_STATS_COUNT(SHA_STATS_SHA256_SCALAR + engine, numBlocks * SHA256_MESSAGE_BLOCK_SIZE, numBlocks);
+}
+
+// The SSSE3 and AVX2 engines only speed up the message schedule, so with a known schedule the scalar rounds
+// are as fast; the SHA extensions run the rounds themselves
+void sha256Scheduled(uint32_t h[SHA256_ARRAY_LEN], const uint32_t schedule[64])
+{
+#ifdef SHA_HAVE_X86_SIMD
+    if (atomic_load_explicit(&activeEngine, memory_order_relaxed) == SHA256_ENGINE_SHANI)
+    {
+        sha256ScheduledSHANI(h, schedule);
+        return;
+    }
+#endif
+    sha256ScheduledScalar(h, schedule);
+}
+
+SHA256Engine SHA256GetEngine(void)
+{
+    return (SHA256Engine)atomic_load_explicit(&activeEngine, memory_order_relaxed);
+}
+
+int SHA256SetEngine(SHA256Engine engine)
+{
+    if (engine >= SHA256_ENGINE_COUNT || engines[engine].supported == NULL || !engines[engine].supported())
+        return 0;
+    atomic_store_explicit(&activeEngine, (int)engine, memory_order_relaxed);
+    return 1;
+}
+
+const char *SHA256EngineName(SHA256Engine engine)
+{
+    return (engine < SHA256_ENGINE_COUNT) ? engines[engine].name : NULL;
 }
 
 // Step 1:
@@ -70,12 +291,14 @@ PaddedMsg preprocess256(uint8_t *msg, size_t len)
     
     // resulting msg wll be multiple of 1024 bits
     //size_t len = strlen(msg);
-    if (msg == NULL || len == 0)
+    // an empty message still pads to one full block
+    if (msg == NULL && len > 0)
     {
         padded.length = 0;
         padded.msg = NULL;
         return padded;
     }
+    SHA_STATS_BEGIN(start);
     
     size_t l = len * 8;
     size_t k = (448 - ( (l + 1) % 512 )) % 512;
@@ -86,9 +309,10 @@ PaddedMsg preprocess256(uint8_t *msg, size_t len)
     padded.length = ((l + k + 1) / 8) + 8;
     //printf("padded.length = %zu\n", padded.length);
     padded.msg = (uint8_t*) malloc(sizeof(uint8_t) * padded.length);
-    memset(&padded.msg[0], 0, padded.length);
-    for (size_t i = 0; i < len; ++i)
-        padded.msg[i] = msg[i];
+    // copy the message once; only the padding after it needs clearing
+    if (len > 0)
+        memcpy(padded.msg, msg, len);
+    memset(&padded.msg[len], 0, padded.length - len);
     // append to the binary string a 1 followed by k zeros
     padded.msg[len] = 0x80;
     
@@ -97,6 +321,7 @@ PaddedMsg preprocess256(uint8_t *msg, size_t len)
     endianSwap64(&bigL);
     memcpy(&padded.msg[padded.length - sizeof(uint64_t)], &bigL, sizeof(uint64_t));
     
+    SHA_STATS_END(SHA_STATS_PREPROCESS256, start, len, padded.length / SHA256_MESSAGE_BLOCK_SIZE);
     return padded;
 }
 
@@ -108,59 +333,15 @@ uint32_t *get256Hash(PaddedMsg *p)
 {
     size_t N = p->length / SHA256_MESSAGE_BLOCK_SIZE;
     //printf("Number of blocks = %zu\n", N);
+    SHA_STATS_BEGIN(start);
     
     // initial hash value
-    uint32_t h[SHA256_ARRAY_LEN] = {
-        0x6a09e667,
-        0xbb67ae85,
-        0x3c6ef372,
-        0xa54ff53a,
-        0x510e527f,
-        0x9b05688c,
-        0x1f83d9ab,
-        0x5be0cd19
-    };
+    uint32_t h[SHA256_ARRAY_LEN];
+    memcpy(h, SHA256_H0, sizeof(h));
     
-#if MACHINE_BYTE_ORDER == LITTLE_ENDIAN
-    // Convert byte order of message to big endian
-    uint32_t *msg = ((uint32_t*)&p->msg[0]);
-    for (int i = 0; i < N * 16; ++i)
-        endianSwap32(msg++);
-#endif
-
-    for (size_t i = 0; i < N; ++i)
-    {
-        uint32_t T1, T2;
-        // initialize registers
-        uint32_t reg[SHA256_ARRAY_LEN];
-        for (int i = 0; i < SHA256_ARRAY_LEN; ++i)
-            reg[i] = h[i];
-        
-        uint32_t *w = W256(i, ((uint32_t*)(p->msg)));
-        
-        // Apply the SHA256 compression function to update registers
-        for (int j = 0; j < 64; ++j)
-        {   
-            T1 = reg[7] + BigSigma1(reg[4]) + Ch(reg[4], reg[5], reg[6]) + K[j] + w[j];
-            T2 = BigSigma0(reg[0]) + Maj(reg[0], reg[1], reg[2]);
-            
-            reg[7] = reg[6];
-            reg[6] = reg[5];
-            reg[5] = reg[4];
-            reg[4] = reg[3] + T1;
-            reg[3] = reg[2];
-            reg[2] = reg[1];
-            reg[1] = reg[0];
-            reg[0] = T1 + T2;
-        }
-        
-        // Compute the ith intermediate hash values 
-        for (int i = 0; i < SHA256_ARRAY_LEN; ++i)
-            h[i] += reg[i];
-        
-        free(w);
-    }
+    sha256BlocksReference(h, p->msg, N);
     free(p->msg);
+    SHA_STATS_END(SHA_STATS_GET256_HASH, start, p->length, N);
     
     // Now the array h is the hash of the original message M
     uint32_t *retVal = (uint32_t*) malloc(sizeof(uint32_t) * SHA256_ARRAY_LEN);
@@ -171,7 +352,161 @@ uint32_t *get256Hash(PaddedMsg *p)
 /// Wrapper for hashing methods, up to caller to free the return value
 uint32_t *SHA256Hash(uint8_t *input, size_t len)
 {
-    PaddedMsg paddedMsg = preprocess256(input, len);
-    return get256Hash(&paddedMsg);
+    uint8_t digest[SHA256_HASH_SIZE];
+    SHA256HashInto(input, len, digest);
+
+    uint32_t *retVal = (uint32_t*) malloc(sizeof(uint32_t) * SHA256_ARRAY_LEN);
+    for (int i = 0; i < SHA256_ARRAY_LEN; ++i)
+        retVal[i] = loadBigEndian32(&digest[i * 4]);
+    return retVal;
+}
+
+// Builds the last one or two blocks of a message of msgLen bytes in tail: its final rem bytes, the 1 bit,
+// zeros and the 64 bit big endian bit length. Returns the number of blocks
+static size_t padTail(uint8_t tail[2 * SHA256_MESSAGE_BLOCK_SIZE], const uint8_t *rest, size_t rem, uint64_t msgLen)
+{
+    size_t numBlocks = (rem + 9 > SHA256_MESSAGE_BLOCK_SIZE) ? 2 : 1;
+    size_t end = numBlocks * SHA256_MESSAGE_BLOCK_SIZE;
+
+    if (rem > 0)
+        memcpy(tail, rest, rem);
+    tail[rem] = 0x80;
+    memset(&tail[rem + 1], 0, end - 8 - (rem + 1));
+    storeBigEndian64(&tail[end - 8], msgLen * 8);
+    return numBlocks;
+}
+
+// Whole blocks are compressed straight from the caller's buffer; only the padded tail is copied, into a
+// buffer on the stack
+void SHA256HashInto(const uint8_t *input, size_t len, uint8_t out[SHA256_HASH_SIZE])
+{
+    uint32_t h[SHA256_ARRAY_LEN];
+    uint8_t tail[2 * SHA256_MESSAGE_BLOCK_SIZE];
+    size_t numBlocks = len / SHA256_MESSAGE_BLOCK_SIZE;
+    size_t rem = len % SHA256_MESSAGE_BLOCK_SIZE;
+    SHA_STATS_BEGIN(start);
+
+    memcpy(h, SHA256_H0, sizeof(h));
+    sha256Blocks(h, input, numBlocks);
+    size_t tailBlocks = padTail(tail, &input[len - rem], rem, len);
+    sha256Blocks(h, tail, tailBlocks);
+    for (int i = 0; i < SHA256_ARRAY_LEN; ++i)
+        storeBigEndian32(&out[i * 4], h[i]);
+    SHA_STATS_END(SHA_STATS_SHA256, start, len, numBlocks + tailBlocks);
+}
+
+void SHA256Hash64Into(const uint8_t input[SHA256_MESSAGE_BLOCK_SIZE], uint8_t out[SHA256_HASH_SIZE])
+{
+    uint32_t h[SHA256_ARRAY_LEN];
+    SHA_STATS_BEGIN(start);
+
+    memcpy(h, SHA256_H0, sizeof(h));
+    sha256Blocks(h, input, 1);
+    sha256Scheduled(h, SHA256_PAD64_SCHEDULE);
+    for (int i = 0; i < SHA256_ARRAY_LEN; ++i)
+        storeBigEndian32(&out[i * 4], h[i]);
+    SHA_STATS_END(SHA_STATS_SHA256_HASH64, start, SHA256_MESSAGE_BLOCK_SIZE, 2);
+}
+
+void SHA256dHashInto(const uint8_t *input, size_t len, uint8_t out[SHA256_HASH_SIZE])
+{
+    uint8_t block[SHA256_MESSAGE_BLOCK_SIZE];
+    uint32_t h[SHA256_ARRAY_LEN];
+    SHA_STATS_BEGIN(start);
+
+    if (len == SHA256_MESSAGE_BLOCK_SIZE)
+        SHA256Hash64Into(input, block);
+    else
+        SHA256HashInto(input, len, block);
+    memcpy(&block[SHA256_HASH_SIZE], digestPadding, sizeof(digestPadding));
+
+    memcpy(h, SHA256_H0, sizeof(h));
+    sha256Blocks(h, block, 1);
+    for (int i = 0; i < SHA256_ARRAY_LEN; ++i)
+        storeBigEndian32(&out[i * 4], h[i]);
+    SHA_STATS_END(SHA_STATS_SHA256D, start, len, (len + 8) / SHA256_MESSAGE_BLOCK_SIZE + 2);
 }
 
+void SHA256Init(SHA256Context *ctx)
+{
+    memcpy(ctx->h, SHA256_H0, sizeof(ctx->h));
+    ctx->blockLen = 0;
+    ctx->msgLen = 0;
+}
+
+void SHA256Update(SHA256Context *ctx, const uint8_t *data, size_t len)
+{
+    ctx->msgLen += len;
+
+    // top up a partially filled block first
+    if (ctx->blockLen > 0)
+    {
+        size_t fill = SHA256_MESSAGE_BLOCK_SIZE - ctx->blockLen;
+        if (fill > len)
+            fill = len;
+        memcpy(&ctx->block[ctx->blockLen], data, fill);
+        ctx->blockLen += fill;
+        data += fill;
+        len -= fill;
+        if (ctx->blockLen < SHA256_MESSAGE_BLOCK_SIZE)
+            return;
+        sha256Blocks(ctx->h, ctx->block, 1);
+        ctx->blockLen = 0;
+    }
+
+    // whole blocks are compressed straight from the caller's buffer
+    size_t numBlocks = len / SHA256_MESSAGE_BLOCK_SIZE;
+    sha256Blocks(ctx->h, data, numBlocks);
+    data += numBlocks * SHA256_MESSAGE_BLOCK_SIZE;
+    len -= numBlocks * SHA256_MESSAGE_BLOCK_SIZE;
+
+    if (len > 0)
+    {
+        memcpy(ctx->block, data, len);
+        ctx->blockLen = len;
+    }
+}
+
+void SHA256Final(SHA256Context *ctx, uint8_t digest[SHA256_HASH_SIZE])
+{
+    // append a 1 bit, then zeros until there is room left for the 64 bit message length
+    uint8_t tail[2 * SHA256_MESSAGE_BLOCK_SIZE];
+    sha256Blocks(ctx->h, tail, padTail(tail, ctx->block, ctx->blockLen, ctx->msgLen));
+
+    for (int i = 0; i < SHA256_ARRAY_LEN; ++i)
+        storeBigEndian32(&digest[i * 4], ctx->h[i]);
+}
+
+int SHA256MidstateInit(SHA256Midstate *mid, const uint8_t *prefix, size_t len)
+{
+    if (len % SHA256_MESSAGE_BLOCK_SIZE != 0)
+        return 0;
+    memcpy(mid->h, SHA256_H0, sizeof(mid->h));
+    sha256Blocks(mid->h, prefix, len / SHA256_MESSAGE_BLOCK_SIZE);
+    mid->prefixLen = len;
+    return 1;
+}
+
+int SHA256GetMidstate(const SHA256Context *ctx, SHA256Midstate *mid)
+{
+    if (ctx->blockLen != 0)
+        return 0;
+    memcpy(mid->h, ctx->h, sizeof(mid->h));
+    mid->prefixLen = (uint64_t)ctx->msgLen;
+    return 1;
+}
+
+void SHA256InitFromMidstate(SHA256Context *ctx, const SHA256Midstate *mid)
+{
+    memcpy(ctx->h, mid->h, sizeof(ctx->h));
+    ctx->blockLen = 0;
+    ctx->msgLen = mid->prefixLen;
+}
+
+void SHA256MidstateHashInto(const SHA256Midstate *mid, const uint8_t *suffix, size_t len, uint8_t out[SHA256_HASH_SIZE])
+{
+    SHA256Context ctx;
+    SHA256InitFromMidstate(&ctx, mid);
+    SHA256Update(&ctx, suffix, len);
+    SHA256Final(&ctx, out);
+}
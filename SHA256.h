@@ -12,8 +12,45 @@
 
 // Message block size measured in bytes
 #define SHA256_MESSAGE_BLOCK_SIZE 64 
+#define SHA256_HASH_SIZE 32
 #define SHA256_ARRAY_LEN 8
 
+/// Implementations of the SHA256 block function. The fastest one the CPU supports is selected at
+/// startup and used by every SHA-256 entry point
+typedef enum SHA256Engine {
+    SHA256_ENGINE_SCALAR,   // portable C, fully unrolled
+    SHA256_ENGINE_SSSE3,    // SSSE3 message schedule, scalar rounds
+    SHA256_ENGINE_AVX2,     // AVX2 message schedule of two blocks at once, scalar rounds
+    SHA256_ENGINE_SHANI,    // x86 SHA extensions
+    SHA256_ENGINE_COUNT
+} SHA256Engine;
+
+/// Streaming hash state: the intermediate hash value plus at most one partial message block
+typedef struct SHA256Context {
+    uint32_t h[SHA256_ARRAY_LEN];
+    uint8_t block[SHA256_MESSAGE_BLOCK_SIZE];
+    size_t blockLen;
+    uint64_t msgLen;
+} SHA256Context;
+
+/// Intermediate hash value after a block aligned prefix. Messages that start with the prefix are finished
+/// from here, so the prefix is compressed once rather than once per message
+typedef struct SHA256Midstate {
+    uint32_t h[SHA256_ARRAY_LEN];
+    uint64_t prefixLen;
+} SHA256Midstate;
+
+/// Returns the engine currently used for SHA-256
+SHA256Engine SHA256GetEngine(void);
+
+/// Switches every SHA-256 entry point to the given engine. Threads hashing meanwhile pick up the switch
+/// from their next block function call on. Returns 0, leaving the current engine in place, if the engine
+/// is not supported by this CPU or build
+int SHA256SetEngine(SHA256Engine engine);
+
+/// Returns a short, human readable name of the engine
+const char *SHA256EngineName(SHA256Engine engine);
+
 /// Preprocesses the given message of len bytes
 PaddedMsg preprocess256(uint8_t *msg, size_t len);
 
@@ -23,4 +60,52 @@ uint32_t *get256Hash(PaddedMsg *p);
 /// Wrapper for hashing methods, up to caller to free the return value
 uint32_t *SHA256Hash(uint8_t *input, size_t len);
 
+/// Writes the digest of the len byte message at input into out, without allocating any memory
+void SHA256HashInto(const uint8_t *input, size_t len, uint8_t out[SHA256_HASH_SIZE]);
+
+/// Hashes n independent messages, writing the digest of msgs[i] into out[i]. Messages are hashed side by
+/// side in AVX-512 or AVX2 lanes when the CPU supports them, otherwise one after another
+void SHA256HashMany(const uint8_t **msgs, const size_t *lens, size_t n, uint8_t (*out)[SHA256_HASH_SIZE]);
+
+/// Writes the digest of the 64 byte message at input into out. The padding block that follows such a message
+/// is always the same, so its message schedule is precomputed instead of expanded on every call
+void SHA256Hash64Into(const uint8_t input[SHA256_MESSAGE_BLOCK_SIZE], uint8_t out[SHA256_HASH_SIZE]);
+
+/// SHA256Hash64Into for n messages stored back to back, hashed side by side in SIMD lanes like SHA256HashMany
+void SHA256Hash64Many(const uint8_t (*inputs)[SHA256_MESSAGE_BLOCK_SIZE], size_t n, uint8_t (*out)[SHA256_HASH_SIZE]);
+
+/// Writes SHA256d, the SHA-256 digest of the SHA-256 digest, of the len byte message at input into out.
+/// The second hash is a single block of the first digest and constant padding
+void SHA256dHashInto(const uint8_t *input, size_t len, uint8_t out[SHA256_HASH_SIZE]);
+
+/// SHA256dHashInto for n independent messages, hashed side by side in SIMD lanes like SHA256HashMany.
+/// Batches of 64 byte messages, such as Merkle node pairs, take the SHA256Hash64Into path for the first hash
+void SHA256dHashMany(const uint8_t **msgs, const size_t *lens, size_t n, uint8_t (*out)[SHA256_HASH_SIZE]);
+
+/// Prepares ctx to hash a new message
+void SHA256Init(SHA256Context *ctx);
+
+/// Absorbs the next len bytes of the message, compressing each block as soon as it is complete
+void SHA256Update(SHA256Context *ctx, const uint8_t *data, size_t len);
+
+/// Pads the message, compresses the final block(s) and writes the big endian digest
+void SHA256Final(SHA256Context *ctx, uint8_t digest[SHA256_HASH_SIZE]);
+
+/// Compresses the len byte prefix into mid. Returns 0 if len is not a multiple of SHA256_MESSAGE_BLOCK_SIZE
+int SHA256MidstateInit(SHA256Midstate *mid, const uint8_t *prefix, size_t len);
+
+/// Saves the state of ctx into mid. Returns 0 if the bytes absorbed so far do not end on a block boundary
+int SHA256GetMidstate(const SHA256Context *ctx, SHA256Midstate *mid);
+
+/// Prepares ctx to hash the rest of a message whose prefix was saved in mid
+void SHA256InitFromMidstate(SHA256Context *ctx, const SHA256Midstate *mid);
+
+/// Writes the digest of the prefix saved in mid followed by the len bytes at suffix
+void SHA256MidstateHashInto(const SHA256Midstate *mid, const uint8_t *suffix, size_t len, uint8_t out[SHA256_HASH_SIZE]);
+
+/// SHA256HashMany for messages that share the prefix saved in mid: writes the digest of the prefix
+/// followed by suffixes[i] into out[i]
+void SHA256MidstateHashMany(const SHA256Midstate *mid, const uint8_t **suffixes, const size_t *lens, size_t n,
+                            uint8_t (*out)[SHA256_HASH_SIZE]);
+
 #endif //__SHA512_H_
@@ -0,0 +1,565 @@
+// Multi-buffer SHA 256: hashes independent messages side by side, one message per SIMD lane
+// Each 32 bit lane of a vector register holds the working variables of a different message,
+// so every vector instruction advances the rounds of 8 (AVX2) or 16 (AVX-512) messages at once.
+
+#include <string.h>
+
+#include "SHA256.h"
+#include "SHAInternal.h"
+
+#ifdef SHA_HAVE_X86_SIMD
+#include <immintrin.h>
+#endif
+
+// Widest lane count supported by any kernel
+#define MAX_LANES 16
+
+// Transposed hash state: word i of the message in lane j is stored at state[i][j]
+typedef uint32_t LaneState[SHA256_ARRAY_LEN][MAX_LANES];
+
+// Compresses one block per lane, blocks[j] being the next 64 byte block of lane j
+typedef void (*ManyBlocksFn)(LaneState state, const uint8_t *blocks[MAX_LANES]);
+
+// Progress of the message currently assigned to a lane
+typedef struct Lane {
+    const uint8_t *data;    // next whole block of the message
+    size_t fullBlocks;      // whole blocks left to read straight from the message
+    size_t tailBlocks;      // padded blocks left to read from tail
+    const uint8_t *tailPtr;
+    size_t msgIndex;
+    uint8_t tail[2 * SHA256_MESSAGE_BLOCK_SIZE];
+} Lane;
+
+// Fed to lanes that have run out of messages; their results are discarded
+static const uint8_t idleBlock[SHA256_MESSAGE_BLOCK_SIZE];
+
+#ifdef SHA_HAVE_X86_SIMD
+
+// AVX2 versions of the SHA256 functions, operating on 8 lanes at once
+#define ADD8(x, y) _mm256_add_epi32(x, y)
+#define XOR8(x, y) _mm256_xor_si256(x, y)
+#define ROTR8(x, numBits) _mm256_or_si256(_mm256_srli_epi32(x, numBits), _mm256_slli_epi32(x, 32 - numBits))
+
+#define Ch8(x,y,z) XOR8(_mm256_and_si256(x, y), _mm256_andnot_si256(x, z))
+#define Maj8(x,y,z) XOR8(_mm256_and_si256(x, y), _mm256_and_si256(z, XOR8(x, y)))
+
+#define BigSigma0_8(x) XOR8(XOR8(ROTR8(x,2), ROTR8(x,13)), ROTR8(x,22))
+#define BigSigma1_8(x) XOR8(XOR8(ROTR8(x,6), ROTR8(x,11)), ROTR8(x,25))
+
+#define SmallSigma0_8(x) XOR8(XOR8(ROTR8(x,7), ROTR8(x,18)), _mm256_srli_epi32(x, 3))
+#define SmallSigma1_8(x) XOR8(XOR8(ROTR8(x,17), ROTR8(x,19)), _mm256_srli_epi32(x, 10))
+
+// AVX-512 versions, operating on 16 lanes at once. The ternary logic immediates encode
+// x ^ y ^ z (0x96), Ch (0xCA) and Maj (0xE8)
+#define ADD16(x, y) _mm512_add_epi32(x, y)
+#define XOR3_16(x, y, z) _mm512_ternarylogic_epi32(x, y, z, 0x96)
+
+#define Ch16(x,y,z) _mm512_ternarylogic_epi32(x, y, z, 0xCA)
+#define Maj16(x,y,z) _mm512_ternarylogic_epi32(x, y, z, 0xE8)
+
+#define BigSigma0_16(x) XOR3_16(_mm512_ror_epi32(x,2), _mm512_ror_epi32(x,13), _mm512_ror_epi32(x,22))
+#define BigSigma1_16(x) XOR3_16(_mm512_ror_epi32(x,6), _mm512_ror_epi32(x,11), _mm512_ror_epi32(x,25))
+
+#define SmallSigma0_16(x) XOR3_16(_mm512_ror_epi32(x,7), _mm512_ror_epi32(x,18), _mm512_srli_epi32(x, 3))
+#define SmallSigma1_16(x) XOR3_16(_mm512_ror_epi32(x,17), _mm512_ror_epi32(x,19), _mm512_srli_epi32(x, 10))
+
+// Loads words [offset, offset + 8) of the blocks of 8 lanes, converting them to host byte order,
+// and transposes them so that out[i] holds word offset + i of every lane
+__attribute__((target("avx2")))
+static inline void loadTransposed8(__m256i out[8], const uint8_t *const *blocks, int offset)
+{
+    const __m256i swap = _mm256_setr_epi8(3, 2, 1, 0, 7, 6, 5, 4, 11, 10, 9, 8, 15, 14, 13, 12,
+                                          3, 2, 1, 0, 7, 6, 5, 4, 11, 10, 9, 8, 15, 14, 13, 12);
+    __m256i r[8], t[8], u[8];
+    for (int i = 0; i < 8; ++i)
+        r[i] = _mm256_shuffle_epi8(_mm256_loadu_si256((const __m256i*)&blocks[i][offset * 4]), swap);
+
+    for (int i = 0; i < 8; i += 2)
+    {
+        t[i] = _mm256_unpacklo_epi32(r[i], r[i + 1]);
+        t[i + 1] = _mm256_unpackhi_epi32(r[i], r[i + 1]);
+    }
+    for (int i = 0; i < 8; i += 4)
+    {
+        u[i] = _mm256_unpacklo_epi64(t[i], t[i + 2]);
+        u[i + 1] = _mm256_unpackhi_epi64(t[i], t[i + 2]);
+        u[i + 2] = _mm256_unpacklo_epi64(t[i + 1], t[i + 3]);
+        u[i + 3] = _mm256_unpackhi_epi64(t[i + 1], t[i + 3]);
+    }
+    for (int i = 0; i < 4; ++i)
+    {
+        out[i] = _mm256_permute2x128_si256(u[i], u[i + 4], 0x20);
+        out[i + 4] = _mm256_permute2x128_si256(u[i], u[i + 4], 0x31);
+    }
+}
+
+// Runs the 64 rounds on the hash values of 8 lanes in reg, expanding the message schedule in w on the fly
+__attribute__((target("avx2")))
+static inline void rounds8(__m256i reg[SHA256_ARRAY_LEN], __m256i w[16])
+{
+    __m256i a = reg[0], b = reg[1], c = reg[2], d = reg[3], e = reg[4], f = reg[5], g = reg[6], h = reg[7];
+
+    for (int j = 0; j < 64; ++j)
+    {
+        // the message schedule is computed on the fly in a rolling window of 16 words
+        if (j >= 16)
+            w[j & 15] = ADD8(ADD8(SmallSigma1_8(w[(j - 2) & 15]), w[(j - 7) & 15]),
+                             ADD8(SmallSigma0_8(w[(j - 15) & 15]), w[j & 15]));
+
+        __m256i T1 = ADD8(ADD8(h, BigSigma1_8(e)), ADD8(Ch8(e, f, g), ADD8(_mm256_set1_epi32((int)SHA256_K[j]), w[j & 15])));
+        __m256i T2 = ADD8(BigSigma0_8(a), Maj8(a, b, c));
+        h = g;
+        g = f;
+        f = e;
+        e = ADD8(d, T1);
+        d = c;
+        c = b;
+        b = a;
+        a = ADD8(T1, T2);
+    }
+
+    reg[0] = ADD8(reg[0], a); reg[1] = ADD8(reg[1], b); reg[2] = ADD8(reg[2], c); reg[3] = ADD8(reg[3], d);
+    reg[4] = ADD8(reg[4], e); reg[5] = ADD8(reg[5], f); reg[6] = ADD8(reg[6], g); reg[7] = ADD8(reg[7], h);
+}
+
+// Runs the 64 rounds on the hash values of 8 lanes whose blocks share the given, precomputed message schedule
+__attribute__((target("avx2")))
+static inline void roundsScheduled8(__m256i reg[SHA256_ARRAY_LEN], const uint32_t schedule[64])
+{
+    __m256i a = reg[0], b = reg[1], c = reg[2], d = reg[3], e = reg[4], f = reg[5], g = reg[6], h = reg[7];
+
+    for (int j = 0; j < 64; ++j)
+    {
+        __m256i T1 = ADD8(ADD8(h, BigSigma1_8(e)), ADD8(Ch8(e, f, g), _mm256_set1_epi32((int)(SHA256_K[j] + schedule[j]))));
+        __m256i T2 = ADD8(BigSigma0_8(a), Maj8(a, b, c));
+        h = g;
+        g = f;
+        f = e;
+        e = ADD8(d, T1);
+        d = c;
+        c = b;
+        b = a;
+        a = ADD8(T1, T2);
+    }
+
+    reg[0] = ADD8(reg[0], a); reg[1] = ADD8(reg[1], b); reg[2] = ADD8(reg[2], c); reg[3] = ADD8(reg[3], d);
+    reg[4] = ADD8(reg[4], e); reg[5] = ADD8(reg[5], f); reg[6] = ADD8(reg[6], g); reg[7] = ADD8(reg[7], h);
+}
+
+// 8 lane SHA256 compression function
+__attribute__((target("avx2")))
+static void sha256x8(LaneState state, const uint8_t *blocks[MAX_LANES])
+{
+    __m256i w[16];
+    loadTransposed8(&w[0], blocks, 0);
+    loadTransposed8(&w[8], blocks, 8);
+
+    __m256i reg[SHA256_ARRAY_LEN];
+    for (int i = 0; i < SHA256_ARRAY_LEN; ++i)
+        reg[i] = _mm256_loadu_si256((const __m256i*)&state[i][0]);
+    rounds8(reg, w);
+    for (int i = 0; i < SHA256_ARRAY_LEN; ++i)
+        _mm256_storeu_si256((__m256i*)&state[i][0], reg[i]);
+}
+
+// Hashes a 64 byte message per lane into state: the message block, then the padding block, whose schedule is
+// the same for every lane and precomputed
+__attribute__((target("avx2")))
+static void sha256x8Hash64(LaneState state, const uint8_t *blocks[MAX_LANES])
+{
+    __m256i w[16];
+    loadTransposed8(&w[0], blocks, 0);
+    loadTransposed8(&w[8], blocks, 8);
+
+    __m256i reg[SHA256_ARRAY_LEN];
+    for (int i = 0; i < SHA256_ARRAY_LEN; ++i)
+        reg[i] = _mm256_set1_epi32((int)SHA256_H0[i]);
+    rounds8(reg, w);
+    roundsScheduled8(reg, SHA256_PAD64_SCHEDULE);
+    for (int i = 0; i < SHA256_ARRAY_LEN; ++i)
+        _mm256_storeu_si256((__m256i*)&state[i][0], reg[i]);
+}
+
+// Hashes a 32 byte message per lane into state. Its single block is the message followed by constant
+// padding words, which are set directly instead of being loaded
+__attribute__((target("avx2")))
+static void sha256x8Hash32(LaneState state, const uint8_t *blocks[MAX_LANES])
+{
+    __m256i w[16];
+    loadTransposed8(&w[0], blocks, 0);
+    w[8] = _mm256_set1_epi32((int)0x80000000);
+    for (int i = 9; i < 15; ++i)
+        w[i] = _mm256_setzero_si256();
+    w[15] = _mm256_set1_epi32(SHA256_HASH_SIZE * 8);
+
+    __m256i reg[SHA256_ARRAY_LEN];
+    for (int i = 0; i < SHA256_ARRAY_LEN; ++i)
+        reg[i] = _mm256_set1_epi32((int)SHA256_H0[i]);
+    rounds8(reg, w);
+    for (int i = 0; i < SHA256_ARRAY_LEN; ++i)
+        _mm256_storeu_si256((__m256i*)&state[i][0], reg[i]);
+}
+
+// Loads words [offset, offset + 8) of the blocks of 16 lanes into w[offset..offset + 8), see loadTransposed8
+__attribute__((target("avx512f")))
+static inline void loadTransposed16(__m512i w[16], const uint8_t *const *blocks, int offset)
+{
+    __m256i lo[8], hi[8];
+    loadTransposed8(lo, &blocks[0], offset);
+    loadTransposed8(hi, &blocks[8], offset);
+    for (int i = 0; i < 8; ++i)
+        w[offset + i] = _mm512_inserti64x4(_mm512_castsi256_si512(lo[i]), hi[i], 1);
+}
+
+// 16 lane versions of rounds8 and roundsScheduled8
+__attribute__((target("avx512f")))
+static inline void rounds16(__m512i reg[SHA256_ARRAY_LEN], __m512i w[16])
+{
+    __m512i a = reg[0], b = reg[1], c = reg[2], d = reg[3], e = reg[4], f = reg[5], g = reg[6], h = reg[7];
+
+    for (int j = 0; j < 64; ++j)
+    {
+        if (j >= 16)
+            w[j & 15] = ADD16(ADD16(SmallSigma1_16(w[(j - 2) & 15]), w[(j - 7) & 15]),
+                              ADD16(SmallSigma0_16(w[(j - 15) & 15]), w[j & 15]));
+
+        __m512i T1 = ADD16(ADD16(h, BigSigma1_16(e)), ADD16(Ch16(e, f, g), ADD16(_mm512_set1_epi32((int)SHA256_K[j]), w[j & 15])));
+        __m512i T2 = ADD16(BigSigma0_16(a), Maj16(a, b, c));
+        h = g;
+        g = f;
+        f = e;
+        e = ADD16(d, T1);
+        d = c;
+        c = b;
+        b = a;
+        a = ADD16(T1, T2);
+    }
+
+    reg[0] = ADD16(reg[0], a); reg[1] = ADD16(reg[1], b); reg[2] = ADD16(reg[2], c); reg[3] = ADD16(reg[3], d);
+    reg[4] = ADD16(reg[4], e); reg[5] = ADD16(reg[5], f); reg[6] = ADD16(reg[6], g); reg[7] = ADD16(reg[7], h);
+}
+
+__attribute__((target("avx512f")))
+static inline void roundsScheduled16(__m512i reg[SHA256_ARRAY_LEN], const uint32_t schedule[64])
+{
+    __m512i a = reg[0], b = reg[1], c = reg[2], d = reg[3], e = reg[4], f = reg[5], g = reg[6], h = reg[7];
+
+    for (int j = 0; j < 64; ++j)
+    {
+        __m512i T1 = ADD16(ADD16(h, BigSigma1_16(e)), ADD16(Ch16(e, f, g), _mm512_set1_epi32((int)(SHA256_K[j] + schedule[j]))));
+        __m512i T2 = ADD16(BigSigma0_16(a), Maj16(a, b, c));
+        h = g;
+        g = f;
+        f = e;
+        e = ADD16(d, T1);
+        d = c;
+        c = b;
+        b = a;
+        a = ADD16(T1, T2);
+    }
+
+    reg[0] = ADD16(reg[0], a); reg[1] = ADD16(reg[1], b); reg[2] = ADD16(reg[2], c); reg[3] = ADD16(reg[3], d);
+    reg[4] = ADD16(reg[4], e); reg[5] = ADD16(reg[5], f); reg[6] = ADD16(reg[6], g); reg[7] = ADD16(reg[7], h);
+}
+
+// 16 lane SHA256 compression function
+__attribute__((target("avx512f")))
+static void sha256x16(LaneState state, const uint8_t *blocks[MAX_LANES])
+{
+    __m512i w[16];
+    loadTransposed16(w, blocks, 0);
+    loadTransposed16(w, blocks, 8);
+
+    __m512i reg[SHA256_ARRAY_LEN];
+    for (int i = 0; i < SHA256_ARRAY_LEN; ++i)
+        reg[i] = _mm512_loadu_si512(&state[i][0]);
+    rounds16(reg, w);
+    for (int i = 0; i < SHA256_ARRAY_LEN; ++i)
+        _mm512_storeu_si512(&state[i][0], reg[i]);
+}
+
+// 16 lane versions of sha256x8Hash64 and sha256x8Hash32
+__attribute__((target("avx512f")))
+static void sha256x16Hash64(LaneState state, const uint8_t *blocks[MAX_LANES])
+{
+    __m512i w[16];
+    loadTransposed16(w, blocks, 0);
+    loadTransposed16(w, blocks, 8);
+
+    __m512i reg[SHA256_ARRAY_LEN];
+    for (int i = 0; i < SHA256_ARRAY_LEN; ++i)
+        reg[i] = _mm512_set1_epi32((int)SHA256_H0[i]);
+    rounds16(reg, w);
+    roundsScheduled16(reg, SHA256_PAD64_SCHEDULE);
+    for (int i = 0; i < SHA256_ARRAY_LEN; ++i)
+        _mm512_storeu_si512(&state[i][0], reg[i]);
+}
+
+__attribute__((target("avx512f")))
+static void sha256x16Hash32(LaneState state, const uint8_t *blocks[MAX_LANES])
+{
+    __m512i w[16];
+    loadTransposed16(w, blocks, 0);
+    w[8] = _mm512_set1_epi32((int)0x80000000);
+    for (int i = 9; i < 15; ++i)
+        w[i] = _mm512_setzero_si512();
+    w[15] = _mm512_set1_epi32(SHA256_HASH_SIZE * 8);
+
+    __m512i reg[SHA256_ARRAY_LEN];
+    for (int i = 0; i < SHA256_ARRAY_LEN; ++i)
+        reg[i] = _mm512_set1_epi32((int)SHA256_H0[i]);
+    rounds16(reg, w);
+    for (int i = 0; i < SHA256_ARRAY_LEN; ++i)
+        _mm512_storeu_si512(&state[i][0], reg[i]);
+}
+
+#endif //SHA_HAVE_X86_SIMD
+
+// Assigns message msgIndex to the lane, starting from the intermediate hash value iv that
+// already covers prefixLen bytes
+static void laneLoad(Lane *lane, LaneState state, int laneNum, const uint32_t iv[SHA256_ARRAY_LEN],
+                     uint64_t prefixLen, const uint8_t *msg, size_t len, size_t msgIndex)
+{
+    size_t rem = len % SHA256_MESSAGE_BLOCK_SIZE;
+
+    lane->data = msg;
+    lane->fullBlocks = len / SHA256_MESSAGE_BLOCK_SIZE;
+    lane->msgIndex = msgIndex;
+
+    // the last partial block, the 1 bit, zeros and the 64 bit length fill one or two blocks
+    lane->tailBlocks = (rem + 9 > SHA256_MESSAGE_BLOCK_SIZE) ? 2 : 1;
+    lane->tailPtr = lane->tail;
+    memset(lane->tail, 0, sizeof(lane->tail));
+    if (rem > 0)
+        memcpy(lane->tail, &msg[len - rem], rem);
+    lane->tail[rem] = 0x80;
+    storeBigEndian64(&lane->tail[lane->tailBlocks * SHA256_MESSAGE_BLOCK_SIZE - 8], (prefixLen + len) * 8);
+
+    for (int i = 0; i < SHA256_ARRAY_LEN; ++i)
+        state[i][laneNum] = iv[i];
+}
+
+// Returns the next block of the lane's padded message
+static const uint8_t *laneNextBlock(Lane *lane)
+{
+    const uint8_t *block;
+    if (lane->fullBlocks > 0)
+    {
+        block = lane->data;
+        lane->data += SHA256_MESSAGE_BLOCK_SIZE;
+        --lane->fullBlocks;
+    }
+    else
+    {
+        block = lane->tailPtr;
+        lane->tailPtr += SHA256_MESSAGE_BLOCK_SIZE;
+        --lane->tailBlocks;
+    }
+    return block;
+}
+
+// Hashes every message with a numLanes wide kernel. Whenever a lane finishes its message it
+// is refilled with the next pending one, so messages of different lengths keep the lanes busy.
+static void hashManyLanes(ManyBlocksFn kernel, int numLanes, const uint32_t iv[SHA256_ARRAY_LEN], uint64_t prefixLen,
+                          const uint8_t **msgs, const size_t *lens, size_t n, uint8_t (*out)[SHA256_HASH_SIZE])
+{
+    Lane lanes[MAX_LANES];
+    LaneState state;
+    const uint8_t *blocks[MAX_LANES];
+    int busy[MAX_LANES];
+    int active = 0;
+    size_t next = 0;
+    SHA_STATS_BEGIN(start);
+
+    for (int j = 0; j < numLanes; ++j)
+    {
+        busy[j] = next < n;
+        if (busy[j])
+        {
+            laneLoad(&lanes[j], state, j, iv, prefixLen, msgs[next], lens[next], next);
+            ++next;
+            ++active;
+        }
+    }
+
+    while (active > 0)
+    {
+        // a single straggler is cheaper to finish with the scalar compression function
+        if (active == 1 && next == n)
+            break;
+
+        for (int j = 0; j < numLanes; ++j)
+            blocks[j] = busy[j] ? laneNextBlock(&lanes[j]) : idleBlock;
+
+        kernel(state, blocks);
+
+        for (int j = 0; j < numLanes; ++j)
+        {
+            if (!busy[j] || lanes[j].fullBlocks > 0 || lanes[j].tailBlocks > 0)
+                continue;
+
+            for (int i = 0; i < SHA256_ARRAY_LEN; ++i)
+                storeBigEndian32(&out[lanes[j].msgIndex][i * 4], state[i][j]);
+
+            if (next < n)
+            {
+                laneLoad(&lanes[j], state, j, iv, prefixLen, msgs[next], lens[next], next);
+                ++next;
+            }
+            else
+            {
+                busy[j] = 0;
+                --active;
+            }
+        }
+    }
+
+    for (int j = 0; j < numLanes; ++j)
+    {
+        if (!busy[j])
+            continue;
+
+        uint32_t h[SHA256_ARRAY_LEN];
+        for (int i = 0; i < SHA256_ARRAY_LEN; ++i)
+            h[i] = state[i][j];
+        sha256Blocks(h, lanes[j].data, lanes[j].fullBlocks);
+        sha256Blocks(h, lanes[j].tailPtr, lanes[j].tailBlocks);
+        for (int i = 0; i < SHA256_ARRAY_LEN; ++i)
+            storeBigEndian32(&out[lanes[j].msgIndex][i * 4], h[i]);
+    }
+
+#ifdef SHA_STATS
+    uint64_t bytes = 0, numBlocks = 0;
+    for (size_t i = 0; i < n; ++i)
+    {
+        bytes += lens[i];
+        numBlocks += (lens[i] + 8) / 64 + 1;
+    }
+    SHA_STATS_END(SHA_STATS_SHA256_MANY, start, bytes, numBlocks);
+#endif
+}
+
+void SHA256MidstateHashMany(const SHA256Midstate *mid, const uint8_t **suffixes, const size_t *lens, size_t n,
+                            uint8_t (*out)[SHA256_HASH_SIZE])
+{
+#ifdef SHA_HAVE_X86_SIMD
+    if (n > 1 && __builtin_cpu_supports("avx512f"))
+    {
+        hashManyLanes(sha256x16, 16, mid->h, mid->prefixLen, suffixes, lens, n, out);
+        return;
+    }
+    // eight AVX2 lanes do not keep up with the SHA extensions hashing one message at a time
+    if (n > 1 && __builtin_cpu_supports("avx2") && SHA256GetEngine() != SHA256_ENGINE_SHANI)
+    {
+        hashManyLanes(sha256x8, 8, mid->h, mid->prefixLen, suffixes, lens, n, out);
+        return;
+    }
+#endif
+
+    for (size_t i = 0; i < n; ++i)
+        SHA256MidstateHashInto(mid, suffixes[i], lens[i], out[i]);
+}
+
+void SHA256HashMany(const uint8_t **msgs, const size_t *lens, size_t n, uint8_t (*out)[SHA256_HASH_SIZE])
+{
+    SHA256Midstate initial;
+    memcpy(initial.h, SHA256_H0, sizeof(initial.h));
+    initial.prefixLen = 0;
+    SHA256MidstateHashMany(&initial, msgs, lens, n, out);
+}
+
+// Hashes n messages of a fixed size, numLanes at a time, with a kernel that hashes one whole message per lane.
+// Message i is msgs[i], or if msgs is NULL the one at base + i * stride. out may overlap the messages, as
+// every message of a group is loaded before its digests are written
+static void hashFixedLanes(ManyBlocksFn kernel, int numLanes, const uint8_t *const *msgs, const uint8_t *base,
+                           size_t stride, size_t n, uint8_t (*out)[SHA256_HASH_SIZE])
+{
+    LaneState state;
+    const uint8_t *blocks[MAX_LANES];
+    SHA_STATS_BEGIN(start);
+
+    for (size_t first = 0; first < n; first += numLanes)
+    {
+        size_t count = (n - first < (size_t)numLanes) ? n - first : (size_t)numLanes;
+        for (int j = 0; j < numLanes; ++j)
+        {
+            if ((size_t)j >= count)
+                blocks[j] = idleBlock;
+            else
+                blocks[j] = (msgs != NULL) ? msgs[first + j] : &base[(first + j) * stride];
+        }
+
+        kernel(state, blocks);
+
+        for (size_t j = 0; j < count; ++j)
+        {
+            for (int i = 0; i < SHA256_ARRAY_LEN; ++i)
+                storeBigEndian32(&out[first + j][i * 4], state[i][j]);
+        }
+    }
+
+    SHA_STATS_END(SHA_STATS_SHA256_MANY, start, n * stride, (stride == SHA256_MESSAGE_BLOCK_SIZE) ? 2 * n : n);
+}
+
+// Selects the kernels for hashing n fixed size messages, with the same rules as SHA256MidstateHashMany.
+// Returns the number of lanes, or 0 if the messages are better hashed one at a time
+static int fixedKernels(size_t n, ManyBlocksFn *hash64, ManyBlocksFn *hash32)
+{
+#ifdef SHA_HAVE_X86_SIMD
+    if (n > 1 && __builtin_cpu_supports("avx512f"))
+    {
+        *hash64 = sha256x16Hash64;
+        *hash32 = sha256x16Hash32;
+        return 16;
+    }
+    if (n > 1 && __builtin_cpu_supports("avx2") && SHA256GetEngine() != SHA256_ENGINE_SHANI)
+    {
+        *hash64 = sha256x8Hash64;
+        *hash32 = sha256x8Hash32;
+        return 8;
+    }
+#else
+    (void)n;
+    (void)hash64;
+    (void)hash32;
+#endif
+    return 0;
+}
+
+void SHA256Hash64Many(const uint8_t (*inputs)[SHA256_MESSAGE_BLOCK_SIZE], size_t n, uint8_t (*out)[SHA256_HASH_SIZE])
+{
+    ManyBlocksFn hash64, hash32;
+    int numLanes = fixedKernels(n, &hash64, &hash32);
+    if (numLanes > 0)
+    {
+        hashFixedLanes(hash64, numLanes, NULL, inputs[0], SHA256_MESSAGE_BLOCK_SIZE, n, out);
+        return;
+    }
+
+    for (size_t i = 0; i < n; ++i)
+        SHA256Hash64Into(inputs[i], out[i]);
+}
+
+void SHA256dHashMany(const uint8_t **msgs, const size_t *lens, size_t n, uint8_t (*out)[SHA256_HASH_SIZE])
+{
+    ManyBlocksFn hash64, hash32;
+    int numLanes = fixedKernels(n, &hash64, &hash32);
+    if (numLanes == 0)
+    {
+        for (size_t i = 0; i < n; ++i)
+            SHA256dHashInto(msgs[i], lens[i], out[i]);
+        return;
+    }
+
+    // the first hash; pairs of 64 byte digests, as in Merkle trees, skip the generic padding
+    int all64 = 1;
+    for (size_t i = 0; i < n && all64; ++i)
+        all64 = lens[i] == SHA256_MESSAGE_BLOCK_SIZE;
+    if (all64)
+        hashFixedLanes(hash64, numLanes, msgs, NULL, SHA256_MESSAGE_BLOCK_SIZE, n, out);
+    else
+        SHA256HashMany(msgs, lens, n, out);
+
+    // the second hash, of each digest in place
+    hashFixedLanes(hash32, numLanes, NULL, out[0], SHA256_HASH_SIZE, n, out);
+}
@@ -0,0 +1,218 @@
+// x86 implementations of the SHA256 block function, selected at startup by the dispatcher in SHA256.c
+//  - SSSE3: computes the message schedule four words at a time in SSE registers, rounds stay scalar
+//  - AVX2:  computes the schedules of two blocks at once, one per 128 bit half of a YMM register
+//  - SHA-NI: runs the whole compression function on the SHA256RNDS2/SHA256MSG1/SHA256MSG2 instructions
+
+#include "SHA256.h"
+#include "SHAInternal.h"
+
+#ifdef SHA_HAVE_X86_SIMD
+
+#include <cpuid.h>
+#include <immintrin.h>
+
+// Utility functions
+// Rotate x to the right by numBits
+#define ROTR(x, numBits) ( (x >> numBits) | (x << (32 - numBits)) )
+
+// Compression functions
+#define Ch(x,y,z) ( (x & y) ^ ((~x) & z) )
+#define Maj(x,y,z) ( (x & y) ^ (x & z) ^ (y & z) )
+
+#define BigSigma0(x) ( ROTR(x,2) ^ ROTR(x,13) ^ ROTR(x,22) )
+#define BigSigma1(x) ( ROTR(x,6) ^ ROTR(x,11) ^ ROTR(x,25) )
+
+// SSE versions of the message schedule functions, applied to four words at once
+#define ROTR4(x, numBits) _mm_or_si128(_mm_srli_epi32(x, numBits), _mm_slli_epi32(x, 32 - numBits))
+#define SmallSigma0_4(x) _mm_xor_si128(_mm_xor_si128(ROTR4(x,7), ROTR4(x,18)), _mm_srli_epi32(x, 3))
+#define SmallSigma1_4(x) _mm_xor_si128(_mm_xor_si128(ROTR4(x,17), ROTR4(x,19)), _mm_srli_epi32(x, 10))
+
+// AVX2 versions, applied to four words of each of two blocks at once
+#define ROTR8(x, numBits) _mm256_or_si256(_mm256_srli_epi32(x, numBits), _mm256_slli_epi32(x, 32 - numBits))
+#define SmallSigma0_8(x) _mm256_xor_si256(_mm256_xor_si256(ROTR8(x,7), ROTR8(x,18)), _mm256_srli_epi32(x, 3))
+#define SmallSigma1_8(x) _mm256_xor_si256(_mm256_xor_si256(ROTR8(x,17), ROTR8(x,19)), _mm256_srli_epi32(x, 10))
+
+// Runs the 64 rounds over a precomputed schedule wk[j] = W[j] + K[j]
+static inline void rounds(uint32_t h[SHA256_ARRAY_LEN], const uint32_t wk[64])
+{
+    uint32_t a = h[0], b = h[1], c = h[2], d = h[3], e = h[4], f = h[5], g = h[6], hh = h[7];
+    for (int j = 0; j < 64; ++j)
+    {
+        uint32_t T1 = hh + BigSigma1(e) + Ch(e, f, g) + wk[j];
+        uint32_t T2 = BigSigma0(a) + Maj(a, b, c);
+        hh = g;
+        g = f;
+        f = e;
+        e = d + T1;
+        d = c;
+        c = b;
+        b = a;
+        a = T1 + T2;
+    }
+    h[0] += a; h[1] += b; h[2] += c; h[3] += d; h[4] += e; h[5] += f; h[6] += g; h[7] += hh;
+}
+
+// Computes W[t..t+3] from the four preceding groups of four schedule words. Words t and t + 1
+// depend on W[t - 2] and W[t - 1], words t + 2 and t + 3 on the just computed W[t] and W[t + 1].
+#define SCHEDULE4(v0, v1, v2, v3, out)                                                              \
+    do {                                                                                            \
+        __m128i x = _mm_add_epi32(_mm_add_epi32(v0, SmallSigma0_4(_mm_alignr_epi8(v1, v0, 4))),     \
+                                  _mm_alignr_epi8(v3, v2, 4));                                      \
+        x = _mm_add_epi32(x, _mm_move_epi64(SmallSigma1_4(_mm_shuffle_epi32(v3, 0xEE))));           \
+        out = _mm_add_epi32(x, _mm_slli_si128(SmallSigma1_4(_mm_shuffle_epi32(x, 0x44)), 8));       \
+    } while (0)
+
+#define SCHEDULE8(v0, v1, v2, v3, out)                                                                  \
+    do {                                                                                                \
+        __m256i x = _mm256_add_epi32(_mm256_add_epi32(v0, SmallSigma0_8(_mm256_alignr_epi8(v1, v0, 4))), \
+                                     _mm256_alignr_epi8(v3, v2, 4));                                    \
+        x = _mm256_add_epi32(x, _mm256_blend_epi32(_mm256_setzero_si256(),                              \
+                                                   SmallSigma1_8(_mm256_shuffle_epi32(v3, 0xEE)), 0x33)); \
+        out = _mm256_add_epi32(x, _mm256_slli_si256(SmallSigma1_8(_mm256_shuffle_epi32(x, 0x44)), 8));  \
+    } while (0)
+
+__attribute__((target("ssse3")))
+void sha256BlocksSSSE3(uint32_t h[SHA256_ARRAY_LEN], const uint8_t *blocks, size_t numBlocks)
+{
+    const __m128i swap = _mm_setr_epi8(3, 2, 1, 0, 7, 6, 5, 4, 11, 10, 9, 8, 15, 14, 13, 12);
+    uint32_t wk[64];
+
+    for (size_t n = 0; n < numBlocks; ++n, blocks += SHA256_MESSAGE_BLOCK_SIZE)
+    {
+        __m128i w[16];
+        for (int i = 0; i < 4; ++i)
+            w[i] = _mm_shuffle_epi8(_mm_loadu_si128((const __m128i*)&blocks[i * 16]), swap);
+        for (int i = 4; i < 16; ++i)
+            SCHEDULE4(w[i - 4], w[i - 3], w[i - 2], w[i - 1], w[i]);
+        for (int i = 0; i < 16; ++i)
+            _mm_storeu_si128((__m128i*)&wk[i * 4], _mm_add_epi32(w[i], _mm_loadu_si128((const __m128i*)&SHA256_K[i * 4])));
+
+        rounds(h, wk);
+    }
+}
+
+__attribute__((target("avx2")))
+void sha256BlocksAVX2(uint32_t h[SHA256_ARRAY_LEN], const uint8_t *blocks, size_t numBlocks)
+{
+    const __m256i swap = _mm256_setr_epi8(3, 2, 1, 0, 7, 6, 5, 4, 11, 10, 9, 8, 15, 14, 13, 12,
+                                          3, 2, 1, 0, 7, 6, 5, 4, 11, 10, 9, 8, 15, 14, 13, 12);
+    uint32_t wk[2][64];
+
+    for (; numBlocks >= 2; numBlocks -= 2, blocks += 2 * SHA256_MESSAGE_BLOCK_SIZE)
+    {
+        // the low half of each register holds the first block's words, the high half the second's
+        __m256i w[16];
+        for (int i = 0; i < 4; ++i)
+        {
+            __m256i x = _mm256_inserti128_si256(
+                _mm256_castsi128_si256(_mm_loadu_si128((const __m128i*)&blocks[i * 16])),
+                _mm_loadu_si128((const __m128i*)&blocks[SHA256_MESSAGE_BLOCK_SIZE + i * 16]), 1);
+            w[i] = _mm256_shuffle_epi8(x, swap);
+        }
+        for (int i = 4; i < 16; ++i)
+            SCHEDULE8(w[i - 4], w[i - 3], w[i - 2], w[i - 1], w[i]);
+        for (int i = 0; i < 16; ++i)
+        {
+            __m256i x = _mm256_add_epi32(w[i], _mm256_broadcastsi128_si256(_mm_loadu_si128((const __m128i*)&SHA256_K[i * 4])));
+            _mm_storeu_si128((__m128i*)&wk[0][i * 4], _mm256_castsi256_si128(x));
+            _mm_storeu_si128((__m128i*)&wk[1][i * 4], _mm256_extracti128_si256(x, 1));
+        }
+
+        rounds(h, wk[0]);
+        rounds(h, wk[1]);
+    }
+
+    if (numBlocks > 0)
+        sha256BlocksSSSE3(h, blocks, numBlocks);
+}
+
+// SHA256RNDS2 expects the state split into ABEF (state0) and CDGH (state1)
+__attribute__((target("sha,sse4.1")))
+static inline void loadStateSHANI(const uint32_t h[SHA256_ARRAY_LEN], __m128i *state0, __m128i *state1)
+{
+    __m128i tmp = _mm_shuffle_epi32(_mm_loadu_si128((const __m128i*)&h[0]), 0xB1);
+    __m128i cdgh = _mm_shuffle_epi32(_mm_loadu_si128((const __m128i*)&h[4]), 0x1B);
+    *state0 = _mm_alignr_epi8(tmp, cdgh, 8);
+    *state1 = _mm_blend_epi16(cdgh, tmp, 0xF0);
+}
+
+__attribute__((target("sha,sse4.1")))
+static inline void storeStateSHANI(uint32_t h[SHA256_ARRAY_LEN], __m128i state0, __m128i state1)
+{
+    __m128i tmp = _mm_shuffle_epi32(state0, 0x1B);
+    state1 = _mm_shuffle_epi32(state1, 0xB1);
+    _mm_storeu_si128((__m128i*)&h[0], _mm_blend_epi16(tmp, state1, 0xF0));
+    _mm_storeu_si128((__m128i*)&h[4], _mm_alignr_epi8(state1, tmp, 8));
+}
+
+__attribute__((target("sha,sse4.1")))
+void sha256BlocksSHANI(uint32_t h[SHA256_ARRAY_LEN], const uint8_t *blocks, size_t numBlocks)
+{
+    const __m128i swap = _mm_setr_epi8(3, 2, 1, 0, 7, 6, 5, 4, 11, 10, 9, 8, 15, 14, 13, 12);
+    __m128i state0, state1;
+    loadStateSHANI(h, &state0, &state1);
+
+    for (size_t n = 0; n < numBlocks; ++n, blocks += SHA256_MESSAGE_BLOCK_SIZE)
+    {
+        __m128i abefSave = state0;
+        __m128i cdghSave = state1;
+        __m128i msg[4];
+
+        // each group of 4 rounds consumes msg[g % 4], then helps expand the schedule for later groups
+#pragma GCC unroll 16
+        for (int g = 0; g < 16; ++g)
+        {
+            if (g < 4)
+                msg[g] = _mm_shuffle_epi8(_mm_loadu_si128((const __m128i*)&blocks[g * 16]), swap);
+
+            __m128i wk = _mm_add_epi32(msg[g % 4], _mm_loadu_si128((const __m128i*)&SHA256_K[g * 4]));
+            state1 = _mm_sha256rnds2_epu32(state1, state0, wk);
+            if (g >= 3 && g <= 14)
+            {
+                __m128i next = _mm_add_epi32(msg[(g + 1) % 4], _mm_alignr_epi8(msg[g % 4], msg[(g + 3) % 4], 4));
+                msg[(g + 1) % 4] = _mm_sha256msg2_epu32(next, msg[g % 4]);
+            }
+            state0 = _mm_sha256rnds2_epu32(state0, state1, _mm_shuffle_epi32(wk, 0x0E));
+            if (g >= 1 && g <= 12)
+                msg[(g + 3) % 4] = _mm_sha256msg1_epu32(msg[(g + 3) % 4], msg[g % 4]);
+        }
+
+        state0 = _mm_add_epi32(state0, abefSave);
+        state1 = _mm_add_epi32(state1, cdghSave);
+    }
+
+    storeStateSHANI(h, state0, state1);
+}
+
+// With the schedule known, each group of 4 rounds is just its two SHA256RNDS2 instructions
+__attribute__((target("sha,sse4.1")))
+void sha256ScheduledSHANI(uint32_t h[SHA256_ARRAY_LEN], const uint32_t schedule[64])
+{
+    __m128i state0, state1;
+    loadStateSHANI(h, &state0, &state1);
+    __m128i abefSave = state0;
+    __m128i cdghSave = state1;
+
+#pragma GCC unroll 16
+    for (int g = 0; g < 16; ++g)
+    {
+        __m128i wk = _mm_add_epi32(_mm_loadu_si128((const __m128i*)&schedule[g * 4]),
+                                   _mm_loadu_si128((const __m128i*)&SHA256_K[g * 4]));
+        state1 = _mm_sha256rnds2_epu32(state1, state0, wk);
+        state0 = _mm_sha256rnds2_epu32(state0, state1, _mm_shuffle_epi32(wk, 0x0E));
+    }
+
+    storeStateSHANI(h, _mm_add_epi32(state0, abefSave), _mm_add_epi32(state1, cdghSave));
+}
+
+int sha256CpuHasSHANI(void)
+{
+    unsigned int eax, ebx, ecx, edx;
+    if (!__get_cpuid(1, &eax, &ebx, &ecx, &edx) || !(ecx & bit_SSE4_1))
+        return 0;
+    if (!__get_cpuid_count(7, 0, &eax, &ebx, &ecx, &edx))
+        return 0;
+    return (ebx & bit_SHA) != 0;
+}
+
+#endif //SHA_HAVE_X86_SIMD
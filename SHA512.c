@@ -6,32 +6,37 @@
 #include <string.h>
 
 #include "SHA512.h"
+#include "SHAConstants.h"
+#include "SHAInternal.h"
 #include "config.h"
 
-// K: first 64 bits of the fractional parts of the cube roots of the first 80 primes
-const static uint64_t K[80] =
-{
-    0x428A2F98D728AE22, 0x7137449123EF65CD, 0xB5C0FBCFEC4D3B2F, 0xE9B5DBA58189DBBC,
-    0x3956C25BF348B538, 0x59F111F1B605D019, 0x923F82A4AF194F9B, 0xAB1C5ED5DA6D8118,
-    0xD807AA98A3030242, 0x12835B0145706FBE, 0x243185BE4EE4B28C, 0x550C7DC3D5FFB4E2,
-    0x72BE5D74F27B896F, 0x80DEB1FE3B1696B1, 0x9BDC06A725C71235, 0xC19BF174CF692694,
-    0xE49B69C19EF14AD2, 0xEFBE4786384F25E3, 0x0FC19DC68B8CD5B5, 0x240CA1CC77AC9C65,
-    0x2DE92C6F592B0275, 0x4A7484AA6EA6E483, 0x5CB0A9DCBD41FBD4, 0x76F988DA831153B5,
-    0x983E5152EE66DFAB, 0xA831C66D2DB43210, 0xB00327C898FB213F, 0xBF597FC7BEEF0EE4,
-    0xC6E00BF33DA88FC2, 0xD5A79147930AA725, 0x06CA6351E003826F, 0x142929670A0E6E70,
-    0x27B70A8546D22FFC, 0x2E1B21385C26C926, 0x4D2C6DFC5AC42AED, 0x53380D139D95B3DF,
-    0x650A73548BAF63DE, 0x766A0ABB3C77B2A8, 0x81C2C92E47EDAEE6, 0x92722C851482353B,
-    0xA2BFE8A14CF10364, 0xA81A664BBC423001, 0xC24B8B70D0F89791, 0xC76C51A30654BE30,
-    0xD192E819D6EF5218, 0xD69906245565A910, 0xF40E35855771202A, 0x106AA07032BBD1B8,
-    0x19A4C116B8D2D0C8, 0x1E376C085141AB53, 0x2748774CDF8EEB99, 0x34B0BCB5E19B48A8,
-    0x391C0CB3C5C95A63, 0x4ED8AA4AE3418ACB, 0x5B9CCA4F7763E373, 0x682E6FF3D6B2B8A3,
-    0x748F82EE5DEFB2FC, 0x78A5636F43172F60, 0x84C87814A1F0AB72, 0x8CC702081A6439EC,
-    0x90BEFFFA23631E28, 0xA4506CEBDE82BDE9, 0xBEF9A3F7B2C67915, 0xC67178F2E372532B,
-    0xCA273ECEEA26619C, 0xD186B8C721C0C207, 0xEADA7DD6CDE0EB1E, 0xF57D4F7FEE6ED178,
-    0x06F067AA72176FBA, 0x0A637DC5A2C898A6, 0x113F9804BEF90DAE, 0x1B710B35131C471B,
-    0x28DB77F523047D84, 0x32CAAB7B40C72493, 0x3C9EBE0A15C9BEBC, 0x431D67C49C100D4C,
-    0x4CC5D4BECB3E42B6, 0x597F299CFC657E2A, 0x5FCB6FAB3AD6FAEC, 0x6C44198C4A475817
- }; 
+// SHA512_K: first 64 bits of the fractional parts of the cube roots of the first 80 primes
+const uint64_t SHA512_K[80] =
+{
+    SHA512_K_WORDS
+};
+
+// SHA512_H0: initial hash value, the first 64 bits of the fractional parts of the square roots of the first 8 primes
+const uint64_t SHA512_H0[HASH_ARRAY_LEN] =
+{
+    SHA512_H0_WORDS
+};
+
+// Initial hash values of the truncated variants (FIPS 180-4 sections 5.3.4 and 5.3.6)
+const uint64_t SHA384_H0[HASH_ARRAY_LEN] =
+{
+    SHA384_H0_WORDS
+};
+
+const uint64_t SHA512_224_H0[HASH_ARRAY_LEN] =
+{
+    SHA512_224_H0_WORDS
+};
+
+const uint64_t SHA512_256_H0[HASH_ARRAY_LEN] =
+{
+    SHA512_256_H0_WORDS
+};
 
 // Utility functions
 // Rotate x to the right by numBits
@@ -48,26 +53,113 @@ const static uint64_t K[80] =
 #define SmallSigma1(x) ( ROTR(x,19) ^ ROTR(x,61) ^ (x >> 6) )
 
 // SHA512 message schedule
-// Calculate the Nth block of W
-uint64_t *W(int N, uint64_t *M)
+// Expands the 16 words of block M into the 80 word schedule w
+static void W(uint64_t w[80], const uint64_t *M)
 {
-    uint64_t *w = (uint64_t*) malloc(sizeof(uint64_t) * 80);
-    uint64_t *mPtr = &M[(N * 16)];
-    
-    //printf("Message block %d : ", N);
     for (int i = 0; i < 16; ++i)
+        w[i] = M[i];
+    for (int i = 16; i < 80; ++i)
+        w[i] = SmallSigma1(w[i - 2]) + w[i - 7] + SmallSigma0(w[i - 15]) + w[i - 16];
+}
+
+// Applies the SHA512 compression function to N consecutive blocks of M, whose words are
+// already in host byte order, updating the intermediate hash value h
+static void compress(uint64_t h[HASH_ARRAY_LEN], const uint64_t *M, size_t N)
+{
+    for (size_t i = 0; i < N; ++i)
     {
-        w[i] = *mPtr;
-        ++mPtr;
+        uint64_t T1, T2;
+        // initialize registers
+        uint64_t reg[HASH_ARRAY_LEN];
+        for (int i = 0; i < HASH_ARRAY_LEN; ++i)
+            reg[i] = h[i];
+        
+        uint64_t w[80];
+        W(w, &M[i * 16]);
+        
+        // Apply the SHA512 compression function to update registers
+        for (int j = 0; j < 80; ++j)
+        {   
+            T1 = reg[7] + BigSigma1(reg[4]) + Ch(reg[4], reg[5], reg[6]) + SHA512_K[j] + w[j];
+            T2 = BigSigma0(reg[0]) + Maj(reg[0], reg[1], reg[2]);
+            
+            reg[7] = reg[6];
+            reg[6] = reg[5];
+            reg[5] = reg[4];
+            reg[4] = reg[3] + T1;
+            reg[3] = reg[2];
+            reg[2] = reg[1];
+            reg[1] = reg[0];
+            reg[0] = T1 + T2;
+        }
         
-    //printf("%" PRIx64 , w[i]);
+        // Compute the ith intermediate hash values 
+        for (int i = 0; i < HASH_ARRAY_LEN; ++i)
+            h[i] += reg[i];
     }
-    //printf("\n");
-    for (int i = 16; i < 80; ++i)
+}
+
+// Unrolled compression function used by every entry point except getHash, which keeps the reference
+// round loop above. The working variables are renamed from round to round instead of shifted, and the
+// message schedule is computed on the fly in a circular window of 16 words, so everything can stay in registers
+
+// Schedule word i: the message word itself for the first 16 rounds, then expanded in place over word i - 16
+#define WORD512(i) (W[i] = loadBigEndian64(&blocks[(i) * 8]))
+#define SCHEDULE512(i) (W[(i) & 15] += SmallSigma1(W[((i) - 2) & 15]) + W[((i) - 7) & 15] + SmallSigma0(W[((i) - 15) & 15]))
+
+// Ch and Maj with fewer operations than the textbook forms above
+#define ChFast(x, y, z) ( (z) ^ ((x) & ((y) ^ (z))) )
+#define MajFast(x, y, z) ( ((x) & (y)) | ((z) & ((x) | (y))) )
+
+// One round; the caller rotates the roles of a..h, so the new a is written into h and the new e into d
+#define ROUND512(a, b, c, d, e, f, g, h, i, w) \
+    do { \
+        uint64_t T1 = h + BigSigma1(e) + ChFast(e, f, g) + SHA512_K[i] + w(i); \
+        d += T1; \
+        h = T1 + BigSigma0(a) + MajFast(a, b, c); \
+    } while (0)
+
+#define ROUNDS8_512(i, w) \
+    ROUND512(a, b, c, d, e, f, g, h, (i) + 0, w); \
+    ROUND512(h, a, b, c, d, e, f, g, (i) + 1, w); \
+    ROUND512(g, h, a, b, c, d, e, f, (i) + 2, w); \
+    ROUND512(f, g, h, a, b, c, d, e, (i) + 3, w); \
+    ROUND512(e, f, g, h, a, b, c, d, (i) + 4, w); \
+    ROUND512(d, e, f, g, h, a, b, c, (i) + 5, w); \
+    ROUND512(c, d, e, f, g, h, a, b, (i) + 6, w); \
+    ROUND512(b, c, d, e, f, g, h, a, (i) + 7, w)
+
+// Compresses numBlocks consecutive 128 byte blocks stored in big endian byte order
+static void compressBlocks(uint64_t state[HASH_ARRAY_LEN], const uint8_t *blocks, size_t numBlocks)
+{
+    uint64_t W[16];
+    for (size_t n = 0; n < numBlocks; ++n, blocks += SHA512_MESSAGE_BLOCK_SIZE)
     {
-        w[i] = SmallSigma1(w[i - 2]) + w[i - 7] + SmallSigma0(w[i - 15]) + w[i - 16];
+        uint64_t a = state[0], b = state[1], c = state[2], d = state[3];
+        uint64_t e = state[4], f = state[5], g = state[6], h = state[7];
+
+        ROUNDS8_512(0, WORD512);
+        ROUNDS8_512(8, WORD512);
+        ROUNDS8_512(16, SCHEDULE512);
+        ROUNDS8_512(24, SCHEDULE512);
+        ROUNDS8_512(32, SCHEDULE512);
+        ROUNDS8_512(40, SCHEDULE512);
+        ROUNDS8_512(48, SCHEDULE512);
+        ROUNDS8_512(56, SCHEDULE512);
+        ROUNDS8_512(64, SCHEDULE512);
+        ROUNDS8_512(72, SCHEDULE512);
+
+        state[0] += a; state[1] += b; state[2] += c; state[3] += d;
+        state[4] += e; state[5] += f; state[6] += g; state[7] += h;
     }
-    return w;
+}
+
+void sha512Blocks(uint64_t state[HASH_ARRAY_LEN], const uint8_t *blocks, size_t numBlocks)
+{
+    if (numBlocks == 0)
+        return;
+    compressBlocks(state, blocks, numBlocks);
+    SHA_STATS_COUNT(SHA_STATS_SHA512_BLOCKS, numBlocks * SHA512_MESSAGE_BLOCK_SIZE, numBlocks);
 }
 
 // Step 1:
@@ -82,12 +174,14 @@ PaddedMsg preprocess(uint8_t *msg, size_t len)
     
     // resulting msg wll be multiple of 1024 bits
     //size_t len = strlen(msg);
-    if (msg == NULL || len == 0)
+    // an empty message still pads to one full block
+    if (msg == NULL && len > 0)
     {
         padded.length = 0;
         padded.msg = NULL;
         return padded;
     }
+    SHA_STATS_BEGIN(start);
     
     size_t l = len * 8;
     size_t k = (896 - ( (l  + 1) % 1024 )) % 1024;
@@ -98,9 +192,10 @@ PaddedMsg preprocess(uint8_t *msg, size_t len)
     padded.length = ((l + k + 1) / 8) + 16;
     //printf("padded.length = %zu\n", padded.length);
     padded.msg = (uint8_t*) malloc(sizeof(uint8_t) * padded.length);
-    memset(&padded.msg[0], 0, padded.length);
-    for (size_t i = 0; i < len; ++i)
-        padded.msg[i] = msg[i];
+    // copy the message once; only the padding after it needs clearing
+    if (len > 0)
+        memcpy(padded.msg, msg, len);
+    memset(&padded.msg[len], 0, padded.length - len);
     // append to the binary string a 1 followed by k zeros
     padded.msg[len] = 0x80;
     
@@ -109,6 +204,7 @@ PaddedMsg preprocess(uint8_t *msg, size_t len)
     endianSwap128(&bigL);
     memcpy(&padded.msg[padded.length - sizeof(__uint128_t)], &bigL, sizeof(__uint128_t));
     
+    SHA_STATS_END(SHA_STATS_PREPROCESS, start, len, padded.length / SHA512_MESSAGE_BLOCK_SIZE);
     return padded;
 }
 
@@ -122,57 +218,21 @@ uint64_t *getHash(PaddedMsg *p)
     //printf("Number of blocks = %zu\n", N);
     
     // initial hash value
-    uint64_t h[8] = {
-        0x6A09E667F3BCC908,
-        0xBB67AE8584CAA73B,
-        0x3C6EF372FE94F82B,
-        0xA54FF53A5F1D36F1,
-        0x510E527FADE682D1,
-        0x9B05688C2B3E6C1F,
-        0x1F83D9ABFB41BD6B,
-        0x5BE0CD19137E2179
-    };
+    uint64_t h[HASH_ARRAY_LEN];
+    memcpy(h, SHA512_H0, sizeof(h));
+    SHA_STATS_BEGIN(start);
     
 #if MACHINE_BYTE_ORDER == LITTLE_ENDIAN
     // Convert byte order of message to big endian
     uint64_t *msg = ((uint64_t*)&p->msg[0]);
     for (int i = 0; i < N * 16; ++i)
         endianSwap64(msg++);
+    SHA_STATS_COUNT(SHA_STATS_BYTE_SWAP, p->length, N);
 #endif
 
-    for (size_t i = 0; i < N; ++i)
-    {
-        uint64_t T1, T2;
-        // initialize registers
-        uint64_t reg[HASH_ARRAY_LEN];
-        for (int i = 0; i < HASH_ARRAY_LEN; ++i)
-            reg[i] = h[i];
-        
-        uint64_t *w = W(i, ((uint64_t*)(p->msg)));
-        
-        // Apply the SHA512 compression function to update registers
-        for (int j = 0; j < 80; ++j)
-        {   
-            T1 = reg[7] + BigSigma1(reg[4]) + Ch(reg[4], reg[5], reg[6]) + K[j] + w[j];
-            T2 = BigSigma0(reg[0]) + Maj(reg[0], reg[1], reg[2]);
-            
-            reg[7] = reg[6];
-            reg[6] = reg[5];
-            reg[5] = reg[4];
-            reg[4] = reg[3] + T1;
-            reg[3] = reg[2];
-            reg[2] = reg[1];
-            reg[1] = reg[0];
-            reg[0] = T1 + T2;
-        }
-        
-        // Compute the ith intermediate hash values 
-        for (int i = 0; i < HASH_ARRAY_LEN; ++i)
-            h[i] += reg[i];
-        
-        free(w);
-    }
+    compress(h, (uint64_t*)p->msg, N);
     free(p->msg);
+    SHA_STATS_END(SHA_STATS_GET_HASH, start, p->length, N);
     
     // Now the array h is the hash of the original message M
     uint64_t *retVal = (uint64_t*) malloc(sizeof(uint64_t) * HASH_ARRAY_LEN);
@@ -183,6 +243,244 @@ uint64_t *getHash(PaddedMsg *p)
 /// Wrapper for hashing methods, up to caller to free the return value
 uint64_t *SHA512Hash(uint8_t *input, size_t len)
 {
-    PaddedMsg paddedMsg = preprocess(input, len);
-    return getHash(&paddedMsg);
+    uint8_t digest[SHA512_HASH_SIZE];
+    SHA512HashInto(input, len, digest);
+
+    uint64_t *retVal = (uint64_t*) malloc(sizeof(uint64_t) * HASH_ARRAY_LEN);
+    for (int i = 0; i < HASH_ARRAY_LEN; ++i)
+        retVal[i] = loadBigEndian64(&digest[i * 8]);
+    return retVal;
+}
+
+// Builds the last one or two blocks of a message of msgLen bytes in tail: its final rem bytes, the 1 bit,
+// zeros and the 128 bit big endian bit length. Returns the number of blocks
+static size_t padTail(uint8_t tail[2 * SHA512_MESSAGE_BLOCK_SIZE], const uint8_t *rest, size_t rem, __uint128_t msgLen)
+{
+    size_t numBlocks = (rem + 17 > SHA512_MESSAGE_BLOCK_SIZE) ? 2 : 1;
+    size_t end = numBlocks * SHA512_MESSAGE_BLOCK_SIZE;
+
+    if (rem > 0)
+        memcpy(tail, rest, rem);
+    tail[rem] = 0x80;
+    memset(&tail[rem + 1], 0, end - 16 - (rem + 1));
+
+    __uint128_t bitLen = msgLen * 8;
+    storeBigEndian64(&tail[end - 16], (uint64_t)(bitLen >> 64));
+    storeBigEndian64(&tail[end - 8], (uint64_t)bitLen);
+    return numBlocks;
+}
+
+// Writes the leftmost hashSize bytes of the big endian hash value h
+static void writeDigest(const uint64_t h[HASH_ARRAY_LEN], size_t hashSize, uint8_t *digest)
+{
+    if (hashSize == SHA512_HASH_SIZE)
+    {
+        for (int i = 0; i < HASH_ARRAY_LEN; ++i)
+            storeBigEndian64(&digest[i * 8], h[i]);
+        return;
+    }
+
+    uint8_t full[SHA512_HASH_SIZE];
+    for (int i = 0; i < HASH_ARRAY_LEN; ++i)
+        storeBigEndian64(&full[i * 8], h[i]);
+    memcpy(digest, full, hashSize);
+}
+
+#ifdef SHA_STATS
+// The members of the family all have digests of different sizes
+static int statsPath(size_t hashSize)
+{
+    switch (hashSize)
+    {
+        case SHA384_HASH_SIZE: return SHA_STATS_SHA384;
+        case SHA512_224_HASH_SIZE: return SHA_STATS_SHA512_224;
+        case SHA512_256_HASH_SIZE: return SHA_STATS_SHA512_256;
+        default: return SHA_STATS_SHA512;
+    }
+}
+#endif
+
+// One-shot hash of a member of the SHA-512 family. Whole blocks are compressed straight from the caller's
+// buffer; only the padded tail is copied, into a buffer on the stack
+static void hashInto(const uint64_t iv[HASH_ARRAY_LEN], size_t hashSize, const uint8_t *input, size_t len, uint8_t *out)
+{
+    uint64_t h[HASH_ARRAY_LEN];
+    uint8_t tail[2 * SHA512_MESSAGE_BLOCK_SIZE];
+    size_t numBlocks = len / SHA512_MESSAGE_BLOCK_SIZE;
+    size_t rem = len % SHA512_MESSAGE_BLOCK_SIZE;
+    SHA_STATS_BEGIN(start);
+
+    memcpy(h, iv, sizeof(h));
+    sha512Blocks(h, input, numBlocks);
+    size_t tailBlocks = padTail(tail, &input[len - rem], rem, len);
+    sha512Blocks(h, tail, tailBlocks);
+    writeDigest(h, hashSize, out);
+    SHA_STATS_END(statsPath(hashSize), start, len, numBlocks + tailBlocks);
+}
+
+void SHA512HashInto(const uint8_t *input, size_t len, uint8_t out[SHA512_HASH_SIZE])
+{
+    hashInto(SHA512_H0, SHA512_HASH_SIZE, input, len, out);
+}
+
+// Starts a member of the SHA-512 family, given by its initial hash value and digest size
+static void initVariant(SHA512Context *ctx, const uint64_t iv[HASH_ARRAY_LEN], size_t hashSize)
+{
+    memcpy(ctx->h, iv, sizeof(ctx->h));
+    ctx->blockLen = 0;
+    ctx->msgLen = 0;
+    ctx->hashSize = hashSize;
+}
+
+void SHA512Init(SHA512Context *ctx)
+{
+    initVariant(ctx, SHA512_H0, SHA512_HASH_SIZE);
+}
+
+void SHA512Update(SHA512Context *ctx, const uint8_t *data, size_t len)
+{
+    ctx->msgLen += len;
+
+    // top up a partially filled block first
+    if (ctx->blockLen > 0)
+    {
+        size_t fill = SHA512_MESSAGE_BLOCK_SIZE - ctx->blockLen;
+        if (fill > len)
+            fill = len;
+        memcpy(&ctx->block[ctx->blockLen], data, fill);
+        ctx->blockLen += fill;
+        data += fill;
+        len -= fill;
+        if (ctx->blockLen < SHA512_MESSAGE_BLOCK_SIZE)
+            return;
+        sha512Blocks(ctx->h, ctx->block, 1);
+        ctx->blockLen = 0;
+    }
+
+    // whole blocks are compressed straight from the caller's buffer
+    size_t numBlocks = len / SHA512_MESSAGE_BLOCK_SIZE;
+    sha512Blocks(ctx->h, data, numBlocks);
+    data += numBlocks * SHA512_MESSAGE_BLOCK_SIZE;
+    len -= numBlocks * SHA512_MESSAGE_BLOCK_SIZE;
+
+    if (len > 0)
+    {
+        memcpy(ctx->block, data, len);
+        ctx->blockLen = len;
+    }
+}
+
+// Pads the message, compresses the final block(s) and writes the leftmost ctx->hashSize bytes of the digest
+static void finalInto(SHA512Context *ctx, uint8_t *digest)
+{
+    // append a 1 bit, then zeros until there is room left for the 128 bit message length
+    uint8_t tail[2 * SHA512_MESSAGE_BLOCK_SIZE];
+    sha512Blocks(ctx->h, tail, padTail(tail, ctx->block, ctx->blockLen, ctx->msgLen));
+
+    // truncated variants write only the leftmost hashSize bytes, and digest may be no larger than that
+    uint8_t full[SHA512_HASH_SIZE];
+    writeDigest(ctx->h, SHA512_HASH_SIZE, full);
+    memcpy(digest, full, ctx->hashSize);
+}
+
+void SHA512Final(SHA512Context *ctx, uint8_t digest[SHA512_HASH_SIZE])
+{
+    finalInto(ctx, digest);
+}
+
+void SHA384HashInto(const uint8_t *input, size_t len, uint8_t out[SHA384_HASH_SIZE])
+{
+    hashInto(SHA384_H0, SHA384_HASH_SIZE, input, len, out);
+}
+
+void SHA384Init(SHA512Context *ctx)
+{
+    initVariant(ctx, SHA384_H0, SHA384_HASH_SIZE);
+}
+
+void SHA384Update(SHA512Context *ctx, const uint8_t *data, size_t len)
+{
+    SHA512Update(ctx, data, len);
+}
+
+void SHA384Final(SHA512Context *ctx, uint8_t digest[SHA384_HASH_SIZE])
+{
+    finalInto(ctx, digest);
+}
+
+void SHA512_224HashInto(const uint8_t *input, size_t len, uint8_t out[SHA512_224_HASH_SIZE])
+{
+    hashInto(SHA512_224_H0, SHA512_224_HASH_SIZE, input, len, out);
+}
+
+void SHA512_224Init(SHA512Context *ctx)
+{
+    initVariant(ctx, SHA512_224_H0, SHA512_224_HASH_SIZE);
+}
+
+void SHA512_224Update(SHA512Context *ctx, const uint8_t *data, size_t len)
+{
+    SHA512Update(ctx, data, len);
+}
+
+void SHA512_224Final(SHA512Context *ctx, uint8_t digest[SHA512_224_HASH_SIZE])
+{
+    finalInto(ctx, digest);
+}
+
+void SHA512_256HashInto(const uint8_t *input, size_t len, uint8_t out[SHA512_256_HASH_SIZE])
+{
+    hashInto(SHA512_256_H0, SHA512_256_HASH_SIZE, input, len, out);
+}
+
+void SHA512_256Init(SHA512Context *ctx)
+{
+    initVariant(ctx, SHA512_256_H0, SHA512_256_HASH_SIZE);
+}
+
+void SHA512_256Update(SHA512Context *ctx, const uint8_t *data, size_t len)
+{
+    SHA512Update(ctx, data, len);
+}
+
+void SHA512_256Final(SHA512Context *ctx, uint8_t digest[SHA512_256_HASH_SIZE])
+{
+    finalInto(ctx, digest);
+}
+
+int SHA512MidstateInit(SHA512Midstate *mid, const uint8_t *prefix, size_t len)
+{
+    if (len % SHA512_MESSAGE_BLOCK_SIZE != 0)
+        return 0;
+    memcpy(mid->h, SHA512_H0, sizeof(mid->h));
+    sha512Blocks(mid->h, prefix, len / SHA512_MESSAGE_BLOCK_SIZE);
+    mid->prefixLen = len;
+    mid->hashSize = SHA512_HASH_SIZE;
+    return 1;
+}
+
+int SHA512GetMidstate(const SHA512Context *ctx, SHA512Midstate *mid)
+{
+    if (ctx->blockLen != 0)
+        return 0;
+    memcpy(mid->h, ctx->h, sizeof(mid->h));
+    mid->prefixLen = (uint64_t)ctx->msgLen;
+    mid->hashSize = ctx->hashSize;
+    return 1;
+}
+
+void SHA512InitFromMidstate(SHA512Context *ctx, const SHA512Midstate *mid)
+{
+    initVariant(ctx, mid->h, mid->hashSize);
+    ctx->msgLen = mid->prefixLen;
+}
+
+void SHA512MidstateHashInto(const SHA512Midstate *mid, const uint8_t *suffix, size_t len, uint8_t out[SHA512_HASH_SIZE])
+{
+    SHA512Context ctx;
+    SHA512InitFromMidstate(&ctx, mid);
+    // the whole state, as the lanes of SHA512MidstateHashMany write it
+    ctx.hashSize = SHA512_HASH_SIZE;
+    SHA512Update(&ctx, suffix, len);
+    SHA512Final(&ctx, out);
 }
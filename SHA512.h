@@ -12,9 +12,31 @@
 
 #define SHA512_MESSAGE_BLOCK_SIZE 128
 #define SHA512_HASH_SIZE 64
+#define SHA384_HASH_SIZE 48
+#define SHA512_224_HASH_SIZE 28
+#define SHA512_256_HASH_SIZE 32
 #define HASH_ARRAY_LEN 8
 #define MAX_VAL 0xFFFFFFFFFFFFFFFFLLU
 
+/// Streaming hash state: the intermediate hash value plus at most one partial message block.
+/// Also used by SHA-384, SHA-512/224 and SHA-512/256, which differ only in the initial hash value
+/// and the number of digest bytes written by the final step
+typedef struct SHA512Context {
+    uint64_t h[HASH_ARRAY_LEN];
+    uint8_t block[SHA512_MESSAGE_BLOCK_SIZE];
+    size_t blockLen;
+    __uint128_t msgLen;
+    size_t hashSize;
+} SHA512Context;
+
+/// Intermediate hash value after a block aligned prefix. Messages that start with the prefix are finished
+/// from here, so the prefix is compressed once rather than once per message
+typedef struct SHA512Midstate {
+    uint64_t h[HASH_ARRAY_LEN];
+    uint64_t prefixLen;
+    size_t hashSize;        // digest size of the family member the prefix was hashed with
+} SHA512Midstate;
+
 /// Preprocesses the given message of len bytes
 PaddedMsg preprocess(uint8_t *msg, size_t len);
 
@@ -24,4 +46,59 @@ uint64_t *getHash(PaddedMsg *p);
 /// Wrapper for hashing methods, up to caller to free the return value
 uint64_t *SHA512Hash(uint8_t *input, size_t len);
 
+/// Writes the digest of the len byte message at input into out, without allocating any memory
+void SHA512HashInto(const uint8_t *input, size_t len, uint8_t out[SHA512_HASH_SIZE]);
+
+/// Hashes n independent messages, writing the digest of msgs[i] into out[i]. Messages are hashed side by
+/// side in AVX-512 or AVX2 lanes when the CPU supports them, otherwise one after another
+void SHA512HashMany(const uint8_t **msgs, const size_t *lens, size_t n, uint8_t (*out)[SHA512_HASH_SIZE]);
+
+/// Prepares ctx to hash a new message
+void SHA512Init(SHA512Context *ctx);
+
+/// Absorbs the next len bytes of the message, compressing each block as soon as it is complete
+void SHA512Update(SHA512Context *ctx, const uint8_t *data, size_t len);
+
+/// Pads the message, compresses the final block(s) and writes the big endian digest. A context started by
+/// one of the truncated variants' Init functions writes only that variant's hash size
+void SHA512Final(SHA512Context *ctx, uint8_t digest[SHA512_HASH_SIZE]);
+
+/// SHA-384: SHA-512 with its own initial hash value, truncated to 48 bytes
+void SHA384HashInto(const uint8_t *input, size_t len, uint8_t out[SHA384_HASH_SIZE]);
+void SHA384Init(SHA512Context *ctx);
+void SHA384Update(SHA512Context *ctx, const uint8_t *data, size_t len);
+void SHA384Final(SHA512Context *ctx, uint8_t digest[SHA384_HASH_SIZE]);
+
+/// SHA-512/224: SHA-512 with its own initial hash value, truncated to 28 bytes
+void SHA512_224HashInto(const uint8_t *input, size_t len, uint8_t out[SHA512_224_HASH_SIZE]);
+void SHA512_224Init(SHA512Context *ctx);
+void SHA512_224Update(SHA512Context *ctx, const uint8_t *data, size_t len);
+void SHA512_224Final(SHA512Context *ctx, uint8_t digest[SHA512_224_HASH_SIZE]);
+
+/// SHA-512/256: SHA-512 with its own initial hash value, truncated to 32 bytes. On 64 bit CPUs without
+/// SHA-256 instructions it is faster per byte than SHA-256, with a digest of the same length
+void SHA512_256HashInto(const uint8_t *input, size_t len, uint8_t out[SHA512_256_HASH_SIZE]);
+void SHA512_256Init(SHA512Context *ctx);
+void SHA512_256Update(SHA512Context *ctx, const uint8_t *data, size_t len);
+void SHA512_256Final(SHA512Context *ctx, uint8_t digest[SHA512_256_HASH_SIZE]);
+
+/// Compresses the len byte SHA-512 prefix into mid. Returns 0 if len is not a multiple of SHA512_MESSAGE_BLOCK_SIZE
+int SHA512MidstateInit(SHA512Midstate *mid, const uint8_t *prefix, size_t len);
+
+/// Saves the state of ctx, of any member of the family, into mid. Returns 0 if the bytes absorbed so far
+/// do not end on a block boundary
+int SHA512GetMidstate(const SHA512Context *ctx, SHA512Midstate *mid);
+
+/// Prepares ctx to hash the rest of a message whose prefix was saved in mid, as the same family member
+void SHA512InitFromMidstate(SHA512Context *ctx, const SHA512Midstate *mid);
+
+/// Writes the full final state of the prefix saved in mid followed by the len bytes at suffix. For the
+/// SHA-384 and SHA-512/t variants, the digest is its leftmost mid->hashSize bytes
+void SHA512MidstateHashInto(const SHA512Midstate *mid, const uint8_t *suffix, size_t len, uint8_t out[SHA512_HASH_SIZE]);
+
+/// SHA512HashMany for messages that share the prefix saved in mid: writes the digest of the prefix
+/// followed by suffixes[i] into out[i]
+void SHA512MidstateHashMany(const SHA512Midstate *mid, const uint8_t **suffixes, const size_t *lens, size_t n,
+                            uint8_t (*out)[SHA512_HASH_SIZE]);
+
 #endif //__SHA512_H_
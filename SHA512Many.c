@@ -0,0 +1,326 @@
+// Multi-buffer SHA 512: hashes independent messages side by side, one message per SIMD lane
+// Each 64 bit lane of a vector register holds the working variables of a different message,
+// so every vector instruction advances the rounds of 4 (AVX2) or 8 (AVX-512) messages at once.
+
+#include <string.h>
+
+#include "SHA512.h"
+#include "SHAInternal.h"
+
+#ifdef SHA_HAVE_X86_SIMD
+#include <immintrin.h>
+#endif
+
+// Widest lane count supported by any kernel
+#define MAX_LANES 8
+
+// Transposed hash state: word i of the message in lane j is stored at state[i][j]
+typedef uint64_t LaneState[HASH_ARRAY_LEN][MAX_LANES];
+
+// Compresses one block per lane, blocks[j] being the next 128 byte block of lane j
+typedef void (*ManyBlocksFn)(LaneState state, const uint8_t *blocks[MAX_LANES]);
+
+// Progress of the message currently assigned to a lane
+typedef struct Lane {
+    const uint8_t *data;    // next whole block of the message
+    size_t fullBlocks;      // whole blocks left to read straight from the message
+    size_t tailBlocks;      // padded blocks left to read from tail
+    const uint8_t *tailPtr;
+    size_t msgIndex;
+    uint8_t tail[2 * SHA512_MESSAGE_BLOCK_SIZE];
+} Lane;
+
+// Fed to lanes that have run out of messages; their results are discarded
+static const uint8_t idleBlock[SHA512_MESSAGE_BLOCK_SIZE];
+
+#ifdef SHA_HAVE_X86_SIMD
+
+// AVX2 versions of the SHA512 functions, operating on 4 lanes at once
+#define ADD4(x, y) _mm256_add_epi64(x, y)
+#define XOR4(x, y) _mm256_xor_si256(x, y)
+#define ROTR4(x, numBits) _mm256_or_si256(_mm256_srli_epi64(x, numBits), _mm256_slli_epi64(x, 64 - numBits))
+
+#define Ch4(x,y,z) XOR4(_mm256_and_si256(x, y), _mm256_andnot_si256(x, z))
+#define Maj4(x,y,z) XOR4(_mm256_and_si256(x, y), _mm256_and_si256(z, XOR4(x, y)))
+
+#define BigSigma0_4(x) XOR4(XOR4(ROTR4(x,28), ROTR4(x,34)), ROTR4(x,39))
+#define BigSigma1_4(x) XOR4(XOR4(ROTR4(x,14), ROTR4(x,18)), ROTR4(x,41))
+
+#define SmallSigma0_4(x) XOR4(XOR4(ROTR4(x,1), ROTR4(x,8)), _mm256_srli_epi64(x, 7))
+#define SmallSigma1_4(x) XOR4(XOR4(ROTR4(x,19), ROTR4(x,61)), _mm256_srli_epi64(x, 6))
+
+// AVX-512 versions, operating on 8 lanes at once. The ternary logic immediates encode
+// x ^ y ^ z (0x96), Ch (0xCA) and Maj (0xE8)
+#define ADD8(x, y) _mm512_add_epi64(x, y)
+#define XOR3_8(x, y, z) _mm512_ternarylogic_epi64(x, y, z, 0x96)
+
+#define Ch8(x,y,z) _mm512_ternarylogic_epi64(x, y, z, 0xCA)
+#define Maj8(x,y,z) _mm512_ternarylogic_epi64(x, y, z, 0xE8)
+
+#define BigSigma0_8(x) XOR3_8(_mm512_ror_epi64(x,28), _mm512_ror_epi64(x,34), _mm512_ror_epi64(x,39))
+#define BigSigma1_8(x) XOR3_8(_mm512_ror_epi64(x,14), _mm512_ror_epi64(x,18), _mm512_ror_epi64(x,41))
+
+#define SmallSigma0_8(x) XOR3_8(_mm512_ror_epi64(x,1), _mm512_ror_epi64(x,8), _mm512_srli_epi64(x, 7))
+#define SmallSigma1_8(x) XOR3_8(_mm512_ror_epi64(x,19), _mm512_ror_epi64(x,61), _mm512_srli_epi64(x, 6))
+
+// Loads words [offset, offset + 4) of the blocks of 4 lanes, converting them to host byte order,
+// and transposes them so that out[i] holds word offset + i of every lane
+__attribute__((target("avx2")))
+static inline void loadTransposed4(__m256i out[4], const uint8_t *const *blocks, int offset)
+{
+    const __m256i swap = _mm256_setr_epi8(7, 6, 5, 4, 3, 2, 1, 0, 15, 14, 13, 12, 11, 10, 9, 8,
+                                          7, 6, 5, 4, 3, 2, 1, 0, 15, 14, 13, 12, 11, 10, 9, 8);
+    __m256i r[4], t[4];
+    for (int i = 0; i < 4; ++i)
+        r[i] = _mm256_shuffle_epi8(_mm256_loadu_si256((const __m256i*)&blocks[i][offset * 8]), swap);
+
+    t[0] = _mm256_unpacklo_epi64(r[0], r[1]);
+    t[1] = _mm256_unpackhi_epi64(r[0], r[1]);
+    t[2] = _mm256_unpacklo_epi64(r[2], r[3]);
+    t[3] = _mm256_unpackhi_epi64(r[2], r[3]);
+
+    out[0] = _mm256_permute2x128_si256(t[0], t[2], 0x20);
+    out[1] = _mm256_permute2x128_si256(t[1], t[3], 0x20);
+    out[2] = _mm256_permute2x128_si256(t[0], t[2], 0x31);
+    out[3] = _mm256_permute2x128_si256(t[1], t[3], 0x31);
+}
+
+// 4 lane SHA512 compression function
+__attribute__((target("avx2")))
+static void sha512x4(LaneState state, const uint8_t *blocks[MAX_LANES])
+{
+    __m256i w[16];
+    for (int offset = 0; offset < 16; offset += 4)
+        loadTransposed4(&w[offset], blocks, offset);
+
+    __m256i reg[HASH_ARRAY_LEN];
+    for (int i = 0; i < HASH_ARRAY_LEN; ++i)
+        reg[i] = _mm256_loadu_si256((const __m256i*)&state[i][0]);
+    __m256i a = reg[0], b = reg[1], c = reg[2], d = reg[3], e = reg[4], f = reg[5], g = reg[6], h = reg[7];
+
+    for (int j = 0; j < 80; ++j)
+    {
+        // the message schedule is computed on the fly in a rolling window of 16 words
+        if (j >= 16)
+            w[j & 15] = ADD4(ADD4(SmallSigma1_4(w[(j - 2) & 15]), w[(j - 7) & 15]),
+                             ADD4(SmallSigma0_4(w[(j - 15) & 15]), w[j & 15]));
+
+        __m256i T1 = ADD4(ADD4(h, BigSigma1_4(e)), ADD4(Ch4(e, f, g), ADD4(_mm256_set1_epi64x((long long)SHA512_K[j]), w[j & 15])));
+        __m256i T2 = ADD4(BigSigma0_4(a), Maj4(a, b, c));
+        h = g;
+        g = f;
+        f = e;
+        e = ADD4(d, T1);
+        d = c;
+        c = b;
+        b = a;
+        a = ADD4(T1, T2);
+    }
+
+    reg[0] = ADD4(reg[0], a); reg[1] = ADD4(reg[1], b); reg[2] = ADD4(reg[2], c); reg[3] = ADD4(reg[3], d);
+    reg[4] = ADD4(reg[4], e); reg[5] = ADD4(reg[5], f); reg[6] = ADD4(reg[6], g); reg[7] = ADD4(reg[7], h);
+    for (int i = 0; i < HASH_ARRAY_LEN; ++i)
+        _mm256_storeu_si256((__m256i*)&state[i][0], reg[i]);
+}
+
+// 8 lane SHA512 compression function
+__attribute__((target("avx512f")))
+static void sha512x8(LaneState state, const uint8_t *blocks[MAX_LANES])
+{
+    __m512i w[16];
+    __m256i lo[4], hi[4];
+    for (int offset = 0; offset < 16; offset += 4)
+    {
+        loadTransposed4(lo, &blocks[0], offset);
+        loadTransposed4(hi, &blocks[4], offset);
+        for (int i = 0; i < 4; ++i)
+            w[offset + i] = _mm512_inserti64x4(_mm512_castsi256_si512(lo[i]), hi[i], 1);
+    }
+
+    __m512i reg[HASH_ARRAY_LEN];
+    for (int i = 0; i < HASH_ARRAY_LEN; ++i)
+        reg[i] = _mm512_loadu_si512(&state[i][0]);
+    __m512i a = reg[0], b = reg[1], c = reg[2], d = reg[3], e = reg[4], f = reg[5], g = reg[6], h = reg[7];
+
+    for (int j = 0; j < 80; ++j)
+    {
+        if (j >= 16)
+            w[j & 15] = ADD8(ADD8(SmallSigma1_8(w[(j - 2) & 15]), w[(j - 7) & 15]),
+                             ADD8(SmallSigma0_8(w[(j - 15) & 15]), w[j & 15]));
+
+        __m512i T1 = ADD8(ADD8(h, BigSigma1_8(e)), ADD8(Ch8(e, f, g), ADD8(_mm512_set1_epi64((long long)SHA512_K[j]), w[j & 15])));
+        __m512i T2 = ADD8(BigSigma0_8(a), Maj8(a, b, c));
+        h = g;
+        g = f;
+        f = e;
+        e = ADD8(d, T1);
+        d = c;
+        c = b;
+        b = a;
+        a = ADD8(T1, T2);
+    }
+
+    reg[0] = ADD8(reg[0], a); reg[1] = ADD8(reg[1], b); reg[2] = ADD8(reg[2], c); reg[3] = ADD8(reg[3], d);
+    reg[4] = ADD8(reg[4], e); reg[5] = ADD8(reg[5], f); reg[6] = ADD8(reg[6], g); reg[7] = ADD8(reg[7], h);
+    for (int i = 0; i < HASH_ARRAY_LEN; ++i)
+        _mm512_storeu_si512(&state[i][0], reg[i]);
+}
+
+#endif //SHA_HAVE_X86_SIMD
+
+// Assigns message msgIndex to the lane, starting from the intermediate hash value iv that
+// already covers prefixLen bytes
+static void laneLoad(Lane *lane, LaneState state, int laneNum, const uint64_t iv[HASH_ARRAY_LEN],
+                     uint64_t prefixLen, const uint8_t *msg, size_t len, size_t msgIndex)
+{
+    size_t rem = len % SHA512_MESSAGE_BLOCK_SIZE;
+
+    lane->data = msg;
+    lane->fullBlocks = len / SHA512_MESSAGE_BLOCK_SIZE;
+    lane->msgIndex = msgIndex;
+
+    // the last partial block, the 1 bit, zeros and the 128 bit length fill one or two blocks
+    lane->tailBlocks = (rem + 17 > SHA512_MESSAGE_BLOCK_SIZE) ? 2 : 1;
+    lane->tailPtr = lane->tail;
+    memset(lane->tail, 0, sizeof(lane->tail));
+    if (rem > 0)
+        memcpy(lane->tail, &msg[len - rem], rem);
+    lane->tail[rem] = 0x80;
+
+    __uint128_t bitLen = ((__uint128_t)prefixLen + len) * 8;
+    uint8_t *lenPtr = &lane->tail[lane->tailBlocks * SHA512_MESSAGE_BLOCK_SIZE - 16];
+    storeBigEndian64(lenPtr, (uint64_t)(bitLen >> 64));
+    storeBigEndian64(lenPtr + 8, (uint64_t)bitLen);
+
+    for (int i = 0; i < HASH_ARRAY_LEN; ++i)
+        state[i][laneNum] = iv[i];
+}
+
+// Returns the next block of the lane's padded message
+static const uint8_t *laneNextBlock(Lane *lane)
+{
+    const uint8_t *block;
+    if (lane->fullBlocks > 0)
+    {
+        block = lane->data;
+        lane->data += SHA512_MESSAGE_BLOCK_SIZE;
+        --lane->fullBlocks;
+    }
+    else
+    {
+        block = lane->tailPtr;
+        lane->tailPtr += SHA512_MESSAGE_BLOCK_SIZE;
+        --lane->tailBlocks;
+    }
+    return block;
+}
+
+// Hashes every message with a numLanes wide kernel. Whenever a lane finishes its message it
+// is refilled with the next pending one, so messages of different lengths keep the lanes busy.
+static void hashManyLanes(ManyBlocksFn kernel, int numLanes, const uint64_t iv[HASH_ARRAY_LEN], uint64_t prefixLen,
+                          const uint8_t **msgs, const size_t *lens, size_t n, uint8_t (*out)[SHA512_HASH_SIZE])
+{
+    Lane lanes[MAX_LANES];
+    LaneState state;
+    const uint8_t *blocks[MAX_LANES];
+    int busy[MAX_LANES];
+    int active = 0;
+    size_t next = 0;
+    SHA_STATS_BEGIN(start);
+
+    for (int j = 0; j < numLanes; ++j)
+    {
+        busy[j] = next < n;
+        if (busy[j])
+        {
+            laneLoad(&lanes[j], state, j, iv, prefixLen, msgs[next], lens[next], next);
+            ++next;
+            ++active;
+        }
+    }
+
+    while (active > 0)
+    {
+        // a single straggler is cheaper to finish with the scalar compression function
+        if (active == 1 && next == n)
+            break;
+
+        for (int j = 0; j < numLanes; ++j)
+            blocks[j] = busy[j] ? laneNextBlock(&lanes[j]) : idleBlock;
+
+        kernel(state, blocks);
+
+        for (int j = 0; j < numLanes; ++j)
+        {
+            if (!busy[j] || lanes[j].fullBlocks > 0 || lanes[j].tailBlocks > 0)
+                continue;
+
+            for (int i = 0; i < HASH_ARRAY_LEN; ++i)
+                storeBigEndian64(&out[lanes[j].msgIndex][i * 8], state[i][j]);
+
+            if (next < n)
+            {
+                laneLoad(&lanes[j], state, j, iv, prefixLen, msgs[next], lens[next], next);
+                ++next;
+            }
+            else
+            {
+                busy[j] = 0;
+                --active;
+            }
+        }
+    }
+
+    for (int j = 0; j < numLanes; ++j)
+    {
+        if (!busy[j])
+            continue;
+
+        uint64_t h[HASH_ARRAY_LEN];
+        for (int i = 0; i < HASH_ARRAY_LEN; ++i)
+            h[i] = state[i][j];
+        sha512Blocks(h, lanes[j].data, lanes[j].fullBlocks);
+        sha512Blocks(h, lanes[j].tailPtr, lanes[j].tailBlocks);
+        for (int i = 0; i < HASH_ARRAY_LEN; ++i)
+            storeBigEndian64(&out[lanes[j].msgIndex][i * 8], h[i]);
+    }
+
+#ifdef SHA_STATS
+    uint64_t bytes = 0, numBlocks = 0;
+    for (size_t i = 0; i < n; ++i)
+    {
+        bytes += lens[i];
+        numBlocks += (lens[i] + 16) / 128 + 1;
+    }
+    SHA_STATS_END(SHA_STATS_SHA512_MANY, start, bytes, numBlocks);
+#endif
+}
+
+void SHA512MidstateHashMany(const SHA512Midstate *mid, const uint8_t **suffixes, const size_t *lens, size_t n,
+                            uint8_t (*out)[SHA512_HASH_SIZE])
+{
+#ifdef SHA_HAVE_X86_SIMD
+    if (n > 1 && __builtin_cpu_supports("avx512f"))
+    {
+        hashManyLanes(sha512x8, 8, mid->h, mid->prefixLen, suffixes, lens, n, out);
+        return;
+    }
+    if (n > 1 && __builtin_cpu_supports("avx2"))
+    {
+        hashManyLanes(sha512x4, 4, mid->h, mid->prefixLen, suffixes, lens, n, out);
+        return;
+    }
+#endif
+
+    for (size_t i = 0; i < n; ++i)
+        SHA512MidstateHashInto(mid, suffixes[i], lens[i], out[i]);
+}
+
+void SHA512HashMany(const uint8_t **msgs, const size_t *lens, size_t n, uint8_t (*out)[SHA512_HASH_SIZE])
+{
+    SHA512Midstate initial;
+    memcpy(initial.h, SHA512_H0, sizeof(initial.h));
+    initial.prefixLen = 0;
+    initial.hashSize = SHA512_HASH_SIZE;
+    SHA512MidstateHashMany(&initial, msgs, lens, n, out);
+}
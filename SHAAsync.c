@@ -0,0 +1,483 @@
+// Asynchronous hashing service: request threads submit jobs and carry on while dedicated workers hash them
+
+#define _DEFAULT_SOURCE
+#include <pthread.h>
+#include <sched.h>
+#include <stdatomic.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+#ifdef __linux__
+#include <poll.h>
+#include <sys/eventfd.h>
+#endif
+
+#include "SHAAsync.h"
+#include "SHAInternal.h"
+
+typedef struct AsyncJob {
+    const uint8_t *data;
+    size_t len;
+    uint8_t *out;
+    SHAAsyncCallback callback;
+    void *tag;
+    SHAAlgorithm algorithm;
+} AsyncJob;
+
+// A cell is free for the producer claiming position pos when seq == pos, and holds a job for the
+// consumer at position pos when seq == pos + 1
+typedef struct RingCell {
+    atomic_size_t seq;
+    AsyncJob job;
+} RingCell;
+
+// Bounded lock-free queue for any number of producers and a single consumer. Padded so that the
+// producers' and the consumer's position do not share a cache line
+typedef struct Ring {
+    RingCell *cells;
+    size_t mask;
+    char pad0[64];
+    atomic_size_t head;     // next position to claim, shared by the producers
+    char pad1[64];
+    size_t tail;            // next position to take, owned by the consumer
+    char pad2[64];
+} Ring;
+
+typedef struct AsyncWorker {
+    Ring submissions;
+    SHAAsync *engine;
+    pthread_t thread;
+    pthread_mutex_t lock;
+    pthread_cond_t wake;
+    atomic_int sleeping;    // set while the worker waits on wake
+} AsyncWorker;
+
+struct SHAAsync {
+    AsyncWorker *workers;
+    int numWorkers;         // workers with a running thread
+    int numRings;           // workers with a submission ring
+    size_t maxBatch;
+    uint64_t latencyCapNanos;
+
+    Ring completions;
+    size_t capacity;            // most jobs that may be unfinished or unreaped at once
+    atomic_size_t outstanding;  // jobs submitted and not yet finished or reaped
+    atomic_size_t unreaped;     // jobs without a callback submitted and not yet reaped
+    atomic_size_t nextWorker;
+    atomic_int shutdown;
+    int eventFd;
+
+    SHA512Midstate iv[SHA_ALGORITHM_COUNT];     // initial states of the SHA-512 family
+};
+
+static int ringInit(Ring *ring, size_t size)
+{
+    ring->cells = (RingCell*) malloc(size * sizeof(RingCell));
+    if (ring->cells == NULL)
+        return 0;
+    for (size_t i = 0; i < size; ++i)
+        atomic_init(&ring->cells[i].seq, i);
+    ring->mask = size - 1;
+    atomic_init(&ring->head, 0);
+    ring->tail = 0;
+    return 1;
+}
+
+// Returns 0 if the ring is full
+static int ringPush(Ring *ring, const AsyncJob *job)
+{
+    size_t pos = atomic_load_explicit(&ring->head, memory_order_relaxed);
+    for (;;)
+    {
+        RingCell *cell = &ring->cells[pos & ring->mask];
+        size_t seq = atomic_load_explicit(&cell->seq, memory_order_acquire);
+        intptr_t diff = (intptr_t)seq - (intptr_t)pos;
+        if (diff == 0)
+        {
+            if (atomic_compare_exchange_weak_explicit(&ring->head, &pos, pos + 1, memory_order_relaxed,
+                                                      memory_order_relaxed))
+            {
+                cell->job = *job;
+                atomic_store_explicit(&cell->seq, pos + 1, memory_order_release);
+                return 1;
+            }
+        }
+        else if (diff < 0)
+            return 0;
+        else
+            pos = atomic_load_explicit(&ring->head, memory_order_relaxed);
+    }
+}
+
+// Returns non zero if the consumer's next job has been published
+static int ringReady(const Ring *ring)
+{
+    const RingCell *cell = &ring->cells[ring->tail & ring->mask];
+    return atomic_load_explicit(&cell->seq, memory_order_acquire) == ring->tail + 1;
+}
+
+// Returns 0 if the ring holds no published job
+static int ringPop(Ring *ring, AsyncJob *job)
+{
+    if (!ringReady(ring))
+        return 0;
+    RingCell *cell = &ring->cells[ring->tail & ring->mask];
+    *job = cell->job;
+    atomic_store_explicit(&cell->seq, ring->tail + ring->mask + 1, memory_order_release);
+    ++ring->tail;
+    return 1;
+}
+
+static size_t roundUpPowerOfTwo(size_t n)
+{
+    size_t size = 1;
+    while (size < n)
+        size <<= 1;
+    return size;
+}
+
+static uint64_t nowNanos(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ULL + (uint64_t)ts.tv_nsec;
+}
+
+static void signalCompletions(SHAAsync *engine, uint64_t count)
+{
+#ifdef __linux__
+    if (engine->eventFd >= 0)
+    {
+        ssize_t written = write(engine->eventFd, &count, sizeof(count));
+        (void)written;
+    }
+#else
+    (void)engine;
+    (void)count;
+#endif
+}
+
+// Writes the digest where the job wants it and hands the job back to its owner. Returns 1 if the job
+// was posted to the completion ring
+static int finishJob(SHAAsync *engine, const AsyncJob *job, const uint8_t *digest, size_t hashSize)
+{
+    if (job->out != NULL)
+        memcpy(job->out, digest, hashSize);
+
+    if (job->callback != NULL)
+    {
+        job->callback(job->tag, digest);
+        atomic_fetch_sub_explicit(&engine->outstanding, 1, memory_order_release);
+        return 0;
+    }
+
+    // cannot stay full: the ring holds capacity jobs and no more than that are outstanding
+    while (!ringPush(&engine->completions, job))
+        sched_yield();
+    return 1;
+}
+
+// Hashes a batch, one multi-buffer call per algorithm present in it
+static void runBatch(SHAAsync *engine, const AsyncJob *jobs, size_t n)
+{
+    const uint8_t *msgs[SHA_ASYNC_MAX_BATCH];
+    size_t lens[SHA_ASYNC_MAX_BATCH];
+    size_t index[SHA_ASYNC_MAX_BATCH];
+    uint8_t digests256[SHA_ASYNC_MAX_BATCH][SHA256_HASH_SIZE];
+    uint8_t digests512[SHA_ASYNC_MAX_BATCH][SHA512_HASH_SIZE];
+    uint64_t posted = 0;
+
+    for (int a = 0; a < SHA_ALGORITHM_COUNT; ++a)
+    {
+        size_t count = 0;
+        for (size_t i = 0; i < n; ++i)
+        {
+            if (jobs[i].algorithm != (SHAAlgorithm)a)
+                continue;
+            msgs[count] = jobs[i].data;
+            lens[count] = jobs[i].len;
+            index[count++] = i;
+        }
+        if (count == 0)
+            continue;
+
+        size_t hashSize = SHAAlgorithmHashSize((SHAAlgorithm)a);
+        if (a == SHA_ALGORITHM_SHA256)
+        {
+            SHA256HashMany(msgs, lens, count, digests256);
+            for (size_t k = 0; k < count; ++k)
+                posted += finishJob(engine, &jobs[index[k]], digests256[k], hashSize);
+        }
+        else
+        {
+            // the SHA-512 variants only differ in their initial state and truncation
+            SHA512MidstateHashMany(&engine->iv[a], msgs, lens, count, digests512);
+            for (size_t k = 0; k < count; ++k)
+                posted += finishJob(engine, &jobs[index[k]], digests512[k], hashSize);
+        }
+    }
+
+    if (posted > 0)
+        signalCompletions(engine, posted);
+}
+
+static size_t takeJobs(AsyncWorker *worker, AsyncJob *jobs, size_t max)
+{
+    size_t n = 0;
+    while (n < max && ringPop(&worker->submissions, &jobs[n]))
+        ++n;
+    return n;
+}
+
+// Sleeps until the worker's ring has a job. Returns 0 once the engine shuts down and the ring is drained
+static int waitForJobs(AsyncWorker *worker)
+{
+    SHAAsync *engine = worker->engine;
+    int ready;
+
+    pthread_mutex_lock(&worker->lock);
+    atomic_store(&worker->sleeping, 1);
+    // pairs with the fence in SHAAsyncSubmit: either the submitter sees the flag or the worker sees the job
+    atomic_thread_fence(memory_order_seq_cst);
+    while (!(ready = ringReady(&worker->submissions)) && !atomic_load(&engine->shutdown))
+        pthread_cond_wait(&worker->wake, &worker->lock);
+    atomic_store(&worker->sleeping, 0);
+    pthread_mutex_unlock(&worker->lock);
+    return ready;
+}
+
+static void *workerMain(void *arg)
+{
+    AsyncWorker *worker = (AsyncWorker*)arg;
+    SHAAsync *engine = worker->engine;
+    AsyncJob jobs[SHA_ASYNC_MAX_BATCH];
+
+    for (;;)
+    {
+        size_t n = takeJobs(worker, jobs, engine->maxBatch);
+        if (n == 0)
+        {
+            if (!waitForJobs(worker))
+                return NULL;
+            continue;
+        }
+
+        // a lone job waits up to the latency cap for company, since a fuller batch costs little more
+        if (n < engine->maxBatch && engine->latencyCapNanos > 0)
+        {
+            uint64_t deadline = nowNanos() + engine->latencyCapNanos;
+            while (n < engine->maxBatch && !atomic_load_explicit(&engine->shutdown, memory_order_relaxed))
+            {
+                size_t more = takeJobs(worker, &jobs[n], engine->maxBatch - n);
+                n += more;
+                if (more == 0)
+                {
+                    if (nowNanos() >= deadline)
+                        break;
+                    sched_yield();
+                }
+            }
+        }
+
+        runBatch(engine, jobs, n);
+    }
+}
+
+SHAAsync *SHAAsyncCreate(int numWorkers, size_t queueSize, size_t maxBatch, unsigned latencyCapMicros)
+{
+    if (numWorkers <= 0)
+    {
+        long cpus = sysconf(_SC_NPROCESSORS_ONLN);
+        numWorkers = (cpus > 0) ? (int)cpus : 1;
+    }
+    queueSize = roundUpPowerOfTwo(queueSize == 0 ? SHA_ASYNC_DEFAULT_QUEUE_SIZE : queueSize);
+    if (maxBatch == 0)
+        maxBatch = SHA_ASYNC_DEFAULT_BATCH;
+    if (maxBatch > SHA_ASYNC_MAX_BATCH)
+        maxBatch = SHA_ASYNC_MAX_BATCH;
+
+    SHAAsync *engine = (SHAAsync*) calloc(1, sizeof(SHAAsync));
+    if (engine == NULL)
+        return NULL;
+    engine->eventFd = -1;
+    engine->maxBatch = maxBatch;
+    engine->latencyCapNanos = (uint64_t)latencyCapMicros * 1000;
+    engine->capacity = queueSize * (size_t)numWorkers;
+    atomic_init(&engine->outstanding, 0);
+    atomic_init(&engine->unreaped, 0);
+    atomic_init(&engine->nextWorker, 0);
+    atomic_init(&engine->shutdown, 0);
+
+    memcpy(engine->iv[SHA_ALGORITHM_SHA512].h, SHA512_H0, sizeof(engine->iv[0].h));
+    memcpy(engine->iv[SHA_ALGORITHM_SHA384].h, SHA384_H0, sizeof(engine->iv[0].h));
+    memcpy(engine->iv[SHA_ALGORITHM_SHA512_224].h, SHA512_224_H0, sizeof(engine->iv[0].h));
+    memcpy(engine->iv[SHA_ALGORITHM_SHA512_256].h, SHA512_256_H0, sizeof(engine->iv[0].h));
+    for (int a = SHA_ALGORITHM_SHA512; a < SHA_ALGORITHM_COUNT; ++a)
+        engine->iv[a].hashSize = SHAAlgorithmHashSize((SHAAlgorithm)a);
+
+    engine->workers = (AsyncWorker*) calloc(numWorkers, sizeof(AsyncWorker));
+    if (engine->workers == NULL || !ringInit(&engine->completions, roundUpPowerOfTwo(engine->capacity)))
+    {
+        SHAAsyncDestroy(engine);
+        return NULL;
+    }
+    for (int i = 0; i < numWorkers; ++i)
+    {
+        AsyncWorker *worker = &engine->workers[i];
+        if (!ringInit(&worker->submissions, queueSize))
+        {
+            SHAAsyncDestroy(engine);
+            return NULL;
+        }
+        worker->engine = engine;
+        pthread_mutex_init(&worker->lock, NULL);
+        pthread_cond_init(&worker->wake, NULL);
+        atomic_init(&worker->sleeping, 0);
+        engine->numRings = i + 1;
+    }
+
+#ifdef __linux__
+    engine->eventFd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+#endif
+
+    for (int i = 0; i < numWorkers; ++i)
+    {
+        if (pthread_create(&engine->workers[i].thread, NULL, workerMain, &engine->workers[i]) != 0)
+        {
+            SHAAsyncDestroy(engine);
+            return NULL;
+        }
+        engine->numWorkers = i + 1;
+    }
+    return engine;
+}
+
+int SHAAsyncSubmit(SHAAsync *engine, const uint8_t *data, size_t len, SHAAlgorithm algorithm, uint8_t *out,
+                   SHAAsyncCallback callback, void *tag)
+{
+    if (algorithm >= SHA_ALGORITHM_COUNT || (out == NULL && callback == NULL))
+        return 0;
+    if (atomic_fetch_add_explicit(&engine->outstanding, 1, memory_order_acquire) >= engine->capacity)
+    {
+        atomic_fetch_sub_explicit(&engine->outstanding, 1, memory_order_relaxed);
+        return 0;
+    }
+    if (callback == NULL)
+        atomic_fetch_add_explicit(&engine->unreaped, 1, memory_order_relaxed);
+
+    AsyncJob job;
+    job.data = data;
+    job.len = len;
+    job.out = out;
+    job.callback = callback;
+    job.tag = tag;
+    job.algorithm = algorithm;
+
+    // a full ring means its worker is busy, so move on to the next one; the outstanding limit leaves room somewhere
+    size_t first = atomic_fetch_add_explicit(&engine->nextWorker, 1, memory_order_relaxed);
+    AsyncWorker *worker;
+    for (size_t i = 0; ; ++i)
+    {
+        worker = &engine->workers[(first + i) % (size_t)engine->numWorkers];
+        if (ringPush(&worker->submissions, &job))
+            break;
+        if ((i + 1) % (size_t)engine->numWorkers == 0)
+            sched_yield();
+    }
+
+    atomic_thread_fence(memory_order_seq_cst);
+    if (atomic_load_explicit(&worker->sleeping, memory_order_relaxed))
+    {
+        pthread_mutex_lock(&worker->lock);
+        pthread_cond_signal(&worker->wake);
+        pthread_mutex_unlock(&worker->lock);
+    }
+    return 1;
+}
+
+// Blocks until the completion ring may have received a job
+static void waitForCompletions(SHAAsync *engine)
+{
+#ifdef __linux__
+    if (engine->eventFd >= 0)
+    {
+        struct pollfd fd;
+        fd.fd = engine->eventFd;
+        fd.events = POLLIN;
+        poll(&fd, 1, -1);
+        return;
+    }
+#endif
+    (void)engine;
+    sched_yield();
+}
+
+size_t SHAAsyncReap(SHAAsync *engine, void **tags, size_t max, int block)
+{
+    size_t count = 0;
+    for (;;)
+    {
+#ifdef __linux__
+        // reset before draining, so a job posted after the drain makes the descriptor readable again
+        uint64_t signalled;
+        if (engine->eventFd >= 0)
+        {
+            ssize_t got = read(engine->eventFd, &signalled, sizeof(signalled));
+            (void)got;
+        }
+#endif
+        AsyncJob job;
+        while (count < max && ringPop(&engine->completions, &job))
+            tags[count++] = job.tag;
+
+        if (count > 0 || !block || max == 0 || atomic_load(&engine->unreaped) == 0)
+            break;
+        waitForCompletions(engine);
+    }
+
+    if (count > 0)
+    {
+        atomic_fetch_sub_explicit(&engine->unreaped, count, memory_order_relaxed);
+        atomic_fetch_sub_explicit(&engine->outstanding, count, memory_order_release);
+    }
+    if (ringReady(&engine->completions))
+        signalCompletions(engine, 1);
+    return count;
+}
+
+int SHAAsyncEventFd(const SHAAsync *engine)
+{
+    return engine->eventFd;
+}
+
+void SHAAsyncDestroy(SHAAsync *engine)
+{
+    if (engine == NULL)
+        return;
+
+    atomic_store(&engine->shutdown, 1);
+    for (int i = 0; i < engine->numWorkers; ++i)
+    {
+        pthread_mutex_lock(&engine->workers[i].lock);
+        pthread_cond_signal(&engine->workers[i].wake);
+        pthread_mutex_unlock(&engine->workers[i].lock);
+    }
+    for (int i = 0; i < engine->numWorkers; ++i)
+        pthread_join(engine->workers[i].thread, NULL);
+
+    for (int i = 0; i < engine->numRings; ++i)
+    {
+        pthread_mutex_destroy(&engine->workers[i].lock);
+        pthread_cond_destroy(&engine->workers[i].wake);
+        free(engine->workers[i].submissions.cells);
+    }
+#ifdef __linux__
+    if (engine->eventFd >= 0)
+        close(engine->eventFd);
+#endif
+    free(engine->completions.cells);
+    free(engine->workers);
+    free(engine);
+}
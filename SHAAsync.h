@@ -0,0 +1,56 @@
+// Asynchronous hashing service: request threads submit jobs and carry on while dedicated workers hash them
+//
+// Every worker owns a lock-free multi-producer, single-consumer submission ring; submitters spread their
+// jobs over the rings round robin. A worker takes up to maxBatch pending jobs at once, waiting at most
+// the latency cap for a batch to fill, and hashes them side by side with the multi-buffer HashMany kernels.
+// Finished jobs either run their callback on the worker or are posted to a completion ring, which the
+// owner drains with SHAAsyncReap, optionally woken through an eventfd.
+
+#ifndef __SHA_ASYNC_H_
+#define __SHA_ASYNC_H_
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "SHAHasher.h"
+
+// Most jobs a worker hashes as one batch
+#define SHA_ASYNC_MAX_BATCH 64
+
+#define SHA_ASYNC_DEFAULT_QUEUE_SIZE 1024
+#define SHA_ASYNC_DEFAULT_BATCH 16
+#define SHA_ASYNC_DEFAULT_LATENCY_US 20
+
+typedef struct SHAAsync SHAAsync;
+
+/// Called on a worker thread when a job finishes; digest holds SHAAlgorithmHashSize bytes
+typedef void (*SHAAsyncCallback)(void *tag, const uint8_t *digest);
+
+/// Creates an engine with numWorkers hashing threads (one per online CPU if <= 0), each with a submission
+/// ring of queueSize jobs rounded up to a power of two. Workers hash up to maxBatch jobs at once and wait
+/// at most latencyCapMicros for a batch to fill; 0 hashes whatever is pending right away. queueSize and
+/// maxBatch of 0 select the defaults above. Returns NULL on failure
+SHAAsync *SHAAsyncCreate(int numWorkers, size_t queueSize, size_t maxBatch, unsigned latencyCapMicros);
+
+/// Queues the digest of the len byte message at data. data must stay valid and unchanged until the job
+/// finishes, when the digest has been written into out. With a callback, the callback is called with tag
+/// on the worker thread, and out may be NULL. Without one, tag is posted to the completion ring.
+/// Safe to call from any number of threads. Returns 0 if the engine already holds as many unfinished
+/// or unreaped jobs as its rings can take
+int SHAAsyncSubmit(SHAAsync *engine, const uint8_t *data, size_t len, SHAAlgorithm algorithm, uint8_t *out,
+                   SHAAsyncCallback callback, void *tag);
+
+/// Moves the tags of up to max finished jobs without a callback into tags and returns their number.
+/// With block non zero, waits until at least one is available, unless no such job is outstanding.
+/// Only one thread may reap at a time
+size_t SHAAsyncReap(SHAAsync *engine, void **tags, size_t max, int block);
+
+/// Returns a file descriptor that polls readable while finished jobs wait to be reaped, or -1 where
+/// eventfd is not available. SHAAsyncReap resets it
+int SHAAsyncEventFd(const SHAAsync *engine);
+
+/// Waits for the workers to finish every submitted job, stops them and frees the engine.
+/// Jobs that were never reaped are discarded
+void SHAAsyncDestroy(SHAAsync *engine);
+
+#endif //__SHA_ASYNC_H_
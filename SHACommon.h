@@ -1,7 +1,14 @@
 #ifndef __SHA_COMMON_H
 #define __SHA_COMMON_H
 
+#include <stddef.h>
 #include <stdint.h>
+#include <string.h>
+
+// Byte swaps compile to a single instruction with GCC and Clang; other compilers use the portable loops below
+#if defined(__GNUC__) && defined(__BYTE_ORDER__)
+#define SHA_HAVE_BUILTIN_BSWAP 1
+#endif
 
 // Padded message structure, contains message length + message 
 typedef struct PaddedMsg {
@@ -12,6 +19,9 @@ typedef struct PaddedMsg {
 // Swaps the byte order of the 32 bit unsigned integer x
 static inline void endianSwap32(uint32_t *x)
 {
+#ifdef SHA_HAVE_BUILTIN_BSWAP
+    *x = __builtin_bswap32(*x);
+#else
     char *y = (char*)x;
     for (size_t low = 0, high = sizeof(uint32_t) - 1; high > low; ++low, --high)
     {
@@ -19,11 +29,15 @@ static inline void endianSwap32(uint32_t *x)
         y[high] ^= y[low];
         y[low]  ^= y[high];
     }
+#endif
 }
 
 // Swaps the byte order of the 64 bit unsigned integer x
 static inline void endianSwap64(uint64_t *x)
 {
+#ifdef SHA_HAVE_BUILTIN_BSWAP
+    *x = __builtin_bswap64(*x);
+#else
     char *y = (char*)x;
     for (size_t low = 0, high = sizeof(uint64_t) - 1; high > low; ++low, --high)
     {
@@ -31,11 +45,15 @@ static inline void endianSwap64(uint64_t *x)
         y[high] ^= y[low];
         y[low]  ^= y[high];
     }
+#endif
 }
 
 // Swaps the byte order of the 128 bit unsigned integer x
 static inline void endianSwap128(__uint128_t *x)
 {
+#ifdef SHA_HAVE_BUILTIN_BSWAP
+    *x = ((__uint128_t)__builtin_bswap64((uint64_t)*x) << 64) | __builtin_bswap64((uint64_t)(*x >> 64));
+#else
     char *y = (char*)x;
     for (size_t low = 0, high = sizeof(__uint128_t) - 1; high > low; ++low, --high)
     {
@@ -43,6 +61,77 @@ static inline void endianSwap128(__uint128_t *x)
         y[high] ^= y[low];
         y[low]  ^= y[high];
     }
+#endif
+}
+
+// Reads the big endian 32 bit word at p, regardless of alignment or host byte order
+static inline uint32_t loadBigEndian32(const uint8_t *p)
+{
+#ifdef SHA_HAVE_BUILTIN_BSWAP
+    uint32_t x;
+    memcpy(&x, p, sizeof(x));   // an unaligned load
+#if __BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__
+    x = __builtin_bswap32(x);
+#endif
+    return x;
+#else
+    return ((uint32_t)p[0] << 24) | ((uint32_t)p[1] << 16) | ((uint32_t)p[2] << 8) | (uint32_t)p[3];
+#endif
+}
+
+// Reads the big endian 64 bit word at p, regardless of alignment or host byte order
+static inline uint64_t loadBigEndian64(const uint8_t *p)
+{
+#ifdef SHA_HAVE_BUILTIN_BSWAP
+    uint64_t x;
+    memcpy(&x, p, sizeof(x));
+#if __BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__
+    x = __builtin_bswap64(x);
+#endif
+    return x;
+#else
+    return ((uint64_t)loadBigEndian32(p) << 32) | (uint64_t)loadBigEndian32(p + 4);
+#endif
+}
+
+// Writes x to p as a big endian 32 bit word
+static inline void storeBigEndian32(uint8_t *p, uint32_t x)
+{
+#ifdef SHA_HAVE_BUILTIN_BSWAP
+#if __BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__
+    x = __builtin_bswap32(x);
+#endif
+    memcpy(p, &x, sizeof(x));
+#else
+    p[0] = (uint8_t)(x >> 24);
+    p[1] = (uint8_t)(x >> 16);
+    p[2] = (uint8_t)(x >> 8);
+    p[3] = (uint8_t)x;
+#endif
+}
+
+// Writes x to p as a big endian 64 bit word
+static inline void storeBigEndian64(uint8_t *p, uint64_t x)
+{
+#ifdef SHA_HAVE_BUILTIN_BSWAP
+#if __BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__
+    x = __builtin_bswap64(x);
+#endif
+    memcpy(p, &x, sizeof(x));
+#else
+    storeBigEndian32(p, (uint32_t)(x >> 32));
+    storeBigEndian32(p + 4, (uint32_t)x);
+#endif
+}
+
+// Compares two digests in time that depends only on len, not on where they differ.
+// Returns 1 if they are equal, 0 otherwise
+static inline int SHADigestEqual(const uint8_t *a, const uint8_t *b, size_t len)
+{
+    volatile uint8_t diff = 0;
+    for (size_t i = 0; i < len; ++i)
+        diff |= a[i] ^ b[i];
+    return diff == 0;
 }
 
 #endif //__SHA_COMMON_H
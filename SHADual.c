@@ -0,0 +1,37 @@
+// Fused SHA-512 + SHA-256 hashing: both digests of a message from a single pass over its bytes
+
+#include "SHADual.h"
+
+void SHADualInit(SHADualContext *ctx)
+{
+    SHA512Init(&ctx->ctx512);
+    SHA256Init(&ctx->ctx256);
+}
+
+void SHADualUpdate(SHADualContext *ctx, const uint8_t *data, size_t len)
+{
+    // interleave the two compression functions over each piece while it is hot in cache,
+    // rather than streaming the whole input through memory twice
+    while (len > 0)
+    {
+        size_t n = (len < SHA_DUAL_CHUNK_SIZE) ? len : SHA_DUAL_CHUNK_SIZE;
+        SHA512Update(&ctx->ctx512, data, n);
+        SHA256Update(&ctx->ctx256, data, n);
+        data += n;
+        len -= n;
+    }
+}
+
+void SHADualFinal(SHADualContext *ctx, uint8_t digest512[SHA512_HASH_SIZE], uint8_t digest256[SHA256_HASH_SIZE])
+{
+    SHA512Final(&ctx->ctx512, digest512);
+    SHA256Final(&ctx->ctx256, digest256);
+}
+
+void SHADualHashInto(const uint8_t *input, size_t len, uint8_t out512[SHA512_HASH_SIZE], uint8_t out256[SHA256_HASH_SIZE])
+{
+    SHADualContext ctx;
+    SHADualInit(&ctx);
+    SHADualUpdate(&ctx, input, len);
+    SHADualFinal(&ctx, out512, out256);
+}
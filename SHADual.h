@@ -0,0 +1,34 @@
+// Fused SHA-512 + SHA-256 hashing: both digests of a message from a single pass over its bytes
+
+#ifndef __SHA_DUAL_H_
+#define __SHA_DUAL_H_
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "SHA256.h"
+#include "SHA512.h"
+
+// The input is fed to both hashers in pieces of this many bytes, small enough that the piece is still
+// in L1/L2 cache when the second hasher reads it
+#define SHA_DUAL_CHUNK_SIZE (16 * 1024)
+
+/// Streaming state of both hashes of one message
+typedef struct SHADualContext {
+    SHA512Context ctx512;
+    SHA256Context ctx256;
+} SHADualContext;
+
+/// Prepares ctx to hash a new message
+void SHADualInit(SHADualContext *ctx);
+
+/// Absorbs the next len bytes of the message into both hashes, one cache sized piece at a time
+void SHADualUpdate(SHADualContext *ctx, const uint8_t *data, size_t len);
+
+/// Writes the SHA-512 and SHA-256 digests of the message
+void SHADualFinal(SHADualContext *ctx, uint8_t digest512[SHA512_HASH_SIZE], uint8_t digest256[SHA256_HASH_SIZE]);
+
+/// Writes both digests of the len byte message at input, without allocating any memory
+void SHADualHashInto(const uint8_t *input, size_t len, uint8_t out512[SHA512_HASH_SIZE], uint8_t out256[SHA256_HASH_SIZE]);
+
+#endif //__SHA_DUAL_H_
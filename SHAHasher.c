@@ -0,0 +1,163 @@
+// Reusable hashing objects for long running, multithreaded programs
+
+#include <pthread.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "SHAHasher.h"
+
+// Hashers released on one thread, available for reuse by that thread alone
+typedef struct HasherPool {
+    SHAHasher *free;
+    size_t numFree;
+} HasherPool;
+
+static pthread_key_t poolKey;
+static pthread_once_t poolKeyOnce = PTHREAD_ONCE_INIT;
+
+static const struct
+{
+    const char *name;
+    size_t hashSize;
+} algorithms[SHA_ALGORITHM_COUNT] =
+{
+    { "SHA-256", SHA256_HASH_SIZE },
+    { "SHA-512", SHA512_HASH_SIZE },
+    { "SHA-384", SHA384_HASH_SIZE },
+    { "SHA-512/224", SHA512_224_HASH_SIZE },
+    { "SHA-512/256", SHA512_256_HASH_SIZE },
+};
+
+size_t SHAAlgorithmHashSize(SHAAlgorithm algorithm)
+{
+    return (algorithm < SHA_ALGORITHM_COUNT) ? algorithms[algorithm].hashSize : 0;
+}
+
+const char *SHAAlgorithmName(SHAAlgorithm algorithm)
+{
+    return (algorithm < SHA_ALGORITHM_COUNT) ? algorithms[algorithm].name : NULL;
+}
+
+void SHAHashInto(SHAAlgorithm algorithm, const uint8_t *input, size_t len, uint8_t *out)
+{
+    switch (algorithm)
+    {
+        case SHA_ALGORITHM_SHA256:     SHA256HashInto(input, len, out); break;
+        case SHA_ALGORITHM_SHA512:     SHA512HashInto(input, len, out); break;
+        case SHA_ALGORITHM_SHA384:     SHA384HashInto(input, len, out); break;
+        case SHA_ALGORITHM_SHA512_224: SHA512_224HashInto(input, len, out); break;
+        case SHA_ALGORITHM_SHA512_256: SHA512_256HashInto(input, len, out); break;
+        default: break;
+    }
+}
+
+void SHAHasherInit(SHAHasher *hasher, SHAAlgorithm algorithm)
+{
+    hasher->algorithm = algorithm;
+    hasher->next = NULL;
+    SHAHasherReset(hasher);
+}
+
+void SHAHasherReset(SHAHasher *hasher)
+{
+    switch (hasher->algorithm)
+    {
+        case SHA_ALGORITHM_SHA256:     SHA256Init(&hasher->ctx.sha256); break;
+        case SHA_ALGORITHM_SHA512:     SHA512Init(&hasher->ctx.sha512); break;
+        case SHA_ALGORITHM_SHA384:     SHA384Init(&hasher->ctx.sha512); break;
+        case SHA_ALGORITHM_SHA512_224: SHA512_224Init(&hasher->ctx.sha512); break;
+        case SHA_ALGORITHM_SHA512_256: SHA512_256Init(&hasher->ctx.sha512); break;
+        default: break;
+    }
+}
+
+void SHAHasherUpdate(SHAHasher *hasher, const uint8_t *data, size_t len)
+{
+    if (hasher->algorithm == SHA_ALGORITHM_SHA256)
+        SHA256Update(&hasher->ctx.sha256, data, len);
+    else
+        SHA512Update(&hasher->ctx.sha512, data, len);
+}
+
+const uint8_t *SHAHasherFinal(SHAHasher *hasher)
+{
+    // the SHA-512 context knows the digest size of its variant
+    if (hasher->algorithm == SHA_ALGORITHM_SHA256)
+        SHA256Final(&hasher->ctx.sha256, hasher->digest);
+    else
+        SHA512Final(&hasher->ctx.sha512, hasher->digest);
+    SHAHasherReset(hasher);
+    return hasher->digest;
+}
+
+// Frees the pool of an exiting thread and every hasher in it
+static void destroyPool(void *arg)
+{
+    HasherPool *pool = (HasherPool*)arg;
+    while (pool->free != NULL)
+    {
+        SHAHasher *hasher = pool->free;
+        pool->free = hasher->next;
+        free(hasher);
+    }
+    free(pool);
+}
+
+static void createPoolKey(void)
+{
+    pthread_key_create(&poolKey, destroyPool);
+}
+
+// Returns the calling thread's pool, creating it on first use. Returns NULL if it cannot be allocated
+static HasherPool *threadPool(void)
+{
+    pthread_once(&poolKeyOnce, createPoolKey);
+    HasherPool *pool = (HasherPool*) pthread_getspecific(poolKey);
+    if (pool != NULL)
+        return pool;
+
+    pool = (HasherPool*) calloc(1, sizeof(HasherPool));
+    if (pool != NULL && pthread_setspecific(poolKey, pool) != 0)
+    {
+        free(pool);
+        pool = NULL;
+    }
+    return pool;
+}
+
+SHAHasher *SHAHasherAcquire(SHAAlgorithm algorithm)
+{
+    HasherPool *pool = threadPool();
+    SHAHasher *hasher = NULL;
+    if (pool != NULL && pool->free != NULL)
+    {
+        hasher = pool->free;
+        pool->free = hasher->next;
+        --pool->numFree;
+    }
+    else
+    {
+        hasher = (SHAHasher*) malloc(sizeof(SHAHasher));
+        if (hasher == NULL)
+            return NULL;
+    }
+
+    SHAHasherInit(hasher, algorithm);
+    return hasher;
+}
+
+void SHAHasherRelease(SHAHasher *hasher)
+{
+    if (hasher == NULL)
+        return;
+
+    HasherPool *pool = threadPool();
+    if (pool == NULL || pool->numFree >= SHA_HASHER_POOL_MAX)
+    {
+        free(hasher);
+        return;
+    }
+    hasher->next = pool->free;
+    pool->free = hasher;
+    ++pool->numFree;
+}
@@ -0,0 +1,69 @@
+// Reusable hashing objects for long running, multithreaded programs
+//
+// A SHAHasher holds the streaming state and the digest of any supported algorithm and can be reset and reused
+// indefinitely. SHAHasherAcquire hands out hashers from a pool owned by the calling thread, so in steady state
+// hashing neither allocates nor touches state shared with other threads.
+
+#ifndef __SHA_HASHER_H_
+#define __SHA_HASHER_H_
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "SHA256.h"
+#include "SHA512.h"
+
+// Released hashers beyond this many per thread are freed instead of kept for reuse
+#define SHA_HASHER_POOL_MAX 64
+
+typedef enum SHAAlgorithm {
+    SHA_ALGORITHM_SHA256,
+    SHA_ALGORITHM_SHA512,
+    SHA_ALGORITHM_SHA384,
+    SHA_ALGORITHM_SHA512_224,
+    SHA_ALGORITHM_SHA512_256,
+    SHA_ALGORITHM_COUNT
+} SHAAlgorithm;
+
+/// Streaming state and output slot of one hash computation
+typedef struct SHAHasher {
+    SHAAlgorithm algorithm;
+    union {
+        SHA256Context sha256;
+        SHA512Context sha512;       // also SHA-384 and SHA-512/t
+    } ctx;
+    uint8_t digest[SHA512_HASH_SIZE];
+    struct SHAHasher *next;         // free list link while the hasher sits in a pool
+} SHAHasher;
+
+/// Returns the digest size of the algorithm in bytes, or 0 for an unknown algorithm
+size_t SHAAlgorithmHashSize(SHAAlgorithm algorithm);
+
+/// Returns the conventional name of the algorithm, e.g. "SHA-512/256", or NULL for an unknown algorithm
+const char *SHAAlgorithmName(SHAAlgorithm algorithm);
+
+/// Writes the digest of the len byte message at input into out, which must hold SHAAlgorithmHashSize bytes
+void SHAHashInto(SHAAlgorithm algorithm, const uint8_t *input, size_t len, uint8_t *out);
+
+/// Prepares hasher to hash messages with the given algorithm
+void SHAHasherInit(SHAHasher *hasher, SHAAlgorithm algorithm);
+
+/// Discards any absorbed input, so the hasher can start a new message with the same algorithm
+void SHAHasherReset(SHAHasher *hasher);
+
+/// Absorbs the next len bytes of the message
+void SHAHasherUpdate(SHAHasher *hasher, const uint8_t *data, size_t len);
+
+/// Finishes the message and returns its digest, stored in the hasher until the next Final, and resets
+/// the hasher for the next message
+const uint8_t *SHAHasherFinal(SHAHasher *hasher);
+
+/// Returns an initialized hasher from the calling thread's pool, allocating one only if the pool is empty.
+/// Returns NULL if that allocation fails
+SHAHasher *SHAHasherAcquire(SHAAlgorithm algorithm);
+
+/// Returns a hasher from SHAHasherAcquire to the calling thread's pool. Hashers may be released on a
+/// different thread than the one that acquired them. Pooled hashers are freed when their thread exits
+void SHAHasherRelease(SHAHasher *hasher);
+
+#endif //__SHA_HASHER_H_
@@ -0,0 +1,102 @@
+// Declarations shared between the translation units of the library; not part of the public API
+
+#ifndef __SHA_INTERNAL_H
+#define __SHA_INTERNAL_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "config.h"
+#include "ThreadPool.h"
+
+// Defined when the compiler can build x86 SIMD code paths that are selected at runtime
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#define SHA_HAVE_X86_SIMD 1
+#endif
+
+// Overwrites len bytes at p with zeros in a way the compiler may not remove as a dead store,
+// so keys and intermediate secrets do not linger in memory
+static inline void secureWipe(void *p, size_t len)
+{
+    volatile uint8_t *bytes = (volatile uint8_t*)p;
+    while (len-- > 0)
+        *bytes++ = 0;
+}
+
+// SHA256 round constants and initial hash value
+extern const uint32_t SHA256_K[64];
+extern const uint32_t SHA256_H0[8];
+
+// Compresses numBlocks consecutive 64 byte big endian blocks into the intermediate hash value h,
+// using the engine selected by SHA256SetEngine
+void sha256Blocks(uint32_t h[8], const uint8_t *blocks, size_t numBlocks);
+
+// Message schedule of the padding block that follows a message of exactly 64 bytes: the 1 bit, zeros and the
+// bit length 512. It is the same for every such message
+extern const uint32_t SHA256_PAD64_SCHEDULE[64];
+
+// Compresses a block whose whole 64 word message schedule is already known into h, skipping the schedule
+void sha256Scheduled(uint32_t h[8], const uint32_t schedule[64]);
+
+#ifdef SHA_HAVE_X86_SIMD
+// x86 implementations of sha256Blocks, see SHA256x86.c
+void sha256BlocksSSSE3(uint32_t h[8], const uint8_t *blocks, size_t numBlocks);
+void sha256BlocksAVX2(uint32_t h[8], const uint8_t *blocks, size_t numBlocks);
+void sha256BlocksSHANI(uint32_t h[8], const uint8_t *blocks, size_t numBlocks);
+void sha256ScheduledSHANI(uint32_t h[8], const uint32_t schedule[64]);
+
+// Returns non zero if the CPU implements the SHA extensions (and SSE4.1, which the SHA-NI code needs)
+int sha256CpuHasSHANI(void);
+#endif
+
+// SHA512 round constants and initial hash value
+extern const uint64_t SHA512_K[80];
+extern const uint64_t SHA512_H0[8];
+
+// Initial hash values of SHA-384, SHA-512/224 and SHA-512/256
+extern const uint64_t SHA384_H0[8];
+extern const uint64_t SHA512_224_H0[8];
+extern const uint64_t SHA512_256_H0[8];
+
+// Compresses numBlocks consecutive 128 byte big endian blocks into the intermediate hash value h
+void sha512Blocks(uint64_t h[8], const uint8_t *blocks, size_t numBlocks);
+
+// Leaf and node functions of one hash algorithm of the tree hash, see TreeHash.h
+typedef struct TreeHashFns {
+    size_t hashSize;
+    void (*leaf)(const uint8_t *leaf, size_t len, uint8_t *out);
+    void (*node)(const uint8_t *left, const uint8_t *right, uint8_t *out);
+} TreeHashFns;
+
+extern const TreeHashFns treeHashSHA256Fns;
+extern const TreeHashFns treeHashSHA512Fns;
+
+// Builds one level of a tree hash, on the threads of pool (or the calling thread if it is NULL).
+// treeHashLeaves writes the digests of the numLeaves leaves of data to out; treeHashLevel pairs the
+// inCount digests at in into the (inCount + 1) / 2 digests of the next level, carrying an unpaired last
+// digest up unchanged, and keeps levels too narrow to be worth waking the pool on the calling thread
+void treeHashLeaves(const TreeHashFns *fns, const uint8_t *data, size_t len, size_t leafSize, size_t numLeaves,
+                    ThreadPool *pool, uint8_t *out);
+void treeHashLevel(const TreeHashFns *fns, const uint8_t *in, size_t inCount, ThreadPool *pool, uint8_t *out);
+
+// Statistics, see SHAStats.h. SHA_STATS_BEGIN enters a call of an entry point and SHA_STATS_END records it
+// with the bytes and blocks it processed; only the outermost call on a thread reads the clock. Every BEGIN
+// must be matched by an END. SHA_STATS_COUNT counts a call of an inner path, such as a block function,
+// without timing it. All of them compile to nothing unless the build enables SHA_STATS
+#ifdef SHA_STATS
+#include "SHAStats.h"
+
+uint64_t shaStatsEnter(void);
+void shaStatsLeave(int path, uint64_t start, uint64_t bytes, uint64_t blocks);
+void shaStatsCount(int path, uint64_t bytes, uint64_t blocks);
+
+#define SHA_STATS_BEGIN(start) uint64_t start = shaStatsEnter()
+#define SHA_STATS_END(path, start, bytes, blocks) shaStatsLeave((path), (start), (bytes), (blocks))
+#define SHA_STATS_COUNT(path, bytes, blocks) shaStatsCount((path), (bytes), (blocks))
+#else
+#define SHA_STATS_BEGIN(start) ((void)0)
+#define SHA_STATS_END(path, start, bytes, blocks) ((void)0)
+#define SHA_STATS_COUNT(path, bytes, blocks) ((void)0)
+#endif
+
+#endif //__SHA_INTERNAL_H
@@ -0,0 +1,257 @@
+// Hashing statistics: which code paths ran, on how much data, and how long they took
+
+#include <string.h>
+
+#include "SHAInternal.h"
+#include "SHAStats.h"
+
+static const char *pathNames[SHA_STATS_PATH_COUNT] =
+{
+    "sha256",
+    "sha256d",
+    "sha256 hash64",
+    "sha512",
+    "sha384",
+    "sha512/224",
+    "sha512/256",
+    "sha256 scalar",
+    "sha256 ssse3",
+    "sha256 avx2",
+    "sha256 sha-ni",
+    "sha512 blocks",
+    "sha256 many",
+    "sha512 many",
+    "preprocess",
+    "preprocess256",
+    "byte swap",
+    "getHash",
+    "get256Hash",
+};
+
+const char *SHAStatsPathName(SHAStatsPath path)
+{
+    return (path < SHA_STATS_PATH_COUNT) ? pathNames[path] : NULL;
+}
+
+uint64_t SHAStatsLatencyPercentile(const SHAStatsCounters *counters, double fraction)
+{
+    uint64_t timed = 0, seen = 0;
+    for (int i = 0; i < SHA_STATS_LATENCY_BUCKETS; ++i)
+        timed += counters->latency[i];
+    for (int i = 0; i < SHA_STATS_LATENCY_BUCKETS && timed > 0; ++i)
+    {
+        seen += counters->latency[i];
+        if ((double)seen >= fraction * (double)timed)
+            return 2ULL << i;
+    }
+    return 0;
+}
+
+#ifdef SHA_STATS
+
+#include <pthread.h>
+#include <stdatomic.h>
+#include <stdlib.h>
+#include <time.h>
+
+// Counters of one path in one thread. Only the owning thread writes them, so a relaxed load and store
+// is enough to add to them and costs no more than a plain add; other threads only read them
+typedef struct PathCounters {
+    atomic_ullong calls;
+    atomic_ullong bytes;
+    atomic_ullong blocks;
+    atomic_ullong nanos;
+    atomic_ullong latency[SHA_STATS_LATENCY_BUCKETS];
+} PathCounters;
+
+typedef struct ThreadStats {
+    PathCounters paths[SHA_STATS_PATH_COUNT];
+    struct ThreadStats *prev;
+    struct ThreadStats *next;
+} ThreadStats;
+
+// Every thread that has recorded anything is on the live list until it exits, when its counters move
+// into retired. Resetting records the current totals as the baseline that snapshots subtract, so it
+// never writes to another thread's counters
+static pthread_mutex_t registryLock = PTHREAD_MUTEX_INITIALIZER;
+static ThreadStats *liveThreads;
+static SHAStatsSnapshot retired;
+static SHAStatsSnapshot baseline;
+
+static pthread_key_t statsKey;
+static pthread_once_t statsKeyOnce = PTHREAD_ONCE_INIT;
+static _Thread_local ThreadStats *threadStats;
+
+// Number of entry point calls in progress on this thread; only the outermost one is timed
+static _Thread_local int callDepth;
+
+static void addCounters(SHAStatsCounters *sum, const PathCounters *counters)
+{
+    sum->calls += atomic_load_explicit(&counters->calls, memory_order_relaxed);
+    sum->bytes += atomic_load_explicit(&counters->bytes, memory_order_relaxed);
+    sum->blocks += atomic_load_explicit(&counters->blocks, memory_order_relaxed);
+    sum->nanos += atomic_load_explicit(&counters->nanos, memory_order_relaxed);
+    for (int i = 0; i < SHA_STATS_LATENCY_BUCKETS; ++i)
+        sum->latency[i] += atomic_load_explicit(&counters->latency[i], memory_order_relaxed);
+}
+
+// Folds the counters of an exiting thread into retired
+static void retireThread(void *arg)
+{
+    ThreadStats *stats = (ThreadStats*)arg;
+    pthread_mutex_lock(&registryLock);
+    for (int p = 0; p < SHA_STATS_PATH_COUNT; ++p)
+        addCounters(&retired.paths[p], &stats->paths[p]);
+    if (stats->prev != NULL)
+        stats->prev->next = stats->next;
+    else
+        liveThreads = stats->next;
+    if (stats->next != NULL)
+        stats->next->prev = stats->prev;
+    pthread_mutex_unlock(&registryLock);
+    free(stats);
+}
+
+static void createStatsKey(void)
+{
+    pthread_key_create(&statsKey, retireThread);
+}
+
+static ThreadStats *registerThread(void)
+{
+    pthread_once(&statsKeyOnce, createStatsKey);
+    ThreadStats *stats = (ThreadStats*) calloc(1, sizeof(ThreadStats));
+    if (stats == NULL)
+        return NULL;
+
+    pthread_mutex_lock(&registryLock);
+    stats->next = liveThreads;
+    if (liveThreads != NULL)
+        liveThreads->prev = stats;
+    liveThreads = stats;
+    pthread_mutex_unlock(&registryLock);
+
+    pthread_setspecific(statsKey, stats);
+    threadStats = stats;
+    return stats;
+}
+
+static inline void bump(atomic_ullong *counter, uint64_t n)
+{
+    atomic_store_explicit(counter, atomic_load_explicit(counter, memory_order_relaxed) + n, memory_order_relaxed);
+}
+
+static uint64_t now(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ULL + (uint64_t)ts.tv_nsec;
+}
+
+// Returns the counters of path in this thread, or NULL if they cannot be allocated
+static PathCounters *threadCounters(int path)
+{
+    ThreadStats *stats = threadStats;
+    if (stats == NULL && (stats = registerThread()) == NULL)
+        return NULL;
+    return &stats->paths[path];
+}
+
+void shaStatsCount(int path, uint64_t bytes, uint64_t blocks)
+{
+    PathCounters *counters = threadCounters(path);
+    if (counters == NULL)
+        return;
+    bump(&counters->calls, 1);
+    bump(&counters->bytes, bytes);
+    bump(&counters->blocks, blocks);
+}
+
+uint64_t shaStatsEnter(void)
+{
+    return (callDepth++ == 0) ? now() : 0;
+}
+
+void shaStatsLeave(int path, uint64_t start, uint64_t bytes, uint64_t blocks)
+{
+    // the time of a nested call is already part of the outermost one's
+    if (--callDepth > 0)
+    {
+        shaStatsCount(path, bytes, blocks);
+        return;
+    }
+
+    uint64_t nanos = now() - start;
+    PathCounters *counters = threadCounters(path);
+    if (counters == NULL)
+        return;
+
+    int bucket = (nanos > 1) ? 63 - __builtin_clzll(nanos) : 0;
+    if (bucket >= SHA_STATS_LATENCY_BUCKETS)
+        bucket = SHA_STATS_LATENCY_BUCKETS - 1;
+
+    bump(&counters->calls, 1);
+    bump(&counters->bytes, bytes);
+    bump(&counters->blocks, blocks);
+    bump(&counters->nanos, nanos);
+    bump(&counters->latency[bucket], 1);
+}
+
+// Adds up every thread's counters since the library was loaded; the caller holds registryLock
+static void totals(SHAStatsSnapshot *sum)
+{
+    *sum = retired;
+    for (ThreadStats *stats = liveThreads; stats != NULL; stats = stats->next)
+    {
+        for (int p = 0; p < SHA_STATS_PATH_COUNT; ++p)
+            addCounters(&sum->paths[p], &stats->paths[p]);
+    }
+}
+
+int SHAStatsEnabled(void)
+{
+    return 1;
+}
+
+void SHAStatsGetSnapshot(SHAStatsSnapshot *snapshot)
+{
+    pthread_mutex_lock(&registryLock);
+    totals(snapshot);
+    for (int p = 0; p < SHA_STATS_PATH_COUNT; ++p)
+    {
+        SHAStatsCounters *sum = &snapshot->paths[p];
+        const SHAStatsCounters *base = &baseline.paths[p];
+        sum->calls -= base->calls;
+        sum->bytes -= base->bytes;
+        sum->blocks -= base->blocks;
+        sum->nanos -= base->nanos;
+        for (int i = 0; i < SHA_STATS_LATENCY_BUCKETS; ++i)
+            sum->latency[i] -= base->latency[i];
+    }
+    pthread_mutex_unlock(&registryLock);
+}
+
+void SHAStatsReset(void)
+{
+    pthread_mutex_lock(&registryLock);
+    totals(&baseline);
+    pthread_mutex_unlock(&registryLock);
+}
+
+#else
+
+int SHAStatsEnabled(void)
+{
+    return 0;
+}
+
+void SHAStatsGetSnapshot(SHAStatsSnapshot *snapshot)
+{
+    memset(snapshot, 0, sizeof(*snapshot));
+}
+
+void SHAStatsReset(void)
+{
+}
+
+#endif
@@ -0,0 +1,69 @@
+// Hashing statistics: which code paths ran, on how much data, and how long they took
+//
+// Collected only in builds configured with -DSHA_STATS=ON; otherwise the instrumentation compiles out
+// of the library and every snapshot is empty. Each thread counts into its own counters, so recording
+// never contends; a snapshot adds up the counters of all threads, including those that have exited.
+// Paths nest: a SHA256HashInto call also shows up under the engine that compressed its blocks. Only the
+// outermost call on a thread is timed, so nanos and the latency histogram cover the calls that were not
+// made from within another path, and the block functions of the engines are never timed at all.
+
+#ifndef __SHA_STATS_H_
+#define __SHA_STATS_H_
+
+#include <stdint.h>
+
+// Latency bucket i counts timed calls that took [2^i, 2^(i+1)) nanoseconds; bucket 0 also counts 0 ns
+#define SHA_STATS_LATENCY_BUCKETS 40
+
+typedef enum SHAStatsPath {
+    SHA_STATS_SHA256,           // one-shot SHA-256: SHA256HashInto, SHA256Hash
+    SHA_STATS_SHA256D,          // SHA256dHashInto
+    SHA_STATS_SHA256_HASH64,    // SHA256Hash64Into
+    SHA_STATS_SHA512,           // one-shot SHA-512 family, by digest
+    SHA_STATS_SHA384,
+    SHA_STATS_SHA512_224,
+    SHA_STATS_SHA512_256,
+    SHA_STATS_SHA256_SCALAR,    // sha256Blocks, one path per engine in SHA256Engine order
+    SHA_STATS_SHA256_SSSE3,
+    SHA_STATS_SHA256_AVX2,
+    SHA_STATS_SHA256_SHANI,
+    SHA_STATS_SHA512_BLOCKS,    // sha512Blocks
+    SHA_STATS_SHA256_MANY,      // batches hashed in SIMD lanes by SHA256HashMany and friends
+    SHA_STATS_SHA512_MANY,
+    SHA_STATS_PREPROCESS,       // the reference path: padding, byte swapping and compression
+    SHA_STATS_PREPROCESS256,
+    SHA_STATS_BYTE_SWAP,
+    SHA_STATS_GET_HASH,
+    SHA_STATS_GET256_HASH,
+    SHA_STATS_PATH_COUNT
+} SHAStatsPath;
+
+typedef struct SHAStatsCounters {
+    uint64_t calls;
+    uint64_t bytes;
+    uint64_t blocks;
+    uint64_t nanos;
+    uint64_t latency[SHA_STATS_LATENCY_BUCKETS];
+} SHAStatsCounters;
+
+typedef struct SHAStatsSnapshot {
+    SHAStatsCounters paths[SHA_STATS_PATH_COUNT];
+} SHAStatsSnapshot;
+
+/// Returns non zero if this build of the library collects statistics
+int SHAStatsEnabled(void);
+
+/// Returns a short name of the path, e.g. "sha256 sha-ni", or NULL for an unknown path
+const char *SHAStatsPathName(SHAStatsPath path);
+
+/// Adds up the counters of every thread since the last SHAStatsReset
+void SHAStatsGetSnapshot(SHAStatsSnapshot *snapshot);
+
+/// Starts the counters of every thread over from zero
+void SHAStatsReset(void);
+
+/// Returns an upper bound of the latency under which the given fraction of the path's timed calls
+/// completed, in nanoseconds, or 0 if it has none
+uint64_t SHAStatsLatencyPercentile(const SHAStatsCounters *counters, double fraction);
+
+#endif //__SHA_STATS_H_
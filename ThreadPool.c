@@ -0,0 +1,228 @@
+// Work-stealing thread pool used to spread independent hashing tasks across cores
+
+#include <pthread.h>
+#include <stdlib.h>
+#include <unistd.h>
+
+#include "ThreadPool.h"
+
+// Indices [next, end) still owned by one thread. Padded so that neighbouring ranges do not share a cache line
+typedef struct WorkRange {
+    pthread_mutex_t lock;
+    size_t next;
+    size_t end;
+    char pad[64];
+} WorkRange;
+
+struct ThreadPool {
+    int numThreads;
+    pthread_t *threads;
+    WorkRange *ranges;
+
+    pthread_mutex_t lock;
+    pthread_cond_t start;
+    pthread_cond_t done;
+    unsigned long generation;   // incremented for each ThreadPoolRun call
+    int busyWorkers;            // workers that have not yet finished the current run
+    int shutdown;
+
+    ThreadPoolTask task;
+    void *arg;
+};
+
+typedef struct WorkerArg {
+    ThreadPool *pool;
+    int id;
+} WorkerArg;
+
+// Takes the next index of the thread's own range
+static int takeOwn(WorkRange *range, size_t *index)
+{
+    int found = 0;
+    pthread_mutex_lock(&range->lock);
+    if (range->next < range->end)
+    {
+        *index = range->next++;
+        found = 1;
+    }
+    pthread_mutex_unlock(&range->lock);
+    return found;
+}
+
+// Moves the upper half of another thread's remaining indices into the range of thread id
+static int steal(ThreadPool *pool, int id)
+{
+    for (int i = 1; i < pool->numThreads; ++i)
+    {
+        WorkRange *victim = &pool->ranges[(id + i) % pool->numThreads];
+        size_t lo = 0, hi = 0;
+
+        pthread_mutex_lock(&victim->lock);
+        if (victim->next < victim->end)
+        {
+            hi = victim->end;
+            lo = victim->next + (victim->end - victim->next) / 2;
+            victim->end = lo;
+        }
+        pthread_mutex_unlock(&victim->lock);
+
+        if (lo < hi)
+        {
+            WorkRange *own = &pool->ranges[id];
+            pthread_mutex_lock(&own->lock);
+            own->next = lo;
+            own->end = hi;
+            pthread_mutex_unlock(&own->lock);
+            return 1;
+        }
+    }
+    return 0;
+}
+
+// Runs tasks until no thread has indices left
+static void work(ThreadPool *pool, int id)
+{
+    size_t index;
+    do
+    {
+        while (takeOwn(&pool->ranges[id], &index))
+            pool->task(pool->arg, index);
+    } while (steal(pool, id));
+}
+
+static void *workerMain(void *p)
+{
+    WorkerArg *workerArg = (WorkerArg*)p;
+    ThreadPool *pool = workerArg->pool;
+    int id = workerArg->id;
+    free(workerArg);
+
+    unsigned long seen = 0;
+    for (;;)
+    {
+        pthread_mutex_lock(&pool->lock);
+        while (!pool->shutdown && pool->generation == seen)
+            pthread_cond_wait(&pool->start, &pool->lock);
+        if (pool->shutdown)
+        {
+            pthread_mutex_unlock(&pool->lock);
+            return NULL;
+        }
+        seen = pool->generation;
+        pthread_mutex_unlock(&pool->lock);
+
+        work(pool, id);
+
+        pthread_mutex_lock(&pool->lock);
+        if (--pool->busyWorkers == 0)
+            pthread_cond_signal(&pool->done);
+        pthread_mutex_unlock(&pool->lock);
+    }
+}
+
+ThreadPool *ThreadPoolCreate(int numThreads)
+{
+    if (numThreads <= 0)
+    {
+        long cpus = sysconf(_SC_NPROCESSORS_ONLN);
+        numThreads = (cpus > 0) ? (int)cpus : 1;
+    }
+
+    ThreadPool *pool = (ThreadPool*) calloc(1, sizeof(ThreadPool));
+    if (pool == NULL)
+        return NULL;
+    pool->numThreads = numThreads;
+    pool->threads = (pthread_t*) calloc(numThreads, sizeof(pthread_t));
+    pool->ranges = (WorkRange*) calloc(numThreads, sizeof(WorkRange));
+    if (pool->threads == NULL || pool->ranges == NULL)
+    {
+        free(pool->threads);
+        free(pool->ranges);
+        free(pool);
+        return NULL;
+    }
+
+    pthread_mutex_init(&pool->lock, NULL);
+    pthread_cond_init(&pool->start, NULL);
+    pthread_cond_init(&pool->done, NULL);
+    for (int i = 0; i < numThreads; ++i)
+        pthread_mutex_init(&pool->ranges[i].lock, NULL);
+
+    // thread 0 is whichever thread calls ThreadPoolRun
+    for (int i = 1; i < numThreads; ++i)
+    {
+        WorkerArg *workerArg = (WorkerArg*) malloc(sizeof(WorkerArg));
+        if (workerArg != NULL)
+        {
+            workerArg->pool = pool;
+            workerArg->id = i;
+        }
+        if (workerArg == NULL || pthread_create(&pool->threads[i], NULL, workerMain, workerArg) != 0)
+        {
+            free(workerArg);
+            pool->numThreads = i;
+            ThreadPoolDestroy(pool);
+            return NULL;
+        }
+    }
+    return pool;
+}
+
+int ThreadPoolSize(const ThreadPool *pool)
+{
+    return (pool != NULL) ? pool->numThreads : 1;
+}
+
+void ThreadPoolRun(ThreadPool *pool, size_t count, ThreadPoolTask task, void *arg)
+{
+    if (pool == NULL || pool->numThreads == 1 || count < 2)
+    {
+        for (size_t i = 0; i < count; ++i)
+            task(arg, i);
+        return;
+    }
+
+    for (int i = 0; i < pool->numThreads; ++i)
+    {
+        pool->ranges[i].next = count * i / pool->numThreads;
+        pool->ranges[i].end = count * (i + 1) / pool->numThreads;
+    }
+
+    pthread_mutex_lock(&pool->lock);
+    pool->task = task;
+    pool->arg = arg;
+    pool->busyWorkers = pool->numThreads - 1;
+    ++pool->generation;
+    pthread_cond_broadcast(&pool->start);
+    pthread_mutex_unlock(&pool->lock);
+
+    work(pool, 0);
+
+    pthread_mutex_lock(&pool->lock);
+    while (pool->busyWorkers > 0)
+        pthread_cond_wait(&pool->done, &pool->lock);
+    pthread_mutex_unlock(&pool->lock);
+}
+
+void ThreadPoolDestroy(ThreadPool *pool)
+{
+    if (pool == NULL)
+        return;
+
+    pthread_mutex_lock(&pool->lock);
+    pool->shutdown = 1;
+    pthread_cond_broadcast(&pool->start);
+    pthread_mutex_unlock(&pool->lock);
+
+    for (int i = 1; i < pool->numThreads; ++i)
+        pthread_join(pool->threads[i], NULL);
+
+    for (int i = 0; i < pool->numThreads; ++i)
+        pthread_mutex_destroy(&pool->ranges[i].lock);
+    pthread_mutex_destroy(&pool->lock);
+    pthread_cond_destroy(&pool->start);
+    pthread_cond_destroy(&pool->done);
+    free(pool->threads);
+    free(pool->ranges);
+    free(pool);
+}
@@ -0,0 +1,28 @@
+// Work-stealing thread pool used to spread independent hashing tasks across cores
+
+#ifndef __THREAD_POOL_H_
+#define __THREAD_POOL_H_
+
+#include <stddef.h>
+
+typedef struct ThreadPool ThreadPool;
+
+/// Runs one unit of work; index identifies the unit within the current ThreadPoolRun call
+typedef void (*ThreadPoolTask)(void *arg, size_t index);
+
+/// Creates a pool that runs tasks on numThreads threads, counting the thread that calls ThreadPoolRun.
+/// numThreads <= 0 uses one thread per online CPU. Returns NULL on failure
+ThreadPool *ThreadPoolCreate(int numThreads);
+
+/// Returns the number of threads that execute tasks, including the caller of ThreadPoolRun
+int ThreadPoolSize(const ThreadPool *pool);
+
+/// Calls task(arg, i) for every i in [0, count) and returns once all calls have completed.
+/// The indices are split evenly between the threads; a thread that runs out steals half of
+/// the remaining indices of another. A NULL pool runs every task on the calling thread
+void ThreadPoolRun(ThreadPool *pool, size_t count, ThreadPoolTask task, void *arg);
+
+/// Stops the worker threads and frees the pool
+void ThreadPoolDestroy(ThreadPool *pool);
+
+#endif //__THREAD_POOL_H_
@@ -0,0 +1,149 @@
+// Parallel tree hashing: a Merkle tree over fixed-size leaves, built on the SHA-256 and SHA-512 compression functions
+
+#include <stdlib.h>
+#include <string.h>
+
+#include "SHAInternal.h"
+#include "TreeHash.h"
+
+// Levels narrower than this are combined on the calling thread; waking the pool would cost more than it saves
+#define PARALLEL_LEVEL_MIN_NODES 256
+
+// Shared state of the tasks of one level
+typedef struct TreeLevel {
+    const TreeHashFns *fns;
+    const uint8_t *data;    // input bytes, when hashing leaves
+    size_t len;
+    size_t leafSize;
+    const uint8_t *in;      // digests of the level below, when hashing nodes
+    size_t inCount;
+    uint8_t *out;
+} TreeLevel;
+
+void SHA256TreeLeaf(const uint8_t *leaf, size_t len, uint8_t out[SHA256_HASH_SIZE])
+{
+    const uint8_t prefix = TREE_HASH_LEAF_PREFIX;
+    SHA256Context ctx;
+    SHA256Init(&ctx);
+    SHA256Update(&ctx, &prefix, 1);
+    SHA256Update(&ctx, leaf, len);
+    SHA256Final(&ctx, out);
+}
+
+void SHA512TreeLeaf(const uint8_t *leaf, size_t len, uint8_t out[SHA512_HASH_SIZE])
+{
+    const uint8_t prefix = TREE_HASH_LEAF_PREFIX;
+    SHA512Context ctx;
+    SHA512Init(&ctx);
+    SHA512Update(&ctx, &prefix, 1);
+    SHA512Update(&ctx, leaf, len);
+    SHA512Final(&ctx, out);
+}
+
+void SHA256TreeNode(const uint8_t left[SHA256_HASH_SIZE], const uint8_t right[SHA256_HASH_SIZE], uint8_t out[SHA256_HASH_SIZE])
+{
+    uint8_t msg[1 + 2 * SHA256_HASH_SIZE];
+    msg[0] = TREE_HASH_NODE_PREFIX;
+    memcpy(&msg[1], left, SHA256_HASH_SIZE);
+    memcpy(&msg[1 + SHA256_HASH_SIZE], right, SHA256_HASH_SIZE);
+    SHA256HashInto(msg, sizeof(msg), out);
+}
+
+void SHA512TreeNode(const uint8_t left[SHA512_HASH_SIZE], const uint8_t right[SHA512_HASH_SIZE], uint8_t out[SHA512_HASH_SIZE])
+{
+    uint8_t msg[1 + 2 * SHA512_HASH_SIZE];
+    msg[0] = TREE_HASH_NODE_PREFIX;
+    memcpy(&msg[1], left, SHA512_HASH_SIZE);
+    memcpy(&msg[1 + SHA512_HASH_SIZE], right, SHA512_HASH_SIZE);
+    SHA512HashInto(msg, sizeof(msg), out);
+}
+
+const TreeHashFns treeHashSHA256Fns = { SHA256_HASH_SIZE, SHA256TreeLeaf, SHA256TreeNode };
+const TreeHashFns treeHashSHA512Fns = { SHA512_HASH_SIZE, SHA512TreeLeaf, SHA512TreeNode };
+
+static void leafTask(void *arg, size_t i)
+{
+    TreeLevel *level = (TreeLevel*)arg;
+    size_t offset = i * level->leafSize;
+    size_t len = level->len - offset;
+    if (len > level->leafSize)
+        len = level->leafSize;
+    level->fns->leaf(&level->data[offset], len, &level->out[i * level->fns->hashSize]);
+}
+
+static void nodeTask(void *arg, size_t i)
+{
+    TreeLevel *level = (TreeLevel*)arg;
+    size_t hashSize = level->fns->hashSize;
+    const uint8_t *left = &level->in[2 * i * hashSize];
+
+    if (2 * i + 1 < level->inCount)
+        level->fns->node(left, left + hashSize, &level->out[i * hashSize]);
+    else
+        memcpy(&level->out[i * hashSize], left, hashSize);
+}
+
+void treeHashLeaves(const TreeHashFns *fns, const uint8_t *data, size_t len, size_t leafSize, size_t numLeaves,
+                    ThreadPool *pool, uint8_t *out)
+{
+    TreeLevel level;
+    level.fns = fns;
+    level.data = data;
+    level.len = len;
+    level.leafSize = leafSize;
+    level.out = out;
+    ThreadPoolRun(pool, numLeaves, leafTask, &level);
+}
+
+void treeHashLevel(const TreeHashFns *fns, const uint8_t *in, size_t inCount, ThreadPool *pool, uint8_t *out)
+{
+    size_t parentCount = (inCount + 1) / 2;
+    TreeLevel level;
+    level.fns = fns;
+    level.in = in;
+    level.inCount = inCount;
+    level.out = out;
+    ThreadPoolRun(parentCount >= PARALLEL_LEVEL_MIN_NODES ? pool : NULL, parentCount, nodeTask, &level);
+}
+
+static int treeHash(const TreeHashFns *fns, const uint8_t *data, size_t len, size_t leafSize, ThreadPool *pool, uint8_t *out)
+{
+    if (leafSize == 0)
+        return 0;
+
+    size_t numLeaves = (len == 0) ? 1 : (len - 1) / leafSize + 1;
+    uint8_t *digests = (uint8_t*) malloc(numLeaves * fns->hashSize);
+    uint8_t *parents = (uint8_t*) malloc(((numLeaves + 1) / 2) * fns->hashSize);
+    if (digests == NULL || parents == NULL)
+    {
+        free(digests);
+        free(parents);
+        return 0;
+    }
+
+    treeHashLeaves(fns, data, len, leafSize, numLeaves, pool, digests);
+
+    // combine one level at a time, alternating between the two digest buffers
+    for (size_t count = numLeaves; count > 1; count = (count + 1) / 2)
+    {
+        treeHashLevel(fns, digests, count, pool, parents);
+        uint8_t *tmp = digests;
+        digests = parents;
+        parents = tmp;
+    }
+
+    memcpy(out, digests, fns->hashSize);
+    free(digests);
+    free(parents);
+    return 1;
+}
+
+int SHA256TreeHash(const uint8_t *data, size_t len, size_t leafSize, ThreadPool *pool, uint8_t out[SHA256_HASH_SIZE])
+{
+    return treeHash(&treeHashSHA256Fns, data, len, leafSize, pool, out);
+}
+
+int SHA512TreeHash(const uint8_t *data, size_t len, size_t leafSize, ThreadPool *pool, uint8_t out[SHA512_HASH_SIZE])
+{
+    return treeHash(&treeHashSHA512Fns, data, len, leafSize, pool, out);
+}
@@ -0,0 +1,42 @@
+// Parallel tree hashing: a Merkle tree over fixed-size leaves, built on the SHA-256 and SHA-512 compression functions
+//
+// The input is split into leaves of leafSize bytes (the last leaf may be shorter; an empty input is a
+// single empty leaf). Every leaf and interior node is hashed with a one byte domain separation prefix:
+//   leaf = H(0x00 || leaf bytes)
+//   node = H(0x01 || left child || right child)
+// Nodes are paired left to right one level at a time; an unpaired last node is carried up to the next
+// level unchanged. The digest of the single remaining node is the root. The root therefore depends only
+// on the input, the hash function and leafSize, never on the number of threads.
+
+#ifndef __TREE_HASH_H_
+#define __TREE_HASH_H_
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "SHA256.h"
+#include "SHA512.h"
+#include "ThreadPool.h"
+
+#define TREE_HASH_DEFAULT_LEAF_SIZE (1 << 20)
+
+#define TREE_HASH_LEAF_PREFIX 0x00
+#define TREE_HASH_NODE_PREFIX 0x01
+
+/// Writes the SHA-256 tree hash root of the len bytes at data into out. Leaves, and the nodes of wide
+/// levels, are hashed on the threads of pool; a NULL pool hashes everything on the calling thread.
+/// Returns 0 if leafSize is 0 or memory for the leaf digests cannot be allocated
+int SHA256TreeHash(const uint8_t *data, size_t len, size_t leafSize, ThreadPool *pool, uint8_t out[SHA256_HASH_SIZE]);
+
+/// SHA-512 version of SHA256TreeHash
+int SHA512TreeHash(const uint8_t *data, size_t len, size_t leafSize, ThreadPool *pool, uint8_t out[SHA512_HASH_SIZE]);
+
+/// Computes the digest of a single leaf, H(0x00 || leaf)
+void SHA256TreeLeaf(const uint8_t *leaf, size_t len, uint8_t out[SHA256_HASH_SIZE]);
+void SHA512TreeLeaf(const uint8_t *leaf, size_t len, uint8_t out[SHA512_HASH_SIZE]);
+
+/// Computes the digest of an interior node, H(0x01 || left || right)
+void SHA256TreeNode(const uint8_t left[SHA256_HASH_SIZE], const uint8_t right[SHA256_HASH_SIZE], uint8_t out[SHA256_HASH_SIZE]);
+void SHA512TreeNode(const uint8_t left[SHA512_HASH_SIZE], const uint8_t right[SHA512_HASH_SIZE], uint8_t out[SHA512_HASH_SIZE]);
+
+#endif //__TREE_HASH_H_
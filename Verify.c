@@ -0,0 +1,200 @@
+// Checksum verification for the sha executable: checks sha256sum/sha512sum style manifests
+
+#define _DEFAULT_SOURCE
+#include <errno.h>
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "FileHash.h"
+#include "Verify.h"
+
+typedef struct VerifyEntry {
+    char *path;
+    Mode mode;
+    uint8_t expected[SHA512_HASH_SIZE];
+} VerifyEntry;
+
+typedef struct Verification {
+    VerifyEntry *entries;
+    size_t count;
+
+    pthread_mutex_t lock;       // guards next, the counters and stdout
+    size_t next;
+    size_t mismatched;
+    size_t unreadable;
+} Verification;
+
+// Converts 2 * len hex digits to len bytes. Returns 0 if a character is not a hex digit
+static int parseHex(const char *hex, size_t len, uint8_t *out)
+{
+    for (size_t i = 0; i < 2 * len; ++i)
+    {
+        char c = hex[i];
+        int v;
+        if (c >= '0' && c <= '9')
+            v = c - '0';
+        else if (c >= 'a' && c <= 'f')
+            v = c - 'a' + 10;
+        else if (c >= 'A' && c <= 'F')
+            v = c - 'A' + 10;
+        else
+            return 0;
+        out[i / 2] = (i % 2) ? (uint8_t)(out[i / 2] | v) : (uint8_t)(v << 4);
+    }
+    return 1;
+}
+
+// Parses "<hex>  <path>" or "<hex> *<path>". Returns 0 if the line is not in that format, or -1 if the
+// path cannot be copied
+static int parseLine(char *line, VerifyEntry *entry)
+{
+    size_t hexLen = strspn(line, "0123456789abcdefABCDEF");
+    if (hexLen == 2 * SHA256_HASH_SIZE)
+        entry->mode = MODE_256;
+    else if (hexLen == 2 * SHA512_HASH_SIZE)
+        entry->mode = MODE_512;
+    else
+        return 0;
+
+    if (line[hexLen] != ' ' || (line[hexLen + 1] != ' ' && line[hexLen + 1] != '*') || line[hexLen + 2] == '\0')
+        return 0;
+    if (!parseHex(line, hexLen / 2, entry->expected))
+        return 0;
+    entry->path = strdup(&line[hexLen + 2]);
+    return (entry->path != NULL) ? 1 : -1;
+}
+
+static void *verifyMain(void *arg)
+{
+    Verification *v = (Verification*)arg;
+    for (;;)
+    {
+        pthread_mutex_lock(&v->lock);
+        size_t i = v->next;
+        if (i < v->count)
+            ++v->next;
+        pthread_mutex_unlock(&v->lock);
+        if (i >= v->count)
+            return NULL;
+
+        VerifyEntry *entry = &v->entries[i];
+        FileDigests digests;
+        int err = hashFile(entry->path, entry->mode, &digests);
+        int match = 0;
+        if (err == 0)
+        {
+            if (entry->mode == MODE_256)
+                match = SHADigestEqual(digests.sha256, entry->expected, SHA256_HASH_SIZE);
+            else
+                match = SHADigestEqual(digests.sha512, entry->expected, SHA512_HASH_SIZE);
+        }
+
+        // report each file as soon as it is checked, in completion order
+        pthread_mutex_lock(&v->lock);
+        if (err != 0)
+        {
+            fprintf(stderr, "sha: %s: %s\n", entry->path, strerror(err));
+            printf("%s: FAILED open or read\n", entry->path);
+            ++v->unreadable;
+        }
+        else if (match)
+            printf("%s: OK\n", entry->path);
+        else
+        {
+            printf("%s: FAILED\n", entry->path);
+            ++v->mismatched;
+        }
+        fflush(stdout);
+        pthread_mutex_unlock(&v->lock);
+    }
+}
+
+int verifyChecksums(const char *manifest, int numJobs)
+{
+    FILE *file = (strcmp(manifest, "-") == 0) ? stdin : fopen(manifest, "r");
+    if (file == NULL)
+    {
+        fprintf(stderr, "sha: %s: %s\n", manifest, strerror(errno));
+        return 1;
+    }
+
+    Verification v;
+    memset(&v, 0, sizeof(v));
+    size_t capacity = 0, malformed = 0;
+    char *line = NULL;
+    size_t lineCapacity = 0;
+    ssize_t len;
+    int parsed = 1;
+    while (parsed >= 0 && (len = getline(&line, &lineCapacity, file)) >= 0)
+    {
+        while (len > 0 && (line[len - 1] == '\n' || line[len - 1] == '\r'))
+            line[--len] = '\0';
+        if (len == 0)
+            continue;
+
+        if (v.count == capacity)
+        {
+            capacity = capacity ? capacity * 2 : 1024;
+            VerifyEntry *grown = (VerifyEntry*) realloc(v.entries, capacity * sizeof(VerifyEntry));
+            if (grown == NULL)
+            {
+                parsed = -1;
+                break;
+            }
+            v.entries = grown;
+        }
+        parsed = parseLine(line, &v.entries[v.count]);
+        if (parsed > 0)
+            ++v.count;
+        else if (parsed == 0)
+            ++malformed;
+    }
+    free(line);
+    if (file != stdin)
+        fclose(file);
+
+    // a partially read manifest must never pass
+    if (parsed < 0)
+    {
+        fprintf(stderr, "Error: Unable to allocate memory for %zu manifest entries.\n", v.count + 1);
+        for (size_t i = 0; i < v.count; ++i)
+            free(v.entries[i].path);
+        free(v.entries);
+        return 1;
+    }
+
+    if (numJobs <= 0)
+    {
+        long cpus = sysconf(_SC_NPROCESSORS_ONLN);
+        numJobs = (cpus > 0) ? (int)cpus : 1;
+    }
+    pthread_mutex_init(&v.lock, NULL);
+    // the calling thread is the last of the numJobs workers
+    pthread_t *workers = (numJobs > 1) ? (pthread_t*) malloc((numJobs - 1) * sizeof(pthread_t)) : NULL;
+    int numWorkers = 0;
+    while (workers != NULL && numWorkers < numJobs - 1 &&
+           pthread_create(&workers[numWorkers], NULL, verifyMain, &v) == 0)
+        ++numWorkers;
+    verifyMain(&v);
+    for (int i = 0; i < numWorkers; ++i)
+        pthread_join(workers[i], NULL);
+    free(workers);
+    pthread_mutex_destroy(&v.lock);
+
+    if (malformed > 0)
+        fprintf(stderr, "sha: WARNING: %zu line%s improperly formatted\n", malformed, malformed == 1 ? " is" : "s are");
+    if (v.unreadable > 0)
+        fprintf(stderr, "sha: WARNING: %zu listed file%s could not be read\n", v.unreadable, v.unreadable == 1 ? "" : "s");
+    if (v.mismatched > 0)
+        fprintf(stderr, "sha: WARNING: %zu computed checksum%s did NOT match\n", v.mismatched, v.mismatched == 1 ? "" : "s");
+
+    for (size_t i = 0; i < v.count; ++i)
+        free(v.entries[i].path);
+    free(v.entries);
+
+    // as in sha256sum -c, improperly formatted lines are only warned about
+    return (v.count == 0 || v.unreadable > 0 || v.mismatched > 0) ? 1 : 0;
+}
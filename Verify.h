@@ -0,0 +1,13 @@
+// Checksum verification for the sha executable: checks sha256sum/sha512sum style manifests
+
+#ifndef __VERIFY_H_
+#define __VERIFY_H_
+
+/// Checks every "<hex digest>  <path>" line of the manifest ("-" for stdin) on numJobs worker threads
+/// (one per CPU if numJobs <= 0). The algorithm of each line follows from its digest length, 64 hex digits
+/// for SHA-256 and 128 for SHA-512. "<path>: OK" or "<path>: FAILED" is printed as soon as each file is
+/// checked, followed by a summary of failures on stderr. Improperly formatted lines are skipped with a
+/// warning. Returns 0 if there was at least one well formed line and every listed file matched, otherwise 1
+int verifyChecksums(const char *manifest, int numJobs);
+
+#endif //__VERIFY_H_
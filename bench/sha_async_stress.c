@@ -0,0 +1,223 @@
+// Stress benchmark for the asynchronous hashing service
+//
+// Producer threads keep a fixed set of job slots in flight, mixing every algorithm and message sizes up to
+// --size. Even producers collect their jobs from the completion ring, through the main thread, odd ones
+// through callbacks. Every digest is compared with one computed up front, and submit to finish latency
+// is collected in a log2 histogram. Prints one JSON object with throughput, latency percentiles and the
+// number of wrong digests, and exits with 1 if there were any.
+//
+// Usage: sha_async_stress [--producers N] [--workers N] [--seconds S] [--size BYTES] [--queue N]
+//                         [--batch N] [--latency-us N]
+
+#define _DEFAULT_SOURCE
+#include <pthread.h>
+#include <sched.h>
+#include <stdatomic.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "SHAAsync.h"
+
+#define SLOTS_PER_PRODUCER 256
+#define LATENCY_BUCKETS 48
+
+typedef struct Slot {
+    atomic_int busy;
+    uint64_t submitted;
+    SHAAlgorithm algorithm;
+    size_t len;
+    uint8_t *msg;
+    uint8_t out[SHA512_HASH_SIZE];
+    uint8_t expected[SHA512_HASH_SIZE];
+} Slot;
+
+typedef struct Producer {
+    pthread_t thread;
+    Slot slots[SLOTS_PER_PRODUCER];
+    int useCallback;
+    unsigned long long jobs;
+    unsigned long long bytes;
+} Producer;
+
+static SHAAsync *engine;
+static atomic_int stop;
+static atomic_ullong mismatches;
+static atomic_ullong latency[LATENCY_BUCKETS];     // latency[i] counts jobs that took [2^i, 2^(i+1)) ns
+
+static uint64_t now(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ULL + (uint64_t)ts.tv_nsec;
+}
+
+// Records the job's latency and digest and frees its slot
+static void finish(Slot *slot)
+{
+    uint64_t elapsed = now() - slot->submitted;
+    int bucket = 0;
+    while (bucket + 1 < LATENCY_BUCKETS && (elapsed >> (bucket + 1)) != 0)
+        ++bucket;
+    atomic_fetch_add_explicit(&latency[bucket], 1, memory_order_relaxed);
+
+    if (memcmp(slot->out, slot->expected, SHAAlgorithmHashSize(slot->algorithm)) != 0)
+        atomic_fetch_add(&mismatches, 1);
+    atomic_store_explicit(&slot->busy, 0, memory_order_release);
+}
+
+static void onDone(void *tag, const uint8_t *digest)
+{
+    (void)digest;
+    finish((Slot*)tag);
+}
+
+static void *producerMain(void *arg)
+{
+    Producer *producer = (Producer*)arg;
+    while (!atomic_load_explicit(&stop, memory_order_relaxed))
+    {
+        for (int i = 0; i < SLOTS_PER_PRODUCER; ++i)
+        {
+            Slot *slot = &producer->slots[i];
+            if (atomic_load_explicit(&slot->busy, memory_order_acquire))
+                continue;
+
+            atomic_store_explicit(&slot->busy, 1, memory_order_relaxed);
+            slot->submitted = now();
+            if (!SHAAsyncSubmit(engine, slot->msg, slot->len, slot->algorithm, slot->out,
+                                producer->useCallback ? onDone : NULL, slot))
+            {
+                atomic_store_explicit(&slot->busy, 0, memory_order_relaxed);
+                sched_yield();
+                break;
+            }
+            ++producer->jobs;
+            producer->bytes += slot->len;
+        }
+    }
+    return NULL;
+}
+
+static size_t reap(int block)
+{
+    void *tags[256];
+    size_t n = SHAAsyncReap(engine, tags, 256, block);
+    for (size_t i = 0; i < n; ++i)
+        finish((Slot*)tags[i]);
+    return n;
+}
+
+// Upper bound of the bucket that holds the given fraction of all recorded latencies, in microseconds
+static double percentile(double fraction, unsigned long long total)
+{
+    unsigned long long seen = 0;
+    for (int i = 0; i < LATENCY_BUCKETS; ++i)
+    {
+        seen += atomic_load(&latency[i]);
+        if (seen >= fraction * total)
+            return (double)(2ULL << i) / 1000.0;
+    }
+    return 0.0;
+}
+
+int main(int argc, char **argv)
+{
+    int numProducers = 4, numWorkers = 0;
+    double seconds = 2.0;
+    size_t maxSize = 1024, queueSize = 0, maxBatch = 0;
+    unsigned latencyCap = SHA_ASYNC_DEFAULT_LATENCY_US;
+
+    for (int i = 1; i < argc; ++i)
+    {
+        const char *value = (i + 1 < argc) ? argv[i + 1] : NULL;
+        if (value == NULL)
+        {
+            fprintf(stderr, "usage: %s [--producers N] [--workers N] [--seconds S] [--size BYTES] [--queue N] "
+                            "[--batch N] [--latency-us N]\n", argv[0]);
+            return 2;
+        }
+        if (strcmp(argv[i], "--producers") == 0)
+            numProducers = atoi(value);
+        else if (strcmp(argv[i], "--workers") == 0)
+            numWorkers = atoi(value);
+        else if (strcmp(argv[i], "--seconds") == 0)
+            seconds = atof(value);
+        else if (strcmp(argv[i], "--size") == 0)
+            maxSize = strtoull(value, NULL, 0);
+        else if (strcmp(argv[i], "--queue") == 0)
+            queueSize = strtoull(value, NULL, 0);
+        else if (strcmp(argv[i], "--batch") == 0)
+            maxBatch = strtoull(value, NULL, 0);
+        else if (strcmp(argv[i], "--latency-us") == 0)
+            latencyCap = (unsigned)strtoul(value, NULL, 0);
+        else
+        {
+            fprintf(stderr, "unknown option %s\n", argv[i]);
+            return 2;
+        }
+        ++i;
+    }
+    if (numProducers < 1)
+        numProducers = 1;
+
+    engine = SHAAsyncCreate(numWorkers, queueSize, maxBatch, latencyCap);
+    Producer *producers = (Producer*) calloc(numProducers, sizeof(Producer));
+    if (engine == NULL || producers == NULL)
+    {
+        fprintf(stderr, "out of memory\n");
+        return 1;
+    }
+
+    srand(1);
+    for (int p = 0; p < numProducers; ++p)
+    {
+        producers[p].useCallback = p % 2;
+        for (int i = 0; i < SLOTS_PER_PRODUCER; ++i)
+        {
+            Slot *slot = &producers[p].slots[i];
+            slot->algorithm = (SHAAlgorithm)((p + i) % SHA_ALGORITHM_COUNT);
+            slot->len = (size_t)rand() % (maxSize + 1);
+            slot->msg = (uint8_t*) malloc(slot->len + 1);
+            for (size_t k = 0; k < slot->len; ++k)
+                slot->msg[k] = (uint8_t)rand();
+            SHAHashInto(slot->algorithm, slot->msg, slot->len, slot->expected);
+        }
+    }
+
+    uint64_t start = now();
+    for (int p = 0; p < numProducers; ++p)
+        pthread_create(&producers[p].thread, NULL, producerMain, &producers[p]);
+    while (now() - start < (uint64_t)(seconds * 1e9))
+    {
+        if (reap(1) == 0)
+            sched_yield();
+    }
+    atomic_store(&stop, 1);
+    for (int p = 0; p < numProducers; ++p)
+        pthread_join(producers[p].thread, NULL);
+
+    // jobs still in flight finish before the clock stops
+    while (reap(1) > 0)
+        ;
+    SHAAsyncDestroy(engine);
+    double elapsed = (double)(now() - start) / 1e9;
+
+    unsigned long long jobs = 0, bytes = 0;
+    for (int p = 0; p < numProducers; ++p)
+    {
+        jobs += producers[p].jobs;
+        bytes += producers[p].bytes;
+        for (int i = 0; i < SLOTS_PER_PRODUCER; ++i)
+            free(producers[p].slots[i].msg);
+    }
+    free(producers);
+
+    printf("{\"producers\": %d, \"workers\": %d, \"max_size\": %zu, \"latency_cap_us\": %u, \"seconds\": %.3f, "
+           "\"jobs\": %llu, \"jobs_per_sec\": %.1f, \"bytes_per_sec\": %.1f, \"latency_p50_us\": %.1f, "
+           "\"latency_p99_us\": %.1f, \"mismatches\": %llu}\n",
+           numProducers, numWorkers, maxSize, latencyCap, elapsed, jobs, jobs / elapsed, bytes / elapsed,
+           percentile(0.5, jobs), percentile(0.99, jobs), (unsigned long long)atomic_load(&mismatches));
+    return atomic_load(&mismatches) == 0 ? 0 : 1;
+}
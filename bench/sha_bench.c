@@ -0,0 +1,290 @@
+// Throughput benchmark for the SHA-512 and SHA-256 implementations
+//
+// Times each measured function over a sweep of message sizes and prints one JSON object per
+// (function, engine, size) with cycles/byte, hashes/sec and heap allocations per call, so runs of
+// different builds can be diffed. Progress goes to stderr, results to stdout.
+//
+// Usage: sha_bench [--max-size BYTES] [--min-time SECONDS] [--filter SUBSTRING]
+
+#define _DEFAULT_SOURCE
+#include <inttypes.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#define HAVE_RDTSC 1
+#endif
+
+#ifdef SHA_BENCH_OPENSSL
+#include <openssl/sha.h>
+#endif
+
+#include "SHA256.h"
+#include "SHA512.h"
+#include "SHAHasher.h"
+#include "SHAInternal.h"
+
+#define DEFAULT_MAX_SIZE (1ULL << 30)
+#define DEFAULT_MIN_TIME 0.25
+
+// Counts heap allocations made by the library; the linker routes malloc/calloc/realloc here (see CMakeLists.txt)
+static unsigned long long allocCount;
+
+#ifdef SHA_BENCH_COUNT_ALLOCS
+void *__real_malloc(size_t size);
+void *__real_calloc(size_t num, size_t size);
+void *__real_realloc(void *ptr, size_t size);
+
+void *__wrap_malloc(size_t size)
+{
+    __atomic_add_fetch(&allocCount, 1, __ATOMIC_RELAXED);
+    return __real_malloc(size);
+}
+
+void *__wrap_calloc(size_t num, size_t size)
+{
+    __atomic_add_fetch(&allocCount, 1, __ATOMIC_RELAXED);
+    return __real_calloc(num, size);
+}
+
+void *__wrap_realloc(void *ptr, size_t size)
+{
+    __atomic_add_fetch(&allocCount, 1, __ATOMIC_RELAXED);
+    return __real_realloc(ptr, size);
+}
+#endif
+
+// A measured function; returns the number of message bytes it processed
+typedef size_t (*BenchFn)(uint8_t *data, size_t len);
+
+typedef struct BenchCase {
+    const char *function;
+    BenchFn run;
+    int sha256Engines;  // run once per SHA-256 engine the CPU supports
+} BenchCase;
+
+static size_t benchSHA512Hash(uint8_t *data, size_t len)
+{
+    free(SHA512Hash(data, len));
+    return len;
+}
+
+static size_t benchSHA256Hash(uint8_t *data, size_t len)
+{
+    free(SHA256Hash(data, len));
+    return len;
+}
+
+static size_t benchSHA512HashInto(uint8_t *data, size_t len)
+{
+    uint8_t out[SHA512_HASH_SIZE];
+    SHA512HashInto(data, len, out);
+    return len;
+}
+
+static size_t benchSHA256HashInto(uint8_t *data, size_t len)
+{
+    uint8_t out[SHA256_HASH_SIZE];
+    SHA256HashInto(data, len, out);
+    return len;
+}
+
+// Pooled hasher as a server would use it per request; allocates nothing once the pool is warm
+static size_t benchSHAHasher(uint8_t *data, size_t len)
+{
+    SHAHasher *hasher = SHAHasherAcquire(SHA_ALGORITHM_SHA256);
+    SHAHasherUpdate(hasher, data, len);
+    SHAHasherFinal(hasher);
+    SHAHasherRelease(hasher);
+    return len;
+}
+
+// Compression function alone, over the whole blocks of the message
+static size_t benchSHA512Blocks(uint8_t *data, size_t len)
+{
+    uint64_t h[HASH_ARRAY_LEN];
+    memcpy(h, SHA512_H0, sizeof(h));
+    sha512Blocks(h, data, len / SHA512_MESSAGE_BLOCK_SIZE);
+    return len - len % SHA512_MESSAGE_BLOCK_SIZE;
+}
+
+static size_t benchSHA256Blocks(uint8_t *data, size_t len)
+{
+    uint32_t h[SHA256_ARRAY_LEN];
+    memcpy(h, SHA256_H0, sizeof(h));
+    sha256Blocks(h, data, len / SHA256_MESSAGE_BLOCK_SIZE);
+    return len - len % SHA256_MESSAGE_BLOCK_SIZE;
+}
+
+// Padding step alone
+static size_t benchPreprocess(uint8_t *data, size_t len)
+{
+    PaddedMsg padded = preprocess(data, len);
+    free(padded.msg);
+    return len;
+}
+
+static size_t benchPreprocess256(uint8_t *data, size_t len)
+{
+    PaddedMsg padded = preprocess256(data, len);
+    free(padded.msg);
+    return len;
+}
+
+#ifdef SHA_BENCH_OPENSSL
+static size_t benchOpenSSLSHA512(uint8_t *data, size_t len)
+{
+    uint8_t out[SHA512_DIGEST_LENGTH];
+    SHA512(data, len, out);
+    return len;
+}
+
+static size_t benchOpenSSLSHA256(uint8_t *data, size_t len)
+{
+    uint8_t out[SHA256_DIGEST_LENGTH];
+    SHA256(data, len, out);
+    return len;
+}
+#endif
+
+static const BenchCase cases[] =
+{
+    { "SHA512Hash", benchSHA512Hash, 0 },
+    { "SHA256Hash", benchSHA256Hash, 1 },
+    { "SHA512HashInto", benchSHA512HashInto, 0 },
+    { "SHA256HashInto", benchSHA256HashInto, 1 },
+    { "SHAHasher SHA256", benchSHAHasher, 0 },
+    { "sha512Blocks", benchSHA512Blocks, 0 },
+    { "sha256Blocks", benchSHA256Blocks, 1 },
+    { "preprocess", benchPreprocess, 0 },
+    { "preprocess256", benchPreprocess256, 0 },
+#ifdef SHA_BENCH_OPENSSL
+    { "OpenSSL SHA512", benchOpenSSLSHA512, 0 },
+    { "OpenSSL SHA256", benchOpenSSLSHA256, 0 },
+#endif
+};
+
+static const unsigned long long sizes[] =
+{
+    0, 1, 16, 64, 256, 1ULL << 10, 4ULL << 10, 16ULL << 10, 64ULL << 10, 256ULL << 10,
+    1ULL << 20, 4ULL << 20, 16ULL << 20, 64ULL << 20, 256ULL << 20, 1ULL << 30
+};
+
+static double now(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+static uint64_t cycles(void)
+{
+#ifdef HAVE_RDTSC
+    return __rdtsc();
+#else
+    return 0;
+#endif
+}
+
+// Times one case at one size and prints its JSON record
+static void measure(const BenchCase *c, const char *engine, uint8_t *data, size_t len, double minTime, int *first)
+{
+    // calibrate with a single call, then repeat for at least minTime seconds
+    double start = now();
+    c->run(data, len);
+    double single = now() - start;
+    unsigned long long iterations = (single > 0) ? (unsigned long long)(minTime / single) + 1 : 1000000;
+    if (iterations > 100000000ULL)
+        iterations = 100000000ULL;
+
+    size_t bytes = 0;
+    unsigned long long allocsBefore = allocCount;
+    uint64_t cyclesBefore = cycles();
+    start = now();
+    for (unsigned long long i = 0; i < iterations; ++i)
+        bytes = c->run(data, len);
+    double seconds = now() - start;
+    uint64_t elapsedCycles = cycles() - cyclesBefore;
+    unsigned long long allocs = allocCount - allocsBefore;
+
+    double totalBytes = (double)bytes * iterations;
+    printf("%s\n  {\"function\": \"%s\", \"engine\": \"%s\", \"size\": %zu, \"iterations\": %llu, \"seconds\": %.6f, ",
+           *first ? "" : ",", c->function, engine, len, iterations, seconds);
+    if (totalBytes > 0 && elapsedCycles > 0)
+        printf("\"cycles_per_byte\": %.3f, ", elapsedCycles / totalBytes);
+    else
+        printf("\"cycles_per_byte\": null, ");
+    printf("\"cycles_per_call\": %.1f, \"hashes_per_sec\": %.1f, \"bytes_per_sec\": %.1f, ",
+           (double)elapsedCycles / iterations, iterations / seconds, totalBytes / seconds);
+#ifdef SHA_BENCH_COUNT_ALLOCS
+    printf("\"allocs_per_hash\": %.3f}", (double)allocs / iterations);
+#else
+    (void)allocs;
+    printf("\"allocs_per_hash\": null}");
+#endif
+    fflush(stdout);
+    *first = 0;
+
+    fprintf(stderr, "%-16s %-8s %12zu B  %10.1f MB/s\n", c->function, engine, len, totalBytes / seconds / 1e6);
+}
+
+int main(int argc, char **argv)
+{
+    unsigned long long maxSize = DEFAULT_MAX_SIZE;
+    double minTime = DEFAULT_MIN_TIME;
+    const char *filter = NULL;
+
+    for (int i = 1; i + 1 < argc; i += 2)
+    {
+        if (strcmp(argv[i], "--max-size") == 0)
+            maxSize = strtoull(argv[i + 1], NULL, 10);
+        else if (strcmp(argv[i], "--min-time") == 0)
+            minTime = atof(argv[i + 1]);
+        else if (strcmp(argv[i], "--filter") == 0)
+            filter = argv[i + 1];
+    }
+
+    uint8_t *data = (uint8_t*) malloc(maxSize ? maxSize : 1);
+    if (data == NULL)
+    {
+        fprintf(stderr, "Error: Unable to allocate %llu bytes, try a smaller --max-size.\n", maxSize);
+        return 1;
+    }
+    for (unsigned long long i = 0; i < maxSize; ++i)
+        data[i] = (uint8_t)(i * 2654435761u >> 24);
+
+    SHA256Engine defaultEngine = SHA256GetEngine();
+    int first = 1;
+    printf("{\"max_size\": %llu, \"min_time\": %.3f, \"default_sha256_engine\": \"%s\", \"results\": [",
+           maxSize, minTime, SHA256EngineName(defaultEngine));
+
+    for (size_t c = 0; c < sizeof(cases) / sizeof(cases[0]); ++c)
+    {
+        if (filter != NULL && strstr(cases[c].function, filter) == NULL)
+            continue;
+
+        for (int e = 0; e < SHA256_ENGINE_COUNT; ++e)
+        {
+            const char *engine = "-";
+            if (cases[c].sha256Engines)
+            {
+                if (!SHA256SetEngine((SHA256Engine)e))
+                    continue;
+                engine = SHA256EngineName((SHA256Engine)e);
+            }
+            else if (e > 0)
+                break;
+
+            for (size_t s = 0; s < sizeof(sizes) / sizeof(sizes[0]) && sizes[s] <= maxSize; ++s)
+                measure(&cases[c], engine, data, (size_t)sizes[s], minTime, &first);
+        }
+        SHA256SetEngine(defaultEngine);
+    }
+
+    printf("\n]}\n");
+    free(data);
+    return 0;
+}
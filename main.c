@@ -6,74 +6,129 @@
 #include <stdlib.h>
 #include <string.h>
 
+#include "Batch.h"
+#include "CDC.h"
+#include "Dedup.h"
+#include "FileHash.h"
 #include "SHA512.h"
 #include "SHA256.h"
+#include "SHAStats.h"
+#include "TreeHash.h"
+#include "Verify.h"
 
-typedef enum Mode
+Mode progMode = MODE_BOTH;
+
+// Tree hashing options, see TreeHash.h
+int treeMode = 0;
+int numJobs = 0;
+size_t leafSize = TREE_HASH_DEFAULT_LEAF_SIZE;
+
+// Content-defined chunking options, see CDC.h
+size_t avgChunkSize = 0;
+
+// Print the hashing statistics of the run to stderr, see SHAStats.h
+int showStats = 0;
+
+/// Prints a digest as a lower case hex string followed by a newline
+void printDigest(const uint8_t *digest, size_t len)
 {
-    MODE_256 = 0x01,
-    MODE_512 = 0x02,
-    MODE_BOTH = (MODE_256 | MODE_512)
-} Mode;
+    for (size_t i = 0; i < len; ++i)
+        printf("%02x", digest[i]);
+    printf("\n");
+}
 
-Mode progMode = MODE_BOTH;
+/// Prints the tree hash roots of the given buffer
+void printTreeHash(const uint8_t *data, size_t len)
+{
+    ThreadPool *pool = ThreadPoolCreate(numJobs);
+    if (pool == NULL)
+    {
+        printf("Error: Unable to start worker threads.\n");
+        return;
+    }
+
+    if (progMode & MODE_512)
+    {
+        uint8_t root[SHA512_HASH_SIZE];
+        if (SHA512TreeHash(data, len, leafSize, pool, root))
+            printDigest(root, sizeof(root));
+        else
+            printf("Error: Unable to compute the SHA-512 tree hash.\n");
+    }
+
+    if (progMode & MODE_256)
+    {
+        uint8_t root[SHA256_HASH_SIZE];
+        if (SHA256TreeHash(data, len, leafSize, pool, root))
+            printDigest(root, sizeof(root));
+        else
+            printf("Error: Unable to compute the SHA-256 tree hash.\n");
+    }
+
+    ThreadPoolDestroy(pool);
+}
 
 /// Prints the checksum of the given file
 void getChecksum(char *filename)
 {
     if (filename == NULL)
         return;
-        
-    FILE *file = fopen(filename, "rb");
-    if (file == NULL)
-    {
-        printf("Error: Invalid file.\n");
-        return;
-    }
-    
-    long int fileSize = 0;
-    
-    fseek(file, 0, SEEK_END);
-    fileSize = ftell(file);
-    fseek(file, 0, SEEK_SET);
-    
-    char *fileContents = (char*) malloc(sizeof(char) * fileSize);
-    if (fileContents == NULL)
+
+    if (treeMode)
     {
-        printf("Error: Unable to allocate memory to read file contents.\n");
-        fclose(file);
+        FileContents contents;
+        int err = loadFile(filename, &contents);
+        if (err != 0)
+        {
+            printf("Error: Unable to read %s: %s\n", filename, strerror(err));
+            return;
+        }
+        printTreeHash(contents.data, contents.len);
+        unloadFile(&contents);
         return;
     }
-    
-    size_t amountRead = fread(fileContents, 1, fileSize, file);
-    if (amountRead != fileSize)
+
+    FileDigests digests;
+    int err = hashFile(filename, progMode, &digests);
+    if (err != 0)
     {
-        printf("Error: Unable to read entire file.\n");
-        free(fileContents);
-        fclose(file);
+        printf("Error: Unable to read %s: %s\n", filename, strerror(err));
         return;
     }
-    fclose(file);
-    
+
     if (progMode & MODE_512)
+        printDigest(digests.sha512, SHA512_HASH_SIZE);
+    if (progMode & MODE_256)
+        printDigest(digests.sha256, SHA256_HASH_SIZE);
+}
+
+/// Prints the hashing statistics of every path that was used
+void printStats(void)
+{
+    if (!SHAStatsEnabled())
     {
-        uint64_t *checksum = SHA512Hash((uint8_t*)fileContents, fileSize);
-        for (int i = 0; i < HASH_ARRAY_LEN; ++i)
-            printf("%016" PRIx64 , checksum[i]);
-        printf("\n");
-        free(checksum);
+        fprintf(stderr, "Statistics are not collected by this build; configure it with -DSHA_STATS=ON\n");
+        return;
     }
 
-    if (progMode & MODE_256)
+    SHAStatsSnapshot snapshot;
+    SHAStatsGetSnapshot(&snapshot);
+    fprintf(stderr, "%-14s %10s %14s %12s %12s %10s %10s\n", "path", "calls", "bytes", "blocks", "total ms", "p50 us", "p99 us");
+    for (int p = 0; p < SHA_STATS_PATH_COUNT; ++p)
     {
-        uint32_t *checksum2 = SHA256Hash((uint8_t*)fileContents, fileSize);
-        for (int i = 0; i < SHA256_ARRAY_LEN; ++i)
-            printf("%08" PRIx32 , checksum2[i]);
-        printf("\n");
-        free(checksum2);
+        const SHAStatsCounters *counters = &snapshot.paths[p];
+        if (counters->calls == 0)
+            continue;
+        fprintf(stderr, "%-14s %10llu %14llu %12llu", SHAStatsPathName((SHAStatsPath)p),
+                (unsigned long long)counters->calls, (unsigned long long)counters->bytes,
+                (unsigned long long)counters->blocks);
+        // paths only ever called from within others, like the engines, are counted but not timed
+        if (SHAStatsLatencyPercentile(counters, 1.0) == 0)
+            fprintf(stderr, " %12s %10s %10s\n", "-", "-", "-");
+        else
+            fprintf(stderr, " %12.3f %10.3f %10.3f\n", counters->nanos / 1e6,
+                    SHAStatsLatencyPercentile(counters, 0.5) / 1e3, SHAStatsLatencyPercentile(counters, 0.99) / 1e3);
     }
-    
-    free(fileContents);
 }
 
 /// Prints the program options
@@ -84,6 +139,16 @@ void printOptions(char *arg0)
     printf("Options:\n");
     printf("-f, --file [FILENAME] Calculate both the SHA-512 & SHA-256 checksums of the file.\n");
     printf("-m, --mode [MODE] Calculates only the SHA256 digest with mode = 256, or only the SHA512 digest with mode = 512\n");
+    printf("-b, --batch [FILE...] Print sha256sum/sha512sum style checksums of many files, hashed concurrently. Must be the\n");
+    printf("    last option; reads the list of files from stdin when no FILE or - is given. -j sets the number of workers\n");
+    printf("-c, --check [MANIFEST] Verify the files listed in a sha256sum/sha512sum style manifest (- for stdin), in parallel\n");
+    printf("-t, --tree Calculate parallel tree hashes of the file instead (see README for the tree format)\n");
+    printf("-j, --jobs [N] Number of threads used by --tree, defaults to one per CPU\n");
+    printf("-l, --leaf-size [BYTES] Leaf size used by --tree, defaults to %d\n", TREE_HASH_DEFAULT_LEAF_SIZE);
+    printf("-d, --dedup [FILENAME] Split the file into content-defined chunks and print the offset, length and SHA-256\n");
+    printf("    digest of each, marking repeated chunks\n");
+    printf("-a, --avg-chunk [BYTES] Average chunk size used by --dedup, a power of two, defaults to %d\n", CDC_DEFAULT_AVG_SIZE);
+    printf("-s, --stats Print how many calls, bytes and blocks each hashing path took, and how long, to stderr\n");
     printf("-h, --help Print command line options\n\n");   
 }
 
@@ -106,31 +171,49 @@ void hashInput(int argc, int inputPos, char **argv)
     argStr[inputLen - 1] = '\0';
     
     // Calculate a hash of argStr
+    uint8_t digest512[SHA512_HASH_SIZE];
+    uint8_t digest256[SHA256_HASH_SIZE];
+    size_t argLen = strlen(argStr);
+    if (progMode == MODE_BOTH)
+        SHADualHashInto((uint8_t*)argStr, argLen, digest512, digest256);
+    else if (progMode & MODE_512)
+        SHA512HashInto((uint8_t*)argStr, argLen, digest512);
+    else
+        SHA256HashInto((uint8_t*)argStr, argLen, digest256);
+
     if (progMode & MODE_512)
     {
-        uint64_t *argHash = SHA512Hash((uint8_t*)argStr, strlen(argStr));
         printf("SHA-512 hash of command line input: \n");
-        for (int i = 0; i < HASH_ARRAY_LEN; ++i)
-            printf("%016" PRIx64 , argHash[i]);
-        printf("\n");
-        free(argHash);
+        printDigest(digest512, SHA512_HASH_SIZE);
     }
     if (progMode & MODE_256)
     {
-        uint32_t *argHash2 = SHA256Hash((uint8_t*)&argStr[0], strlen(argStr));
         printf("SHA-256 hash of command line input: \n");
-        for (int i = 0; i < SHA256_ARRAY_LEN; ++i)
-            printf("%08" PRIx32 , argHash2[i]);
-        printf("\n");
-        free(argHash2);
+        printDigest(digest256, SHA256_HASH_SIZE);
     }
     
     free(argStr);
 }
 
+/// Checksums the files named by the arguments from batchPos on, or listed on stdin
+int runBatch(int argc, int batchPos, char **argv)
+{
+    if (batchPos < argc && strcmp(argv[batchPos], "-") != 0)
+        return batchChecksums(&argv[batchPos], argc - batchPos, progMode, numJobs);
+
+    char **paths;
+    size_t count;
+    int status = readPathList(&paths, &count) ? batchChecksums(paths, count, progMode, numJobs) : 1;
+    for (size_t i = 0; i < count; ++i)
+        free(paths[i]);
+    free(paths);
+    return status;
+}
+
 // Hashes the argument given, or if "-f" flag is used, hashes the contents of a given file
 int main(int argc, char **argv)
 {
+    int status = 0;
     if (argc > 1)
     {
         int inputPos = 1;
@@ -139,9 +222,15 @@ int main(int argc, char **argv)
         {
             int i;
             int argNumWithFile = -1;
-            for (i = 1; i < argc; ++i)
+            int batchPos = -1;
+            int argNumWithManifest = -1;
+            int argNumWithDedup = -1;
+            for (i = 1; i < argc && batchPos < 0; ++i)
             {
                 flag = argv[i];
+                // option values such as file names are not flags themselves
+                if (flag[0] != '-')
+                    continue;
                 char c = (flag[1] == '-') ? flag[2] : flag[1];
                 switch (c)
                 {
@@ -165,6 +254,41 @@ int main(int argc, char **argv)
                                 inputPos = i + 2;
                         }
                         break;
+                    // hash files as a Merkle tree of leaves, in parallel
+                    case 't':
+                        treeMode = 1;
+                        break;
+                    case 'j':
+                        if (argc > i + 1)
+                            numJobs = atoi(argv[i + 1]);
+                        break;
+                    case 'l':
+                        if (argc > i + 1)
+                            leafSize = strtoull(argv[i + 1], NULL, 10);
+                        break;
+                    // list the content-defined chunks of argv[i + 1]
+                    case 'd':
+                        if (argc > i + 1)
+                            argNumWithDedup = i + 1;
+                        break;
+                    case 'a':
+                        if (argc > i + 1)
+                            avgChunkSize = strtoull(argv[i + 1], NULL, 10);
+                        break;
+                    // verify the checksums listed in argv[i + 1]
+                    case 'c':
+                        if (argc > i + 1)
+                            argNumWithManifest = i + 1;
+                        break;
+                    // every remaining argument is a file to checksum
+                    case 'b':
+                        batchPos = i + 1;
+                        break;
+                    case 's':
+                        showStats = 1;
+                        if (inputPos == i)
+                            inputPos = i + 1;
+                        break;
                     // print options
                     case 'h':
                         printOptions(argv[0]);
@@ -173,7 +297,22 @@ int main(int argc, char **argv)
                         break;
                 }
             }
-            if (argNumWithFile > -1)
+            if (argNumWithDedup > -1)
+            {
+                status = printChunks(argv[argNumWithDedup], avgChunkSize);
+                inputPos = argc + 1;
+            }
+            else if (argNumWithManifest > -1)
+            {
+                status = verifyChecksums(argv[argNumWithManifest], numJobs);
+                inputPos = argc + 1;
+            }
+            else if (batchPos > -1)
+            {
+                status = runBatch(argc, batchPos, argv);
+                inputPos = argc + 1;
+            }
+            else if (argNumWithFile > -1)
             {
                 getChecksum(argv[argNumWithFile]);
                 inputPos = argc + 1;
@@ -186,5 +325,7 @@ int main(int argc, char **argv)
     else
         printOptions(argv[0]);
 
-    return 0;
+    if (showStats)
+        printStats();
+    return status;
 }
@@ -0,0 +1,120 @@
+// Tests of the constexpr C++ SHA-2 in SHA2.hpp: known answers checked by the compiler, then a comparison
+// of the runtime path against the C library at random lengths covering every padding case
+//
+// Usage: sha2_test [seed]
+
+#include <array>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+
+#include "SHA2.hpp"
+
+extern "C" {
+#include "SHA256.h"
+#include "SHA512.h"
+}
+
+#define RANDOM_ITERATIONS 2000
+#define RANDOM_MAX_LEN 1100
+
+static int numChecks;
+static int numFailures;
+
+static uint64_t rngState = 0x9E3779B97F4A7C15ULL;
+
+// xorshift64*, enough to spread lengths and contents
+static uint64_t rng(void)
+{
+    rngState ^= rngState >> 12;
+    rngState ^= rngState << 25;
+    rngState ^= rngState >> 27;
+    return rngState * 0x2545F4914F6CDD1DULL;
+}
+
+static constexpr int hexValue(char c)
+{
+    return (c >= 'a') ? c - 'a' + 10 : c - '0';
+}
+
+template <std::size_t N>
+static constexpr bool equalsHex(const std::array<uint8_t, N> &digest, std::string_view hex)
+{
+    if (hex.size() != 2 * N)
+        return false;
+    for (std::size_t i = 0; i < N; ++i)
+    {
+        if (digest[i] != hexValue(hex[2 * i]) * 16 + hexValue(hex[2 * i + 1]))
+            return false;
+    }
+    return true;
+}
+
+// FIPS 180-4 / NIST CSRC example values, computed entirely at compile time
+static_assert(equalsHex(sha2::sha256("abc"), "ba7816bf8f01cfea414140de5dae2223b00361a396177a9cb410ff61f20015ad"));
+static_assert(equalsHex(sha2::sha256(""), "e3b0c44298fc1c149afbf4c8996fb92427ae41e4649b934ca495991b7852b855"));
+static_assert(equalsHex(sha2::sha256("abcdbcdecdefdefgefghfghighijhijkijkljklmklmnlmnomnopnopq"),
+                        "248d6a61d20638b8e5c026930c3e6039a33ce45964ff2167f6ecedd419db06c1"));
+static_assert(equalsHex(sha2::sha512("abc"),
+                        "ddaf35a193617abacc417349ae20413112e6fa4e89a97ea20a9eeee64b55d39a"
+                        "2192992a274fc1a836ba3c23a3feebbd454d4423643ce80e2a9ac94fa54ca49f"));
+static_assert(equalsHex(sha2::sha512(""),
+                        "cf83e1357eefb8bdf1542850d66d8007d620e4050b5715dc83f4a921d36ce9ce"
+                        "47d0d13c5d85f2b0ff8318d2877eec2f63b931bd47417a81a538327af927da3e"));
+static_assert(equalsHex(sha2::sha512("abcdefghbcdefghicdefghijdefghijkefghijklfghijklmghijklmnhijklmno"
+                                     "ijklmnopjklmnopqklmnopqrlmnopqrsmnopqrstnopqrstu"),
+                        "8e959b75dae313da8cf4f72814fc143f8f7779c6eb9f7fa17299aeadb6889018"
+                        "501d289e4900f7e4331b99dec4b5433ac7d329eeb6dd26545e96e55b874be909"));
+static_assert(equalsHex(sha2::sha384("abc"),
+                        "cb00753f45a35e8bb5a03d699ac65007272c32ab0eded1631a8b605a43ff5bed"
+                        "8086072ba1e7cc2358baeca134c825a7"));
+static_assert(equalsHex(sha2::sha512_224("abc"), "4634270f707b6a54daae7530460842e20e37ed265ceee9a43e8924aa"));
+static_assert(equalsHex(sha2::sha512_256("abc"), "53048e2681941ef99b2e29b76b4c7dabe4c2d0c634fc6d46e0e2f13107e7af23"));
+
+// a digest stored by the compiler, as embedded fingerprints would be
+static constexpr std::array<uint8_t, 32> abcDigest = sha2::sha256("abc");
+
+template <std::size_t N>
+static void check(const char *what, std::size_t len, const std::array<uint8_t, N> &got, const uint8_t *expected)
+{
+    ++numChecks;
+    if (memcmp(got.data(), expected, N) != 0)
+    {
+        ++numFailures;
+        printf("FAIL %s len %zu\n", what, len);
+    }
+}
+
+int main(int argc, char **argv)
+{
+    if (argc > 1)
+        rngState = strtoull(argv[1], NULL, 0) | 1;
+    printf("seed 0x%llx\n", (unsigned long long)rngState);
+
+    uint8_t expected[SHA512_HASH_SIZE];
+    SHA256HashInto((const uint8_t*)"abc", 3, expected);
+    check("constexpr sha256", 3, abcDigest, expected);
+
+    static uint8_t msg[RANDOM_MAX_LEN];
+    for (int i = 0; i < RANDOM_ITERATIONS; ++i)
+    {
+        std::size_t len = (i < 300) ? (std::size_t)i : (std::size_t)(rng() % RANDOM_MAX_LEN);
+        for (std::size_t j = 0; j < len; ++j)
+            msg[j] = (uint8_t)rng();
+
+        SHA256HashInto(msg, len, expected);
+        check("sha256", len, sha2::sha256(msg, len), expected);
+        SHA512HashInto(msg, len, expected);
+        check("sha512", len, sha2::sha512(msg, len), expected);
+        SHA384HashInto(msg, len, expected);
+        check("sha384", len, sha2::sha384(msg, len), expected);
+        SHA512_224HashInto(msg, len, expected);
+        check("sha512_224", len, sha2::sha512_224(msg, len), expected);
+        SHA512_256HashInto(msg, len, expected);
+        check("sha512_256", len, sha2::sha512_256(msg, len), expected);
+    }
+
+    printf("%d checks, %d failed\n", numChecks, numFailures);
+    return numFailures == 0 ? 0 : 1;
+}
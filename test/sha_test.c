@@ -0,0 +1,1389 @@
+// Known-answer and differential tests for the SHA-512 and SHA-256 implementations
+//
+// 1. FIPS 180-4 example vectors (short, multi-block and the one million 'a' long message) for SHA-256,
+//    SHA-512, SHA-384, SHA-512/224 and SHA-512/256, the RFC 4231 HMAC vectors, and PBKDF2 vectors
+// 2. The SHAVS Monte Carlo chain, 100 checkpoints of 1000 chained hashes each
+// 3. Every accelerated, streaming, midstate or HMAC entry point, compared against the reference path
+//    (preprocess + getHash with the scalar engine) at random lengths and split points
+//
+// Usage: sha_test [SEED]     prints one line per failure and returns non zero if any check failed
+
+#include <stdatomic.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "CDC.h"
+#include "HMAC.h"
+#include "MerkleTree.h"
+#include "PBKDF2.h"
+#include "SHA256.h"
+#include "SHA512.h"
+#include "SHAAsync.h"
+#include "SHADual.h"
+#include "SHAHasher.h"
+#include "SHAInternal.h"
+#include "SHAStats.h"
+#include "ThreadPool.h"
+#include "TreeHash.h"
+
+#define FUZZ_ITERATIONS 2000
+#define FUZZ_MAX_LEN 4096
+#define FUZZ_MAX_BATCH 40
+#define MONTE_CARLO_CHECKPOINTS 100
+#define MONTE_CARLO_ITERATIONS 1000
+#define PBKDF2_MAX_OUT 200
+#define HASHER_TASKS 256
+#define ASYNC_JOBS 3000
+#define STATS_TASKS 64
+
+static int numChecks;
+static int numFailures;
+
+static uint64_t rngState = 0x9E3779B97F4A7C15ULL;
+
+// xorshift64*, so a failing seed can be replayed
+static uint64_t rng(void)
+{
+    rngState ^= rngState >> 12;
+    rngState ^= rngState << 25;
+    rngState ^= rngState >> 27;
+    return rngState * 0x2545F4914F6CDD1DULL;
+}
+
+static size_t rngBelow(size_t bound)
+{
+    return (bound == 0) ? 0 : (size_t)(rng() % bound);
+}
+
+static void toHex(const uint8_t *digest, size_t len, char *hex)
+{
+    for (size_t i = 0; i < len; ++i)
+        sprintf(&hex[i * 2], "%02x", digest[i]);
+}
+
+static void check(const char *what, size_t len, const uint8_t *got, const uint8_t *expected, size_t hashSize)
+{
+    ++numChecks;
+    if (memcmp(got, expected, hashSize) == 0)
+        return;
+
+    char gotHex[2 * SHA512_HASH_SIZE + 1], expectedHex[2 * SHA512_HASH_SIZE + 1];
+    toHex(got, hashSize, gotHex);
+    toHex(expected, hashSize, expectedHex);
+    printf("FAILED %s (len %zu)\n  got      %s\n  expected %s\n", what, len, gotHex, expectedHex);
+    ++numFailures;
+}
+
+static void checkHex(const char *what, size_t len, const uint8_t *got, const char *expectedHex, size_t hashSize)
+{
+    uint8_t expected[SHA512_HASH_SIZE];
+    for (size_t i = 0; i < hashSize; ++i)
+        sscanf(&expectedHex[i * 2], "%2hhx", &expected[i]);
+    check(what, len, got, expected, hashSize);
+}
+
+// Reference digests: the original padding and compression path, on the scalar engine
+static void referenceSHA512(const uint8_t *msg, size_t len, uint8_t out[SHA512_HASH_SIZE])
+{
+    PaddedMsg padded = preprocess((uint8_t*)msg, len);
+    uint64_t *h = getHash(&padded);
+    for (int i = 0; i < HASH_ARRAY_LEN; ++i)
+        storeBigEndian64(&out[i * 8], h[i]);
+    free(h);
+}
+
+static void referenceSHA256(const uint8_t *msg, size_t len, uint8_t out[SHA256_HASH_SIZE])
+{
+    SHA256Engine engine = SHA256GetEngine();
+    SHA256SetEngine(SHA256_ENGINE_SCALAR);
+    PaddedMsg padded = preprocess256((uint8_t*)msg, len);
+    uint32_t *h = get256Hash(&padded);
+    SHA256SetEngine(engine);
+    for (int i = 0; i < SHA256_ARRAY_LEN; ++i)
+        storeBigEndian32(&out[i * 4], h[i]);
+    free(h);
+}
+
+typedef struct KnownAnswer {
+    const char *msg;
+    const char *sha256;
+    const char *sha512;
+} KnownAnswer;
+
+// FIPS 180-4 / NIST CSRC example values
+static const KnownAnswer knownAnswers[] =
+{
+    { "abc",
+      "ba7816bf8f01cfea414140de5dae2223b00361a396177a9cb410ff61f20015ad",
+      "ddaf35a193617abacc417349ae20413112e6fa4e89a97ea20a9eeee64b55d39a2192992a274fc1a836ba3c23a3feebbd454d4423643ce80e2a9ac94fa54ca49f" },
+    { "",
+      "e3b0c44298fc1c149afbf4c8996fb92427ae41e4649b934ca495991b7852b855",
+      "cf83e1357eefb8bdf1542850d66d8007d620e4050b5715dc83f4a921d36ce9ce47d0d13c5d85f2b0ff8318d2877eec2f63b931bd47417a81a538327af927da3e" },
+    { "abcdbcdecdefdefgefghfghighijhijkijkljklmklmnlmnomnopnopq",
+      "248d6a61d20638b8e5c026930c3e6039a33ce45964ff2167f6ecedd419db06c1",
+      "204a8fc6dda82f0a0ced7beb8e08a41657c16ef468b228a8279be331a703c33596fd15c13b1b07f9aa1d3bea57789ca031ad85c7a71dd70354ec631238ca3445" },
+    { "abcdefghbcdefghicdefghijdefghijkefghijklfghijklmghijklmnhijklmnoijklmnopjklmnopqklmnopqrlmnopqrsmnopqrstnopqrstu",
+      "cf5b16a778af8380036ce59e7b0492370b249b11e8f07a51afac45037afee9d1",
+      "8e959b75dae313da8cf4f72814fc143f8f7779c6eb9f7fa17299aeadb6889018501d289e4900f7e4331b99dec4b5433ac7d329eeb6dd26545e96e55b874be909" },
+};
+
+static const char *millionA256 = "cdc76e5c9914fb9281a1c7e284d73e67f1809a48a497200e046d39ccc7112cd0";
+static const char *millionA512 =
+    "e718483d0ce769644e2e42c7bc15b4638e1f98b13b2044285632a803afa973ebde0ff244877ea60a4cb0432ce577c31beb009c5c2c49aa2e4eadb217ad8cc09b";
+
+// Runs every known answer through the reference path and every SHA-256 engine
+static void testKnownAnswers(void)
+{
+    uint8_t digest[SHA512_HASH_SIZE];
+    for (size_t i = 0; i < sizeof(knownAnswers) / sizeof(knownAnswers[0]); ++i)
+    {
+        const uint8_t *msg = (const uint8_t*)knownAnswers[i].msg;
+        size_t len = strlen(knownAnswers[i].msg);
+
+        referenceSHA512(msg, len, digest);
+        checkHex("known answer getHash", len, digest, knownAnswers[i].sha512, SHA512_HASH_SIZE);
+        SHA512HashInto(msg, len, digest);
+        checkHex("known answer SHA512HashInto", len, digest, knownAnswers[i].sha512, SHA512_HASH_SIZE);
+
+        referenceSHA256(msg, len, digest);
+        checkHex("known answer get256Hash", len, digest, knownAnswers[i].sha256, SHA256_HASH_SIZE);
+        for (int e = 0; e < SHA256_ENGINE_COUNT; ++e)
+        {
+            SHA256Engine engine = SHA256GetEngine();
+            if (!SHA256SetEngine((SHA256Engine)e))
+                continue;
+            SHA256HashInto(msg, len, digest);
+            SHA256SetEngine(engine);
+            checkHex(SHA256EngineName((SHA256Engine)e), len, digest, knownAnswers[i].sha256, SHA256_HASH_SIZE);
+        }
+    }
+
+    // the long message: one million repetitions of 'a', fed in uneven pieces
+    size_t len = 1000000;
+    uint8_t *a = (uint8_t*) malloc(len);
+    memset(a, 'a', len);
+
+    SHA512Context ctx512;
+    SHA512Init(&ctx512);
+    for (size_t offset = 0, step = 1; offset < len; offset += step, step = step * 3 + 1)
+        SHA512Update(&ctx512, &a[offset], (step < len - offset) ? step : len - offset);
+    SHA512Final(&ctx512, digest);
+    checkHex("million a SHA512Update", len, digest, millionA512, SHA512_HASH_SIZE);
+    referenceSHA512(a, len, digest);
+    checkHex("million a getHash", len, digest, millionA512, SHA512_HASH_SIZE);
+
+    SHA256Context ctx256;
+    SHA256Init(&ctx256);
+    for (size_t offset = 0, step = 1; offset < len; offset += step, step = step * 3 + 1)
+        SHA256Update(&ctx256, &a[offset], (step < len - offset) ? step : len - offset);
+    SHA256Final(&ctx256, digest);
+    checkHex("million a SHA256Update", len, digest, millionA256, SHA256_HASH_SIZE);
+    referenceSHA256(a, len, digest);
+    checkHex("million a get256Hash", len, digest, millionA256, SHA256_HASH_SIZE);
+
+    // SHA256d of "hello", as used for Bitcoin style identifiers
+    SHA256dHashInto((const uint8_t*)"hello", 5, digest);
+    checkHex("known answer SHA256dHashInto", 5, digest,
+             "9595c9df90075148eb06860365df33584b75bff782a510c6cd4883a419833d50", SHA256_HASH_SIZE);
+
+    free(a);
+}
+
+typedef struct VariantKnownAnswer {
+    const char *msg;
+    const char *sha384;
+    const char *sha512_224;
+    const char *sha512_256;
+} VariantKnownAnswer;
+
+// FIPS 180-4 / NIST CSRC example values for the truncated SHA-512 variants; msg NULL is one million 'a'
+static const VariantKnownAnswer variantKnownAnswers[] =
+{
+    { "abc",
+      "cb00753f45a35e8bb5a03d699ac65007272c32ab0eded1631a8b605a43ff5bed8086072ba1e7cc2358baeca134c825a7",
+      "4634270f707b6a54daae7530460842e20e37ed265ceee9a43e8924aa",
+      "53048e2681941ef99b2e29b76b4c7dabe4c2d0c634fc6d46e0e2f13107e7af23" },
+    { "",
+      "38b060a751ac96384cd9327eb1b1e36a21fdb71114be07434c0cc7bf63f6e1da274edebfe76f65fbd51ad2f14898b95b",
+      "6ed0dd02806fa89e25de060c19d3ac86cabb87d6a0ddd05c333b84f4",
+      "c672b8d1ef56ed28ab87c3622c5114069bdd3ad7b8f9737498d0c01ecef0967a" },
+    { "abcdefghbcdefghicdefghijdefghijkefghijklfghijklmghijklmnhijklmnoijklmnopjklmnopqklmnopqrlmnopqrsmnopqrstnopqrstu",
+      "09330c33f71147e83d192fc782cd1b4753111b173b3b05d22fa08086e3b0f712fcc7c71a557e2db966c3e9fa91746039",
+      "23fec5bb94d60b23308192640b0c453335d664734fe40e7268674af9",
+      "3928e184fb8690f840da3988121d31be65cb9d3ef83ee6146feac861e19b563a" },
+    { NULL,
+      "9d0e1809716474cb086e834e310a4a1ced149e9c00f248527972cec5704c2a5b07b8b3dc38ecc4ebae97ddd87f3d8985",
+      "37ab331d76f0d36de422bd0edeb22a28accd487b7a8453ae965dd287",
+      "9a59a052930187a97038cae692f30708aa6491923ef5194394dc68d56c74fb21" },
+};
+
+// Derives the SHA-512/t initial hash value with the IV generation function of FIPS 180-4 section 5.3.6:
+// SHA-512 of the string "SHA-512/t", started from the SHA-512 initial hash value XORed with a5a5...a5
+static void checkVariantIV(const char *name, const uint64_t iv[HASH_ARRAY_LEN])
+{
+    SHA512Midstate generator;
+    uint8_t digest[SHA512_HASH_SIZE], expected[SHA512_HASH_SIZE];
+    for (int i = 0; i < HASH_ARRAY_LEN; ++i)
+    {
+        generator.h[i] = SHA512_H0[i] ^ 0xA5A5A5A5A5A5A5A5ULL;
+        storeBigEndian64(&expected[i * 8], iv[i]);
+    }
+    generator.prefixLen = 0;
+    generator.hashSize = SHA512_HASH_SIZE;
+    SHA512MidstateHashInto(&generator, (const uint8_t*)name, strlen(name), digest);
+    check(name, strlen(name), digest, expected, SHA512_HASH_SIZE);
+}
+
+static void testVariants(void)
+{
+    uint8_t digest[SHA384_HASH_SIZE];
+    uint8_t *a = (uint8_t*) malloc(1000000);
+    memset(a, 'a', 1000000);
+
+    for (size_t i = 0; i < sizeof(variantKnownAnswers) / sizeof(variantKnownAnswers[0]); ++i)
+    {
+        const VariantKnownAnswer *t = &variantKnownAnswers[i];
+        const uint8_t *msg = t->msg ? (const uint8_t*)t->msg : a;
+        size_t len = t->msg ? strlen(t->msg) : 1000000;
+        size_t split = len / 3;
+        SHA512Context ctx;
+
+        SHA384HashInto(msg, len, digest);
+        checkHex("SHA384HashInto", len, digest, t->sha384, SHA384_HASH_SIZE);
+        SHA384Init(&ctx);
+        SHA384Update(&ctx, msg, split);
+        SHA384Update(&ctx, &msg[split], len - split);
+        SHA384Final(&ctx, digest);
+        checkHex("SHA384Update", len, digest, t->sha384, SHA384_HASH_SIZE);
+
+        // a SHA-384 midstate resumes as SHA-384, writing 48 bytes rather than a whole SHA-512 digest
+        SHA512Midstate mid;
+        uint8_t resumed[SHA512_HASH_SIZE] = {0}, zeros[SHA512_HASH_SIZE - SHA384_HASH_SIZE] = {0};
+        size_t aligned = split - split % SHA512_MESSAGE_BLOCK_SIZE;
+        SHA384Init(&ctx);
+        SHA384Update(&ctx, msg, aligned);
+        SHA512GetMidstate(&ctx, &mid);
+        SHA512InitFromMidstate(&ctx, &mid);
+        SHA384Update(&ctx, &msg[aligned], len - aligned);
+        SHA384Final(&ctx, resumed);
+        checkHex("SHA384 midstate", len, resumed, t->sha384, SHA384_HASH_SIZE);
+        check("SHA384 midstate length", len, &resumed[SHA384_HASH_SIZE], zeros, sizeof(zeros));
+
+        SHA512_224HashInto(msg, len, digest);
+        checkHex("SHA512_224HashInto", len, digest, t->sha512_224, SHA512_224_HASH_SIZE);
+        SHA512_224Init(&ctx);
+        SHA512_224Update(&ctx, msg, split);
+        SHA512_224Update(&ctx, &msg[split], len - split);
+        SHA512_224Final(&ctx, digest);
+        checkHex("SHA512_224Update", len, digest, t->sha512_224, SHA512_224_HASH_SIZE);
+
+        SHA512_256HashInto(msg, len, digest);
+        checkHex("SHA512_256HashInto", len, digest, t->sha512_256, SHA512_256_HASH_SIZE);
+        SHA512_256Init(&ctx);
+        SHA512_256Update(&ctx, msg, split);
+        SHA512_256Update(&ctx, &msg[split], len - split);
+        SHA512_256Final(&ctx, digest);
+        checkHex("SHA512_256Update", len, digest, t->sha512_256, SHA512_256_HASH_SIZE);
+    }
+
+    checkVariantIV("SHA-512/224", SHA512_224_H0);
+    checkVariantIV("SHA-512/256", SHA512_256_H0);
+    free(a);
+}
+
+typedef struct MonteCarlo {
+    const char *name;
+    size_t hashSize;
+    void (*hash)(const uint8_t *input, size_t len, uint8_t *out);
+    const char *seed;
+    const char *checkpoints[3];     // after checkpoint 0, 49 and 99
+} MonteCarlo;
+
+// The SHAVS Monte Carlo procedure: MD[i] = H(MD[i-3] || MD[i-2] || MD[i-1]), restarted from the last digest
+// of every checkpoint. The expected values were computed from these seeds with an independent implementation
+// (Python's hashlib), since the NIST response files are not shipped with the repository
+static const MonteCarlo monteCarlo[] =
+{
+    { "SHA-256 Monte Carlo", SHA256_HASH_SIZE, SHA256HashInto,
+      "889fbf66923e4e467c46ae46b1a26479894f7d4cbdcd240b734512e2d21b2952",
+      { "996c90e5a747f3db17338724ad1ab1a6e6e501e135b2193e76123814977397a5",
+        "c58f70ff8c0d3d7c036006f3a4d4f2ae67c440583cbdc2005d6c56a3387823be",
+        "01fedcb6bb621543007b83fde8dcbc0e5b60fb9d2fc6d48fd7969d2b8c06624e" } },
+    { "SHA-512 Monte Carlo", SHA512_HASH_SIZE, SHA512HashInto,
+      "a6f38f383a2621eb072c45c2c4677c89ed81d7e003ad316cb3651d8548b0b48986161a185465ca77212b23ecef8a465c31d8c3f5b8adf0cef0873cab180d15a4",
+      { "24021691ae7846f5e7a4c6996a195a41d6356018360e13a9ed2924ce8e462955ffed98dc557f662d10bc8c6525897293803ca012879459d8512f69799b7a608e",
+        "f32b40277db53c943b4ed07043b5ab0451c7cb346a616b6a4a1cbb5e1101187d3272d99efc759d05bf90aea9c80fb25cd7f90923dc8c6a16f68756ce96fa6d4a",
+        "8d61f5218feb318920d5d4f1461348b804efce2591d96bf67b3d5c021cefd874ce71447d2352080f6745ff35e9808fffeb1e55354300a6920715f5094809c495" } },
+};
+
+static void testMonteCarlo(void)
+{
+    for (size_t t = 0; t < sizeof(monteCarlo) / sizeof(monteCarlo[0]); ++t)
+    {
+        const MonteCarlo *mc = &monteCarlo[t];
+        size_t hashSize = mc->hashSize;
+        uint8_t seed[SHA512_HASH_SIZE];
+        uint8_t msg[3 * SHA512_HASH_SIZE];
+        for (size_t i = 0; i < hashSize; ++i)
+            sscanf(&mc->seed[i * 2], "%2hhx", &seed[i]);
+
+        for (int j = 0; j < MONTE_CARLO_CHECKPOINTS; ++j)
+        {
+            // msg holds the last three digests
+            for (int k = 0; k < 3; ++k)
+                memcpy(&msg[k * hashSize], seed, hashSize);
+            for (int i = 0; i < MONTE_CARLO_ITERATIONS; ++i)
+            {
+                uint8_t next[SHA512_HASH_SIZE];
+                mc->hash(msg, 3 * hashSize, next);
+                memmove(msg, &msg[hashSize], 2 * hashSize);
+                memcpy(&msg[2 * hashSize], next, hashSize);
+            }
+            memcpy(seed, &msg[2 * hashSize], hashSize);
+
+            int checkpoint = (j == 0) ? 0 : (j == 49) ? 1 : (j == 99) ? 2 : -1;
+            if (checkpoint >= 0)
+            {
+                char what[64];
+                snprintf(what, sizeof(what), "%s checkpoint %d", mc->name, j);
+                checkHex(what, 3 * hashSize, seed, mc->checkpoints[checkpoint], hashSize);
+            }
+        }
+    }
+}
+
+typedef struct HMACKnownAnswer {
+    const char *key;
+    size_t keyLen;
+    const char *msg;
+    size_t msgLen;
+    const char *sha256;
+    const char *sha512;
+} HMACKnownAnswer;
+
+// RFC 4231 test cases 1-4, 6 and 7 (case 5 tests truncated output)
+static const HMACKnownAnswer hmacKnownAnswers[] =
+{
+    { "\x0b\x0b\x0b\x0b\x0b\x0b\x0b\x0b\x0b\x0b\x0b\x0b\x0b\x0b\x0b\x0b\x0b\x0b\x0b\x0b", 20,
+      "Hi There", 8,
+      "b0344c61d8db38535ca8afceaf0bf12b881dc200c9833da726e9376c2e32cff7",
+      "87aa7cdea5ef619d4ff0b4241a1d6cb02379f4e2ce4ec2787ad0b30545e17cdedaa833b7d6b8a702038b274eaea3f4e4be9d914eeb61f1702e696c203a126854" },
+    { "Jefe", 4,
+      "what do ya want for nothing?", 28,
+      "5bdcc146bf60754e6a042426089575c75a003f089d2739839dec58b964ec3843",
+      "164b7a7bfcf819e2e395fbe73b56e0a387bd64222e831fd610270cd7ea2505549758bf75c05a994a6d034f65f8f0e6fdcaeab1a34d4a6b4b636e070a38bce737" },
+    { "\xaa\xaa\xaa\xaa\xaa\xaa\xaa\xaa\xaa\xaa\xaa\xaa\xaa\xaa\xaa\xaa\xaa\xaa\xaa\xaa", 20,
+      "\xdd\xdd\xdd\xdd\xdd\xdd\xdd\xdd\xdd\xdd\xdd\xdd\xdd\xdd\xdd\xdd\xdd\xdd\xdd\xdd\xdd\xdd\xdd\xdd\xdd"
+      "\xdd\xdd\xdd\xdd\xdd\xdd\xdd\xdd\xdd\xdd\xdd\xdd\xdd\xdd\xdd\xdd\xdd\xdd\xdd\xdd\xdd\xdd\xdd\xdd\xdd", 50,
+      "773ea91e36800e46854db8ebd09181a72959098b3ef8c122d9635514ced565fe",
+      "fa73b0089d56a284efb0f0756c890be9b1b5dbdd8ee81a3655f83e33b2279d39bf3e848279a722c806b485a47e67c807b946a337bee8942674278859e13292fb" },
+    { "\x01\x02\x03\x04\x05\x06\x07\x08\x09\x0a\x0b\x0c\x0d\x0e\x0f\x10\x11\x12\x13\x14\x15\x16\x17\x18\x19", 25,
+      "\xcd\xcd\xcd\xcd\xcd\xcd\xcd\xcd\xcd\xcd\xcd\xcd\xcd\xcd\xcd\xcd\xcd\xcd\xcd\xcd\xcd\xcd\xcd\xcd\xcd"
+      "\xcd\xcd\xcd\xcd\xcd\xcd\xcd\xcd\xcd\xcd\xcd\xcd\xcd\xcd\xcd\xcd\xcd\xcd\xcd\xcd\xcd\xcd\xcd\xcd\xcd", 50,
+      "82558a389a443c0ea4cc819899f2083a85f0faa3e578f8077a2e3ff46729665b",
+      "b0ba465637458c6990e5a8c5f61d4af7e576d97ff94b872de76f8050361ee3dba91ca5c11aa25eb4d679275cc5788063a5f19741120c4f2de2adebeb10a298dd" },
+    { "\xaa\xaa\xaa\xaa\xaa\xaa\xaa\xaa\xaa\xaa\xaa\xaa\xaa\xaa\xaa\xaa\xaa\xaa\xaa\xaa\xaa\xaa\xaa\xaa\xaa"
+      "\xaa\xaa\xaa\xaa\xaa\xaa\xaa\xaa\xaa\xaa\xaa\xaa\xaa\xaa\xaa\xaa\xaa\xaa\xaa\xaa\xaa\xaa\xaa\xaa\xaa"
+      "\xaa\xaa\xaa\xaa\xaa\xaa\xaa\xaa\xaa\xaa\xaa\xaa\xaa\xaa\xaa\xaa\xaa\xaa\xaa\xaa\xaa\xaa\xaa\xaa\xaa"
+      "\xaa\xaa\xaa\xaa\xaa\xaa\xaa\xaa\xaa\xaa\xaa\xaa\xaa\xaa\xaa\xaa\xaa\xaa\xaa\xaa\xaa\xaa\xaa\xaa\xaa"
+      "\xaa\xaa\xaa\xaa\xaa\xaa\xaa\xaa\xaa\xaa\xaa\xaa\xaa\xaa\xaa\xaa\xaa\xaa\xaa\xaa\xaa\xaa\xaa\xaa\xaa"
+      "\xaa\xaa\xaa\xaa\xaa\xaa", 131,
+      "Test Using Larger Than Block-Size Key - Hash Key First", 54,
+      "60e431591ee0b67f0d8a26aacbf5b77f8e0bc6213728c5140546040f0ee37f54",
+      "80b24263c7c1a3ebb71493c1dd7be8b49b46d1f41b4aeec1121b013783f8f3526b56d037e05f2598bd0fd2215d6a1e5295e64f73f63f0aec8b915a985d786598" },
+    { "\xaa\xaa\xaa\xaa\xaa\xaa\xaa\xaa\xaa\xaa\xaa\xaa\xaa\xaa\xaa\xaa\xaa\xaa\xaa\xaa\xaa\xaa\xaa\xaa\xaa"
+      "\xaa\xaa\xaa\xaa\xaa\xaa\xaa\xaa\xaa\xaa\xaa\xaa\xaa\xaa\xaa\xaa\xaa\xaa\xaa\xaa\xaa\xaa\xaa\xaa\xaa"
+      "\xaa\xaa\xaa\xaa\xaa\xaa\xaa\xaa\xaa\xaa\xaa\xaa\xaa\xaa\xaa\xaa\xaa\xaa\xaa\xaa\xaa\xaa\xaa\xaa\xaa"
+      "\xaa\xaa\xaa\xaa\xaa\xaa\xaa\xaa\xaa\xaa\xaa\xaa\xaa\xaa\xaa\xaa\xaa\xaa\xaa\xaa\xaa\xaa\xaa\xaa\xaa"
+      "\xaa\xaa\xaa\xaa\xaa\xaa\xaa\xaa\xaa\xaa\xaa\xaa\xaa\xaa\xaa\xaa\xaa\xaa\xaa\xaa\xaa\xaa\xaa\xaa\xaa"
+      "\xaa\xaa\xaa\xaa\xaa\xaa", 131,
+      "This is a test using a larger than block-size key and a larger than block-size data. The key needs t"
+      "o be hashed before being used by the HMAC algorithm.", 152,
+      "9b09ffa71b942fcb27635fbcd5b0e944bfdc63644f0713938a7f51535c3a35e2",
+      "e37b6a775dc87dbaa4dfa9f96e5e3ffddebd71f8867289865df5a32d20cdc944b6022cac3c4982b10d5eeb55c3e4de15134676fb6de0446065c97440fa8c6a58" },
+};
+
+#define NUM_HMAC_KNOWN_ANSWERS (sizeof(hmacKnownAnswers) / sizeof(hmacKnownAnswers[0]))
+
+static void testHMACKnownAnswers(void)
+{
+    const uint8_t *msgs[NUM_HMAC_KNOWN_ANSWERS];
+    size_t lens[NUM_HMAC_KNOWN_ANSWERS];
+    uint8_t digest[SHA512_HASH_SIZE];
+    uint8_t out256[NUM_HMAC_KNOWN_ANSWERS][SHA256_HASH_SIZE], out512[NUM_HMAC_KNOWN_ANSWERS][SHA512_HASH_SIZE];
+
+    for (size_t i = 0; i < NUM_HMAC_KNOWN_ANSWERS; ++i)
+    {
+        const HMACKnownAnswer *t = &hmacKnownAnswers[i];
+        const uint8_t *msg = (const uint8_t*)t->msg;
+        HMACSHA256Key key256;
+        HMACSHA512Key key512;
+        HMACSHA256SetKey(&key256, (const uint8_t*)t->key, t->keyLen);
+        HMACSHA512SetKey(&key512, (const uint8_t*)t->key, t->keyLen);
+
+        HMACSHA256HashInto(&key256, msg, t->msgLen, digest);
+        checkHex("HMACSHA256HashInto", t->msgLen, digest, t->sha256, SHA256_HASH_SIZE);
+        HMACSHA512HashInto(&key512, msg, t->msgLen, digest);
+        checkHex("HMACSHA512HashInto", t->msgLen, digest, t->sha512, SHA512_HASH_SIZE);
+
+        // the same key repeated in every lane
+        for (size_t j = 0; j < NUM_HMAC_KNOWN_ANSWERS; ++j)
+        {
+            msgs[j] = msg;
+            lens[j] = t->msgLen;
+        }
+        HMACSHA256HashMany(&key256, msgs, lens, NUM_HMAC_KNOWN_ANSWERS, out256);
+        HMACSHA512HashMany(&key512, msgs, lens, NUM_HMAC_KNOWN_ANSWERS, out512);
+        for (size_t j = 0; j < NUM_HMAC_KNOWN_ANSWERS; ++j)
+        {
+            checkHex("HMACSHA256HashMany", t->msgLen, out256[j], t->sha256, SHA256_HASH_SIZE);
+            checkHex("HMACSHA512HashMany", t->msgLen, out512[j], t->sha512, SHA512_HASH_SIZE);
+        }
+    }
+}
+
+typedef struct PBKDF2KnownAnswer {
+    const char *password;
+    const char *salt;
+    uint32_t iterations;
+    size_t outLen;
+    const char *sha256;
+    const char *sha512;
+} PBKDF2KnownAnswer;
+
+// RFC 7914 section 11 (PBKDF2-HMAC-SHA256) and RFC 6070 style parameters; the SHA-512 values and the
+// longer outputs were computed with Python's hashlib.pbkdf2_hmac
+static const PBKDF2KnownAnswer pbkdf2KnownAnswers[] =
+{
+    { "passwd", "salt", 1, 64,
+      "55ac046e56e3089fec1691c22544b605f94185216dde0465e68b9d57c20dacbc49ca9cccf179b645991664b39d77ef317c71b845b1e30bd509112041d3a19783",
+      "c74319d99499fc3e9013acff597c23c5baf0a0bec5634c46b8352b793e324723d55caa76b2b25c43402dcfdc06cdcf66f95b7d0429420b39520006749c51a04e" },
+    { "Password", "NaCl", 80000, 64,
+      "4ddcd8f60b98be21830cee5ef22701f9641a4418d04c0414aeff08876b34ab56a1d425a1225833549adb841b51c9b3176a272bdebba1d078478f62b397f33c8d",
+      "e6337d6fbeb645c794d4a9b5b75b7b30dac9ac50376a91df1f4460f6060d5addb2c1fd1f84409abacc67de7eb4056e6bb06c2d82c3ef4ccd1bded0f675ed97c6" },
+    { "password", "salt", 4096, 20,
+      "c5e478d59288c841aa530db6845c4c8d962893a0",
+      "d197b1b33db0143e018b12f3d1d1479e6cdebdcc" },
+    { "passwordPASSWORDpassword", "saltSALTsaltSALTsaltSALTsaltSALTsalt", 4096, 150,
+      "348c89dbcbd32b2f32d814b8116e84cf2b17347ebc1800181c4e2a1fb8dd53e1c635518c7dac47e94561f2686056e5fcd3989bf8960bb2a36c90340586c4faca"
+      "44d5627a75ce351154b9ff85e6f1950073b04e662b211e3b88841e20c8060dc2e78b4ae03a337e274be0a3f4274aa61a9eef2a91cd076b5611eef3f30f89d14b"
+      "5caee300bb7146375ac102f843c79e99b9bc51553c27",
+      "8c0511f4c6e597c6ac6315d8f0362e225f3c501495ba23b868c005174dc4ee71115b59f9e60cd9532fa33e0f75aefe30225c583a186cd82bd4daea9724a3d3b8"
+      "04f75bdd41494fa324cab24bcc680fb3b96a30cf5d21fac3c2875913919f3399b1d9ce7eb54c95ba49118596cf7465719bbe02c4ecab1b1541298c321d13c6f6"
+      "d414c28163b051a1d313cec13a76ebdbba624eb2c742" },
+};
+
+// Compares a derived key of any length against its hex encoding, one digest sized piece at a time
+static void checkKeyHex(const char *what, const uint8_t *got, const char *expectedHex, size_t len)
+{
+    for (size_t offset = 0; offset < len; offset += SHA512_HASH_SIZE)
+    {
+        size_t n = (len - offset < SHA512_HASH_SIZE) ? len - offset : SHA512_HASH_SIZE;
+        checkHex(what, len, &got[offset], &expectedHex[2 * offset], n);
+    }
+}
+
+static void testPBKDF2(void)
+{
+    uint8_t out[PBKDF2_MAX_OUT];
+    ThreadPool *pool = ThreadPoolCreate(4);
+
+    for (size_t i = 0; i < sizeof(pbkdf2KnownAnswers) / sizeof(pbkdf2KnownAnswers[0]); ++i)
+    {
+        const PBKDF2KnownAnswer *t = &pbkdf2KnownAnswers[i];
+        const uint8_t *password = (const uint8_t*)t->password;
+        const uint8_t *salt = (const uint8_t*)t->salt;
+
+        PBKDF2HMACSHA256(password, strlen(t->password), salt, strlen(t->salt), t->iterations, NULL, out, t->outLen);
+        checkKeyHex("PBKDF2HMACSHA256", out, t->sha256, t->outLen);
+        PBKDF2HMACSHA256(password, strlen(t->password), salt, strlen(t->salt), t->iterations, pool, out, t->outLen);
+        checkKeyHex("PBKDF2HMACSHA256 threaded", out, t->sha256, t->outLen);
+
+        PBKDF2HMACSHA512(password, strlen(t->password), salt, strlen(t->salt), t->iterations, NULL, out, t->outLen);
+        checkKeyHex("PBKDF2HMACSHA512", out, t->sha512, t->outLen);
+        PBKDF2HMACSHA512(password, strlen(t->password), salt, strlen(t->salt), t->iterations, pool, out, t->outLen);
+        checkKeyHex("PBKDF2HMACSHA512 threaded", out, t->sha512, t->outLen);
+    }
+
+    ++numChecks;
+    if (PBKDF2HMACSHA256((const uint8_t*)"p", 1, (const uint8_t*)"s", 1, 0, NULL, out, 32) ||
+        PBKDF2HMACSHA512((const uint8_t*)"p", 1, (const uint8_t*)"s", 1, 0, NULL, out, 64))
+    {
+        printf("FAILED PBKDF2 accepted 0 iterations\n");
+        ++numFailures;
+    }
+    ThreadPoolDestroy(pool);
+}
+
+// Returns a random length, biased towards the block and padding boundaries where bugs tend to hide
+static size_t randomLength(size_t max)
+{
+    if (rng() & 1)
+    {
+        size_t blocks = rngBelow(max / SHA512_MESSAGE_BLOCK_SIZE + 1);
+        size_t edge[] = { 0, 1, 55, 56, 63, 64, 65, 111, 112, 119, 127, 128, 129 };
+        size_t len = blocks * SHA512_MESSAGE_BLOCK_SIZE + edge[rngBelow(sizeof(edge) / sizeof(edge[0]))];
+        return (len > max) ? max : len;
+    }
+    return rngBelow(max + 1);
+}
+
+static void fillRandom(uint8_t *buf, size_t len)
+{
+    for (size_t i = 0; i < len; ++i)
+        buf[i] = (uint8_t)rng();
+}
+
+// One message through every single message path
+static void fuzzOne(const uint8_t *msg, size_t len)
+{
+    uint8_t expected512[SHA512_HASH_SIZE], expected256[SHA256_HASH_SIZE];
+    uint8_t digest512[SHA512_HASH_SIZE], digest256[SHA256_HASH_SIZE];
+    referenceSHA512(msg, len, expected512);
+    referenceSHA256(msg, len, expected256);
+
+    SHA512HashInto(msg, len, digest512);
+    check("SHA512HashInto", len, digest512, expected512, SHA512_HASH_SIZE);
+
+    uint64_t *words512 = SHA512Hash((uint8_t*)msg, len);
+    for (int i = 0; i < HASH_ARRAY_LEN; ++i)
+        storeBigEndian64(&digest512[i * 8], words512[i]);
+    free(words512);
+    check("SHA512Hash", len, digest512, expected512, SHA512_HASH_SIZE);
+
+    SHA256Engine defaultEngine = SHA256GetEngine();
+    for (int e = 0; e < SHA256_ENGINE_COUNT; ++e)
+    {
+        if (!SHA256SetEngine((SHA256Engine)e))
+            continue;
+        SHA256HashInto(msg, len, digest256);
+        check(SHA256EngineName((SHA256Engine)e), len, digest256, expected256, SHA256_HASH_SIZE);
+    }
+    SHA256SetEngine(defaultEngine);
+
+    uint32_t *words256 = SHA256Hash((uint8_t*)msg, len);
+    for (int i = 0; i < SHA256_ARRAY_LEN; ++i)
+        storeBigEndian32(&digest256[i * 4], words256[i]);
+    free(words256);
+    check("SHA256Hash", len, digest256, expected256, SHA256_HASH_SIZE);
+
+    // streaming, split at random points
+    SHA512Context ctx512;
+    SHA256Context ctx256;
+    SHADualContext dual;
+    SHA512Init(&ctx512);
+    SHA256Init(&ctx256);
+    SHADualInit(&dual);
+    for (size_t offset = 0; offset < len; )
+    {
+        size_t n = rngBelow(len - offset + 1);
+        if (rng() & 1)
+            n = rngBelow(n + 1);
+        SHA512Update(&ctx512, &msg[offset], n);
+        SHA256Update(&ctx256, &msg[offset], n);
+        SHADualUpdate(&dual, &msg[offset], n);
+        offset += n;
+    }
+    SHA512Final(&ctx512, digest512);
+    check("SHA512Update", len, digest512, expected512, SHA512_HASH_SIZE);
+    SHA256Final(&ctx256, digest256);
+    check("SHA256Update", len, digest256, expected256, SHA256_HASH_SIZE);
+    SHADualFinal(&dual, digest512, digest256);
+    check("SHADualUpdate 512", len, digest512, expected512, SHA512_HASH_SIZE);
+    check("SHADualUpdate 256", len, digest256, expected256, SHA256_HASH_SIZE);
+
+    SHADualHashInto(msg, len, digest512, digest256);
+    check("SHADualHashInto 512", len, digest512, expected512, SHA512_HASH_SIZE);
+    check("SHADualHashInto 256", len, digest256, expected256, SHA256_HASH_SIZE);
+}
+
+// A ragged batch of messages through the multi-buffer paths
+static void fuzzMany(uint8_t *buf)
+{
+    const uint8_t *msgs[FUZZ_MAX_BATCH] = {0};
+    size_t lens[FUZZ_MAX_BATCH] = {0};
+    uint8_t out512[FUZZ_MAX_BATCH][SHA512_HASH_SIZE], out256[FUZZ_MAX_BATCH][SHA256_HASH_SIZE];
+    uint8_t expected[SHA512_HASH_SIZE];
+
+    size_t n = rngBelow(FUZZ_MAX_BATCH + 1);
+    for (size_t i = 0; i < n; ++i)
+    {
+        // lengths differ widely within a batch, so lanes finish at different times
+        lens[i] = randomLength((rng() & 3) ? 300 : FUZZ_MAX_LEN);
+        msgs[i] = &buf[rngBelow(FUZZ_MAX_LEN - lens[i] + 1)];
+    }
+
+    SHA512HashMany(msgs, lens, n, out512);
+    SHA256HashMany(msgs, lens, n, out256);
+    for (size_t i = 0; i < n; ++i)
+    {
+        referenceSHA512(msgs[i], lens[i], expected);
+        check("SHA512HashMany", lens[i], out512[i], expected, SHA512_HASH_SIZE);
+        referenceSHA256(msgs[i], lens[i], expected);
+        check("SHA256HashMany", lens[i], out256[i], expected, SHA256_HASH_SIZE);
+    }
+}
+
+// The fixed size paths: 64 byte messages and SHA256d, single and batched, with every engine
+static void fuzzFixed(uint8_t *buf)
+{
+    const uint8_t *msgs[FUZZ_MAX_BATCH];
+    size_t lens[FUZZ_MAX_BATCH];
+    uint8_t out[FUZZ_MAX_BATCH][SHA256_HASH_SIZE];
+    uint8_t expected[SHA256_HASH_SIZE], digest[SHA256_HASH_SIZE];
+
+    size_t n = rngBelow(FUZZ_MAX_BATCH + 1);
+    const uint8_t (*pairs)[SHA256_MESSAGE_BLOCK_SIZE] = (const uint8_t (*)[SHA256_MESSAGE_BLOCK_SIZE])buf;
+    // every message is 64 bytes in half of the batches, which takes the SHA256Hash64 kernels for the first hash
+    int all64 = rng() & 1;
+    for (size_t i = 0; i < n; ++i)
+    {
+        lens[i] = all64 ? SHA256_MESSAGE_BLOCK_SIZE : randomLength(300);
+        msgs[i] = &buf[rngBelow(FUZZ_MAX_LEN - lens[i] + 1)];
+    }
+
+    SHA256Engine defaultEngine = SHA256GetEngine();
+    for (int e = 0; e < SHA256_ENGINE_COUNT; ++e)
+    {
+        if (!SHA256SetEngine((SHA256Engine)e))
+            continue;
+
+        SHA256Hash64Many(pairs, n, out);
+        for (size_t i = 0; i < n; ++i)
+        {
+            referenceSHA256(pairs[i], SHA256_MESSAGE_BLOCK_SIZE, expected);
+            check("SHA256Hash64Many", SHA256_MESSAGE_BLOCK_SIZE, out[i], expected, SHA256_HASH_SIZE);
+            SHA256Hash64Into(pairs[i], digest);
+            check("SHA256Hash64Into", SHA256_MESSAGE_BLOCK_SIZE, digest, expected, SHA256_HASH_SIZE);
+        }
+
+        SHA256dHashMany(msgs, lens, n, out);
+        for (size_t i = 0; i < n; ++i)
+        {
+            referenceSHA256(msgs[i], lens[i], digest);
+            referenceSHA256(digest, SHA256_HASH_SIZE, expected);
+            check("SHA256dHashMany", lens[i], out[i], expected, SHA256_HASH_SIZE);
+            SHA256dHashInto(msgs[i], lens[i], digest);
+            check("SHA256dHashInto", lens[i], digest, expected, SHA256_HASH_SIZE);
+        }
+    }
+    SHA256SetEngine(defaultEngine);
+}
+
+// Messages sharing a block aligned prefix, finished from saved midstates
+static void fuzzMidstate(const uint8_t *buf)
+{
+    const uint8_t *suffixes[FUZZ_MAX_BATCH];
+    size_t lens[FUZZ_MAX_BATCH];
+    uint8_t out512[FUZZ_MAX_BATCH][SHA512_HASH_SIZE], out256[FUZZ_MAX_BATCH][SHA256_HASH_SIZE];
+    uint8_t expected[SHA512_HASH_SIZE], digest[SHA512_HASH_SIZE];
+    uint8_t *msg = (uint8_t*) malloc(2 * FUZZ_MAX_LEN);
+
+    // a multiple of both block sizes, so the same prefix serves both algorithms
+    size_t prefixLen = rngBelow(4) * SHA512_MESSAGE_BLOCK_SIZE;
+    SHA512Midstate mid512, ctxMid512;
+    SHA256Midstate mid256, ctxMid256;
+    SHA512MidstateInit(&mid512, buf, prefixLen);
+    SHA256MidstateInit(&mid256, buf, prefixLen);
+
+    // the same midstates, snapshot from streaming contexts
+    SHA512Context ctx512;
+    SHA256Context ctx256;
+    SHA512Init(&ctx512);
+    SHA256Init(&ctx256);
+    SHA512Update(&ctx512, buf, prefixLen);
+    SHA256Update(&ctx256, buf, prefixLen);
+    ++numChecks;
+    if (!SHA512GetMidstate(&ctx512, &ctxMid512) || !SHA256GetMidstate(&ctx256, &ctxMid256))
+    {
+        printf("FAILED GetMidstate (len %zu)\n", prefixLen);
+        ++numFailures;
+    }
+
+    size_t n = rngBelow(FUZZ_MAX_BATCH + 1);
+    for (size_t i = 0; i < n; ++i)
+    {
+        lens[i] = randomLength((rng() & 3) ? 300 : FUZZ_MAX_LEN / 2);
+        suffixes[i] = &buf[rngBelow(FUZZ_MAX_LEN - lens[i] + 1)];
+    }
+    SHA512MidstateHashMany(&mid512, suffixes, lens, n, out512);
+    SHA256MidstateHashMany(&mid256, suffixes, lens, n, out256);
+
+    for (size_t i = 0; i < n; ++i)
+    {
+        memcpy(msg, buf, prefixLen);
+        memcpy(&msg[prefixLen], suffixes[i], lens[i]);
+        size_t len = prefixLen + lens[i];
+
+        referenceSHA512(msg, len, expected);
+        check("SHA512MidstateHashMany", len, out512[i], expected, SHA512_HASH_SIZE);
+        SHA512MidstateHashInto(&ctxMid512, suffixes[i], lens[i], digest);
+        check("SHA512MidstateHashInto", len, digest, expected, SHA512_HASH_SIZE);
+
+        referenceSHA256(msg, len, expected);
+        check("SHA256MidstateHashMany", len, out256[i], expected, SHA256_HASH_SIZE);
+        SHA256MidstateHashInto(&ctxMid256, suffixes[i], lens[i], digest);
+        check("SHA256MidstateHashInto", len, digest, expected, SHA256_HASH_SIZE);
+    }
+
+    // unaligned prefixes have no midstate
+    ++numChecks;
+    if (SHA512MidstateInit(&mid512, buf, prefixLen + 1) || SHA256MidstateInit(&mid256, buf, prefixLen + 1))
+    {
+        printf("FAILED MidstateInit accepted an unaligned prefix (len %zu)\n", prefixLen + 1);
+        ++numFailures;
+    }
+    free(msg);
+}
+
+// HMAC from its definition, H((K ^ opad) || H((K ^ ipad) || msg)), on top of the reference hashes
+static void referenceHMAC(size_t hashSize, const uint8_t *secret, size_t keyLen, const uint8_t *msg, size_t len, uint8_t *out)
+{
+    size_t blockSize = (hashSize == SHA512_HASH_SIZE) ? SHA512_MESSAGE_BLOCK_SIZE : SHA256_MESSAGE_BLOCK_SIZE;
+    void (*hash)(const uint8_t*, size_t, uint8_t*) = (hashSize == SHA512_HASH_SIZE) ? referenceSHA512 : referenceSHA256;
+    uint8_t key[SHA512_MESSAGE_BLOCK_SIZE] = { 0 };
+    uint8_t inner[SHA512_HASH_SIZE];
+    uint8_t *buf = (uint8_t*) malloc(blockSize + (len > hashSize ? len : hashSize));
+
+    if (keyLen > blockSize)
+        hash(secret, keyLen, key);
+    else
+        memcpy(key, secret, keyLen);
+
+    for (size_t i = 0; i < blockSize; ++i)
+        buf[i] = key[i] ^ HMAC_IPAD;
+    memcpy(&buf[blockSize], msg, len);
+    hash(buf, blockSize + len, inner);
+
+    for (size_t i = 0; i < blockSize; ++i)
+        buf[i] = key[i] ^ HMAC_OPAD;
+    memcpy(&buf[blockSize], inner, hashSize);
+    hash(buf, blockSize + hashSize, out);
+    free(buf);
+}
+
+// Random keys and messages through every HMAC entry point
+static void fuzzHMAC(const uint8_t *buf)
+{
+    const uint8_t *msgs[FUZZ_MAX_BATCH];
+    size_t lens[FUZZ_MAX_BATCH];
+    uint8_t out256[FUZZ_MAX_BATCH][SHA256_HASH_SIZE], out512[FUZZ_MAX_BATCH][SHA512_HASH_SIZE];
+    uint8_t expected[SHA512_HASH_SIZE], digest[SHA512_HASH_SIZE];
+
+    size_t keyLen = rngBelow(300);
+    const uint8_t *secret = &buf[rngBelow(FUZZ_MAX_LEN - keyLen)];
+    HMACSHA256Key key256;
+    HMACSHA512Key key512;
+    HMACSHA256SetKey(&key256, secret, keyLen);
+    HMACSHA512SetKey(&key512, secret, keyLen);
+
+    size_t n = rngBelow(FUZZ_MAX_BATCH + 1);
+    for (size_t i = 0; i < n; ++i)
+    {
+        lens[i] = randomLength((rng() & 3) ? 300 : FUZZ_MAX_LEN);
+        msgs[i] = &buf[rngBelow(FUZZ_MAX_LEN - lens[i] + 1)];
+    }
+    HMACSHA256HashMany(&key256, msgs, lens, n, out256);
+    HMACSHA512HashMany(&key512, msgs, lens, n, out512);
+
+    for (size_t i = 0; i < n; ++i)
+    {
+        referenceHMAC(SHA256_HASH_SIZE, secret, keyLen, msgs[i], lens[i], expected);
+        check("HMACSHA256HashMany", lens[i], out256[i], expected, SHA256_HASH_SIZE);
+        HMACSHA256HashInto(&key256, msgs[i], lens[i], digest);
+        check("HMACSHA256HashInto", lens[i], digest, expected, SHA256_HASH_SIZE);
+
+        HMACSHA256Context ctx256;
+        size_t split = rngBelow(lens[i] + 1);
+        HMACSHA256Init(&ctx256, &key256);
+        HMACSHA256Update(&ctx256, msgs[i], split);
+        HMACSHA256Update(&ctx256, &msgs[i][split], lens[i] - split);
+        HMACSHA256Final(&ctx256, digest);
+        check("HMACSHA256Update", lens[i], digest, expected, SHA256_HASH_SIZE);
+
+        referenceHMAC(SHA512_HASH_SIZE, secret, keyLen, msgs[i], lens[i], expected);
+        check("HMACSHA512HashMany", lens[i], out512[i], expected, SHA512_HASH_SIZE);
+        HMACSHA512HashInto(&key512, msgs[i], lens[i], digest);
+        check("HMACSHA512HashInto", lens[i], digest, expected, SHA512_HASH_SIZE);
+
+        HMACSHA512Context ctx512;
+        HMACSHA512Init(&ctx512, &key512);
+        HMACSHA512Update(&ctx512, msgs[i], split);
+        HMACSHA512Update(&ctx512, &msgs[i][split], lens[i] - split);
+        HMACSHA512Final(&ctx512, digest);
+        check("HMACSHA512Update", lens[i], digest, expected, SHA512_HASH_SIZE);
+    }
+
+    HMACSHA256ClearKey(&key256);
+    HMACSHA512ClearKey(&key512);
+}
+
+// One message through pooled hashers of every algorithm, split at random points
+static void fuzzHasher(const uint8_t *buf)
+{
+    uint8_t expected[SHA512_HASH_SIZE];
+    size_t len = randomLength(FUZZ_MAX_LEN);
+
+    for (int a = 0; a < SHA_ALGORITHM_COUNT; ++a)
+    {
+        SHAAlgorithm algorithm = (SHAAlgorithm)a;
+        size_t hashSize = SHAAlgorithmHashSize(algorithm);
+        if (algorithm == SHA_ALGORITHM_SHA256)
+            referenceSHA256(buf, len, expected);
+        else if (algorithm == SHA_ALGORITHM_SHA512)
+            referenceSHA512(buf, len, expected);
+        else
+            SHAHashInto(algorithm, buf, len, expected);
+
+        // the first message leaves stale input behind, which Reset must discard
+        SHAHasher *hasher = SHAHasherAcquire(algorithm);
+        SHAHasherUpdate(hasher, buf, rngBelow(len + 1));
+        SHAHasherReset(hasher);
+        for (size_t offset = 0; offset < len; )
+        {
+            size_t n = rngBelow(len - offset + 1);
+            SHAHasherUpdate(hasher, &buf[offset], n);
+            offset += n;
+        }
+        check(SHAAlgorithmName(algorithm), len, SHAHasherFinal(hasher), expected, hashSize);
+
+        // Final leaves the hasher ready for the next message
+        SHAHasherUpdate(hasher, buf, len);
+        check("SHAHasher reuse", len, SHAHasherFinal(hasher), expected, hashSize);
+        SHAHasherRelease(hasher);
+    }
+}
+
+// Tree root computed directly from the definition in TreeHash.h, on top of the reference hashes
+static void referenceTree(const uint8_t *data, size_t len, size_t leafSize, size_t hashSize, uint8_t *out)
+{
+    size_t count = (len == 0) ? 1 : (len - 1) / leafSize + 1;
+    uint8_t *level = (uint8_t*) malloc(count * hashSize);
+    uint8_t *msg = (uint8_t*) malloc(1 + (leafSize > 2 * hashSize ? leafSize : 2 * hashSize));
+
+    for (size_t i = 0; i < count; ++i)
+    {
+        size_t n = (len - i * leafSize < leafSize) ? len - i * leafSize : leafSize;
+        if (len == 0)
+            n = 0;
+        msg[0] = TREE_HASH_LEAF_PREFIX;
+        memcpy(&msg[1], &data[i * leafSize], n);
+        if (hashSize == SHA512_HASH_SIZE)
+            referenceSHA512(msg, n + 1, &level[i * hashSize]);
+        else
+            referenceSHA256(msg, n + 1, &level[i * hashSize]);
+    }
+
+    while (count > 1)
+    {
+        size_t parents = 0;
+        for (size_t i = 0; i < count; i += 2, ++parents)
+        {
+            if (i + 1 == count)
+            {
+                memmove(&level[parents * hashSize], &level[i * hashSize], hashSize);
+                continue;
+            }
+            msg[0] = TREE_HASH_NODE_PREFIX;
+            memcpy(&msg[1], &level[i * hashSize], 2 * hashSize);
+            if (hashSize == SHA512_HASH_SIZE)
+                referenceSHA512(msg, 1 + 2 * hashSize, &level[parents * hashSize]);
+            else
+                referenceSHA256(msg, 1 + 2 * hashSize, &level[parents * hashSize]);
+        }
+        count = parents;
+    }
+
+    memcpy(out, level, hashSize);
+    free(level);
+    free(msg);
+}
+
+static void fuzzTree(const uint8_t *buf, ThreadPool *pool)
+{
+    uint8_t expected[SHA512_HASH_SIZE], digest[SHA512_HASH_SIZE];
+    size_t len = randomLength(FUZZ_MAX_LEN);
+    size_t leafSize = 1 + rngBelow(600);
+
+    referenceTree(buf, len, leafSize, SHA256_HASH_SIZE, expected);
+    SHA256TreeHash(buf, len, leafSize, NULL, digest);
+    check("SHA256TreeHash", len, digest, expected, SHA256_HASH_SIZE);
+    SHA256TreeHash(buf, len, leafSize, pool, digest);
+    check("SHA256TreeHash threaded", len, digest, expected, SHA256_HASH_SIZE);
+
+    referenceTree(buf, len, leafSize, SHA512_HASH_SIZE, expected);
+    SHA512TreeHash(buf, len, leafSize, NULL, digest);
+    check("SHA512TreeHash", len, digest, expected, SHA512_HASH_SIZE);
+    SHA512TreeHash(buf, len, leafSize, pool, digest);
+    check("SHA512TreeHash threaded", len, digest, expected, SHA512_HASH_SIZE);
+}
+
+// Builds, edits and proves one random tree per algorithm, checking the root against SHAxxxTreeHash of the
+// edited data after every update
+static void fuzzMerkle(const uint8_t *buf, ThreadPool *pool)
+{
+    uint8_t expected[SHA512_HASH_SIZE], proof[MERKLE_TREE_MAX_LEVELS * SHA512_HASH_SIZE];
+    uint8_t *data = (uint8_t*) malloc(FUZZ_MAX_LEN);
+    size_t len = randomLength(FUZZ_MAX_LEN);
+    size_t leafSize = 1 + rngBelow(300);
+
+    for (int a = 0; a < 2; ++a)
+    {
+        SHAAlgorithm algorithm = a ? SHA_ALGORITHM_SHA512 : SHA_ALGORITHM_SHA256;
+        size_t hashSize = SHAAlgorithmHashSize(algorithm);
+        memcpy(data, buf, len);
+
+        MerkleTree *tree = MerkleTreeBuild(algorithm, data, len, leafSize, (rng() & 1) ? pool : NULL, NULL);
+        size_t numLeaves = MerkleTreeNumLeaves(tree);
+        for (int update = 0; update < 4; ++update)
+        {
+            if (a)
+                SHA512TreeHash(data, len, leafSize, NULL, expected);
+            else
+                SHA256TreeHash(data, len, leafSize, NULL, expected);
+            check("MerkleTreeRoot", len, MerkleTreeRoot(tree), expected, hashSize);
+
+            size_t index = rngBelow(numLeaves);
+            size_t offset = index * leafSize;
+            size_t chunkLen = (len - offset < leafSize) ? len - offset : leafSize;
+            fillRandom(&data[offset], chunkLen);
+            MerkleTreeUpdate(tree, index, &data[offset], chunkLen);
+        }
+
+        for (int p = 0; p < 4; ++p)
+        {
+            size_t index = rngBelow(numLeaves), proofLen;
+            MerkleTreeProve(tree, index, proof, &proofLen);
+            const uint8_t *leaf = MerkleTreeLeaf(tree, index);
+            const uint8_t *root = MerkleTreeRoot(tree);
+
+            ++numChecks;
+            int valid = MerkleTreeVerify(algorithm, numLeaves, index, leaf, proof, proofLen, root);
+            int tampered = 0;
+            if (proofLen > 0)
+            {
+                proof[rngBelow(proofLen)] ^= 0x01;
+                tampered = MerkleTreeVerify(algorithm, numLeaves, index, leaf, proof, proofLen, root);
+            }
+            if (!valid || tampered)
+            {
+                ++numFailures;
+                printf("FAIL MerkleTreeVerify of leaf %zu of %zu: valid %d, tampered %d\n", index, numLeaves,
+                       valid, tampered);
+            }
+        }
+        MerkleTreeClose(tree);
+    }
+    free(data);
+}
+
+static void testDifferential(void)
+{
+    uint8_t *buf = (uint8_t*) malloc(FUZZ_MAX_LEN);
+    ThreadPool *pool = ThreadPoolCreate(4);
+
+    for (int i = 0; i < FUZZ_ITERATIONS; ++i)
+    {
+        fillRandom(buf, FUZZ_MAX_LEN);
+        fuzzOne(buf, randomLength(FUZZ_MAX_LEN));
+        if (i % 8 == 0)
+            fuzzMany(buf);
+        if (i % 8 == 4)
+            fuzzMidstate(buf);
+        if (i % 8 == 6)
+            fuzzHMAC(buf);
+        if (i % 8 == 2)
+            fuzzHasher(buf);
+        if (i % 8 == 3)
+            fuzzFixed(buf);
+        if (i % 32 == 0)
+            fuzzTree(buf, pool);
+        if (i % 32 == 16)
+            fuzzMerkle(buf, pool);
+    }
+
+    ThreadPoolDestroy(pool);
+    free(buf);
+}
+
+// Shared state of testHasherPool; task i hashes a prefix of msg with a hasher from its thread's pool
+typedef struct HasherJob {
+    const uint8_t *msg;
+    uint8_t (*out)[SHA512_HASH_SIZE];
+} HasherJob;
+
+static void hasherTask(void *arg, size_t i)
+{
+    const HasherJob *job = (const HasherJob*)arg;
+    SHAAlgorithm algorithm = (SHAAlgorithm)(i % SHA_ALGORITHM_COUNT);
+    SHAHasher *hasher = SHAHasherAcquire(algorithm);
+    SHAHasherUpdate(hasher, job->msg, i * 7);
+    memcpy(job->out[i], SHAHasherFinal(hasher), SHAAlgorithmHashSize(algorithm));
+    SHAHasherRelease(hasher);
+}
+
+static void testHasherPool(void)
+{
+    uint8_t msg[HASHER_TASKS * 7];
+    uint8_t (*out)[SHA512_HASH_SIZE] = malloc(HASHER_TASKS * sizeof(*out));
+    uint8_t expected[SHA512_HASH_SIZE];
+    fillRandom(msg, sizeof(msg));
+
+    // a released hasher is handed out again by the same thread
+    SHAHasher *first = SHAHasherAcquire(SHA_ALGORITHM_SHA512);
+    SHAHasherRelease(first);
+    SHAHasher *second = SHAHasherAcquire(SHA_ALGORITHM_SHA256);
+    ++numChecks;
+    if (first != second)
+    {
+        ++numFailures;
+        printf("FAIL SHAHasherAcquire did not reuse the released hasher\n");
+    }
+    SHAHasherRelease(second);
+
+    HasherJob job;
+    job.msg = msg;
+    job.out = out;
+    ThreadPool *pool = ThreadPoolCreate(4);
+    for (int round = 0; round < 4; ++round)
+    {
+        ThreadPoolRun(pool, HASHER_TASKS, hasherTask, &job);
+        for (size_t i = 0; i < HASHER_TASKS; ++i)
+        {
+            SHAAlgorithm algorithm = (SHAAlgorithm)(i % SHA_ALGORITHM_COUNT);
+            SHAHashInto(algorithm, msg, i * 7, expected);
+            check("SHAHasherAcquire threaded", i * 7, out[i], expected, SHAAlgorithmHashSize(algorithm));
+        }
+    }
+    ThreadPoolDestroy(pool);
+    free(out);
+}
+
+static atomic_int asyncCallbacks;
+
+static void asyncCallback(void *tag, const uint8_t *digest)
+{
+    (void)tag;
+    (void)digest;
+    atomic_fetch_add(&asyncCallbacks, 1);
+}
+
+// Jobs of every algorithm through the async engine, half reaped from the completion ring and half
+// finished by callbacks, with a ring small enough that submissions regularly find it full
+static void testAsync(void)
+{
+    uint8_t *msg = (uint8_t*) malloc(FUZZ_MAX_LEN);
+    uint8_t (*out)[SHA512_HASH_SIZE] = malloc(ASYNC_JOBS * sizeof(*out));
+    size_t *lens = (size_t*) malloc(ASYNC_JOBS * sizeof(size_t));
+    char *reaped = (char*) calloc(ASYNC_JOBS, 1);
+    void *tags[64];
+    uint8_t expected[SHA512_HASH_SIZE];
+    size_t numReaped = 0, numCallbacks = 0;
+    fillRandom(msg, FUZZ_MAX_LEN);
+
+    SHAAsync *engine = SHAAsyncCreate(3, 64, 0, 50);
+    for (size_t i = 0; i < ASYNC_JOBS; ++i)
+    {
+        SHAAlgorithm algorithm = (SHAAlgorithm)(i % SHA_ALGORITHM_COUNT);
+        int useCallback = (i / SHA_ALGORITHM_COUNT) % 2;
+        lens[i] = randomLength(FUZZ_MAX_LEN);
+        numCallbacks += useCallback;
+        while (!SHAAsyncSubmit(engine, msg, lens[i], algorithm, out[i], useCallback ? asyncCallback : NULL,
+                               (void*)i))
+        {
+            size_t n = SHAAsyncReap(engine, tags, 64, 1);
+            for (size_t k = 0; k < n; ++k)
+                reaped[(size_t)tags[k]] = 1;
+            numReaped += n;
+        }
+    }
+    while (numReaped < ASYNC_JOBS - numCallbacks)
+    {
+        size_t n = SHAAsyncReap(engine, tags, 64, 1);
+        for (size_t k = 0; k < n; ++k)
+            reaped[(size_t)tags[k]] = 1;
+        numReaped += n;
+    }
+    SHAAsyncDestroy(engine);
+
+    ++numChecks;
+    if ((size_t)atomic_load(&asyncCallbacks) != numCallbacks)
+    {
+        ++numFailures;
+        printf("FAIL SHAAsync ran %d callbacks, expected %zu\n", atomic_load(&asyncCallbacks), numCallbacks);
+    }
+    for (size_t i = 0; i < ASYNC_JOBS; ++i)
+    {
+        SHAAlgorithm algorithm = (SHAAlgorithm)(i % SHA_ALGORITHM_COUNT);
+        int useCallback = (i / SHA_ALGORITHM_COUNT) % 2;
+        SHAHashInto(algorithm, msg, lens[i], expected);
+        check(SHAAlgorithmName(algorithm), lens[i], out[i], expected, SHAAlgorithmHashSize(algorithm));
+        ++numChecks;
+        if (!useCallback && !reaped[i])
+        {
+            ++numFailures;
+            printf("FAIL SHAAsync job %zu was never reaped\n", i);
+        }
+    }
+
+    free(reaped);
+    free(lens);
+    free(out);
+    free(msg);
+}
+
+// A file backed tree keeps its updates across close and reopen
+static void testMerkleFile(void)
+{
+    char path[] = "/tmp/sha_test_merkle_XXXXXX";
+    int fd = mkstemp(path);
+    uint8_t data[1000], expected[SHA256_HASH_SIZE];
+    fillRandom(data, sizeof(data));
+
+    MerkleTree *tree = (fd >= 0) ? MerkleTreeBuild(SHA_ALGORITHM_SHA256, data, sizeof(data), 64, NULL, path) : NULL;
+    if (fd >= 0)
+        close(fd);
+    ++numChecks;
+    if (tree == NULL)
+    {
+        ++numFailures;
+        printf("FAIL MerkleTreeBuild could not create %s\n", path);
+        return;
+    }
+    fillRandom(&data[128], 64);
+    MerkleTreeUpdate(tree, 2, &data[128], 64);
+    MerkleTreeSync(tree);
+    MerkleTreeClose(tree);
+
+    tree = MerkleTreeOpen(path);
+    ++numChecks;
+    if (tree == NULL || MerkleTreeNumLeaves(tree) != 16 || MerkleTreeLeafSize(tree) != 64)
+    {
+        ++numFailures;
+        printf("FAIL MerkleTreeOpen did not restore the tree\n");
+        MerkleTreeClose(tree);
+        unlink(path);
+        return;
+    }
+    SHA256TreeHash(data, sizeof(data), 64, NULL, expected);
+    check("MerkleTreeOpen", sizeof(data), MerkleTreeRoot(tree), expected, SHA256_HASH_SIZE);
+
+    // the last chunk may be short, but no other one
+    ++numChecks;
+    if (MerkleTreeUpdate(tree, 3, data, 10) || !MerkleTreeUpdate(tree, 15, &data[960], 40) ||
+        MerkleTreeUpdate(tree, 16, data, 64))
+    {
+        ++numFailures;
+        printf("FAIL MerkleTreeUpdate accepted a chunk of the wrong length or index\n");
+    }
+    MerkleTreeClose(tree);
+    unlink(path);
+}
+
+// Chunks seen by collectChunk
+typedef struct ChunkList {
+    CDCChunk chunks[512];
+    size_t count;
+} ChunkList;
+
+static void collectChunk(void *arg, const CDCChunk *chunk)
+{
+    ChunkList *list = (ChunkList*)arg;
+    if (list->count < sizeof(list->chunks) / sizeof(list->chunks[0]))
+        list->chunks[list->count] = *chunk;
+    ++list->count;
+}
+
+// Chunks a stream with a repeated section, whole and fed in random pieces: the chunks must tile the stream,
+// respect the size limits, carry the SHA-256 of their bytes, not depend on the piece boundaries, and the
+// chunks of the repeated section must be reported as duplicates
+static void testCDC(void)
+{
+    size_t len = 64 << 10;
+    uint8_t *data = (uint8_t*) malloc(len);
+    uint8_t expected[SHA256_HASH_SIZE];
+    ChunkList *whole = (ChunkList*) calloc(1, sizeof(ChunkList));
+    ChunkList *pieces = (ChunkList*) calloc(1, sizeof(ChunkList));
+    fillRandom(data, len);
+    memcpy(&data[40 << 10], &data[8 << 10], 16 << 10);
+
+    DedupIndex *index = DedupIndexCreate(0);
+    CDCChunker *chunker = CDCChunkerCreate(256, 1024, 4096, index, collectChunk, whole);
+    CDCChunkerUpdate(chunker, data, len);
+    CDCChunkerFinal(chunker);
+    CDCChunkerDestroy(chunker);
+
+    chunker = CDCChunkerCreate(256, 1024, 4096, NULL, collectChunk, pieces);
+    for (size_t offset = 0; offset < len; )
+    {
+        size_t n = rngBelow(len - offset < 3000 ? len - offset + 1 : 3000);
+        CDCChunkerUpdate(chunker, &data[offset], n);
+        offset += n;
+    }
+    CDCChunkerFinal(chunker);
+    CDCChunkerDestroy(chunker);
+
+    ++numChecks;
+    if (whole->count != pieces->count || whole->count > sizeof(whole->chunks) / sizeof(whole->chunks[0]))
+    {
+        ++numFailures;
+        printf("FAIL CDCChunker found %zu chunks whole and %zu in pieces\n", whole->count, pieces->count);
+        whole->count = 0;
+    }
+
+    size_t offset = 0, duplicateBytes = 0;
+    for (size_t i = 0; i < whole->count; ++i)
+    {
+        const CDCChunk *chunk = &whole->chunks[i];
+        SHA256HashInto(&data[chunk->offset], chunk->len, expected);
+        check("CDCChunker", chunk->len, chunk->digest, expected, SHA256_HASH_SIZE);
+        check("CDCChunker pieces", chunk->len, pieces->chunks[i].digest, expected, SHA256_HASH_SIZE);
+
+        ++numChecks;
+        int last = (i + 1 == whole->count);
+        if (chunk->offset != offset || pieces->chunks[i].offset != offset || chunk->len > 4096 ||
+            (!last && chunk->len < 256))
+        {
+            ++numFailures;
+            printf("FAIL CDCChunker chunk %zu at %llu of %zu bytes\n", i, (unsigned long long)chunk->offset, chunk->len);
+        }
+        if (chunk->duplicate)
+        {
+            duplicateBytes += chunk->len;
+            ++numChecks;
+            if (memcmp(&data[chunk->firstOffset], &data[chunk->offset], chunk->len) != 0)
+            {
+                ++numFailures;
+                printf("FAIL CDCChunker duplicate at %llu differs from its original\n", (unsigned long long)chunk->offset);
+            }
+        }
+        offset += chunk->len;
+    }
+
+    // all of the copy but the chunks straddling its ends dedups
+    ++numChecks;
+    if (offset != len || duplicateBytes < (16 << 10) - 2 * 4096 || DedupIndexCount(index) + 1 > whole->count)
+    {
+        ++numFailures;
+        printf("FAIL CDCChunker covered %zu bytes with %zu duplicate bytes\n", offset, duplicateBytes);
+    }
+
+    DedupIndexDestroy(index);
+    free(pieces);
+    free(whole);
+    free(data);
+}
+
+static void checkCount(const char *what, SHAStatsPath path, uint64_t got, uint64_t expected)
+{
+    ++numChecks;
+    if (got != expected)
+    {
+        ++numFailures;
+        printf("FAIL %s of %s: got %llu, expected %llu\n", what, SHAStatsPathName(path),
+               (unsigned long long)got, (unsigned long long)expected);
+    }
+}
+
+static void statsTask(void *arg, size_t i)
+{
+    uint8_t digest[SHA512_HASH_SIZE];
+    SHA512HashInto((const uint8_t*)arg, i, digest);
+}
+
+static void testStats(void)
+{
+    uint8_t msg[1000];
+    uint8_t digest[SHA512_HASH_SIZE];
+    SHAStatsSnapshot snapshot;
+    fillRandom(msg, sizeof(msg));
+
+    SHAStatsReset();
+    SHA256HashInto(msg, 1000, digest);
+    SHA256dHashInto(msg, 100, digest);
+    SHA256Hash64Into(msg, digest);
+    SHA384HashInto(msg, 300, digest);
+    PaddedMsg padded = preprocess(msg, 200);
+    free(getHash(&padded));
+
+    // the pool's threads have exited by the time it is destroyed, so their counters are retired
+    ThreadPool *pool = ThreadPoolCreate(2);
+    ThreadPoolRun(pool, STATS_TASKS, statsTask, msg);
+    ThreadPoolDestroy(pool);
+
+    SHAStatsGetSnapshot(&snapshot);
+    if (!SHAStatsEnabled())
+    {
+        for (int p = 0; p < SHA_STATS_PATH_COUNT; ++p)
+            checkCount("calls without SHA_STATS", (SHAStatsPath)p, snapshot.paths[p].calls, 0);
+        return;
+    }
+
+    // the SHA256dHashInto call also hashes its 100 byte message with SHA256HashInto
+    const SHAStatsCounters *sha256 = &snapshot.paths[SHA_STATS_SHA256];
+    checkCount("calls", SHA_STATS_SHA256, sha256->calls, 2);
+    checkCount("bytes", SHA_STATS_SHA256, sha256->bytes, 1100);
+    checkCount("blocks", SHA_STATS_SHA256, sha256->blocks, 18);
+    checkCount("calls", SHA_STATS_SHA256D, snapshot.paths[SHA_STATS_SHA256D].calls, 1);
+    checkCount("blocks", SHA_STATS_SHA256D, snapshot.paths[SHA_STATS_SHA256D].blocks, 3);
+    checkCount("calls", SHA_STATS_SHA256_HASH64, snapshot.paths[SHA_STATS_SHA256_HASH64].calls, 1);
+    checkCount("bytes", SHA_STATS_SHA256_HASH64, snapshot.paths[SHA_STATS_SHA256_HASH64].bytes, 64);
+    // the padding blocks of SHA256Hash64Into are precomputed schedules, not engine calls
+    SHAStatsPath engine = (SHAStatsPath)(SHA_STATS_SHA256_SCALAR + SHA256GetEngine());
+    checkCount("calls", engine, snapshot.paths[engine].calls, 6);
+    checkCount("blocks", engine, snapshot.paths[engine].blocks, 20);
+
+    checkCount("calls", SHA_STATS_SHA384, snapshot.paths[SHA_STATS_SHA384].calls, 1);
+    checkCount("blocks", SHA_STATS_SHA384, snapshot.paths[SHA_STATS_SHA384].blocks, 3);
+    checkCount("calls", SHA_STATS_PREPROCESS, snapshot.paths[SHA_STATS_PREPROCESS].calls, 1);
+    checkCount("blocks", SHA_STATS_PREPROCESS, snapshot.paths[SHA_STATS_PREPROCESS].blocks, 2);
+    checkCount("bytes", SHA_STATS_GET_HASH, snapshot.paths[SHA_STATS_GET_HASH].bytes, 256);
+    checkCount("calls", SHA_STATS_SHA512, snapshot.paths[SHA_STATS_SHA512].calls, STATS_TASKS);
+
+    uint64_t blocks512 = 0;
+    for (size_t i = 0; i < STATS_TASKS; ++i)
+        blocks512 += (i + 16) / SHA512_MESSAGE_BLOCK_SIZE + 1;
+    checkCount("blocks", SHA_STATS_SHA512_BLOCKS, snapshot.paths[SHA_STATS_SHA512_BLOCKS].blocks, blocks512 + 3);
+
+    // only calls made outside any other path are timed, and the block functions never are
+    for (int p = 0; p < SHA_STATS_PATH_COUNT; ++p)
+    {
+        uint64_t bucketed = 0, timed = snapshot.paths[p].calls;
+        for (int i = 0; i < SHA_STATS_LATENCY_BUCKETS; ++i)
+            bucketed += snapshot.paths[p].latency[i];
+        if (p == SHA_STATS_SHA256)
+            timed = 1;
+        else if ((p >= SHA_STATS_SHA256_SCALAR && p <= SHA_STATS_SHA512_BLOCKS) || p == SHA_STATS_BYTE_SWAP)
+            timed = 0;
+        checkCount("latency histogram", (SHAStatsPath)p, bucketed, timed);
+    }
+
+    SHAStatsReset();
+    SHAStatsGetSnapshot(&snapshot);
+    for (int p = 0; p < SHA_STATS_PATH_COUNT; ++p)
+        checkCount("calls after SHAStatsReset", (SHAStatsPath)p, snapshot.paths[p].calls, 0);
+}
+
+int main(int argc, char **argv)
+{
+    if (argc > 1)
+        rngState = strtoull(argv[1], NULL, 0) | 1;
+    printf("seed 0x%llx, default SHA-256 engine %s\n", (unsigned long long)rngState, SHA256EngineName(SHA256GetEngine()));
+
+    testKnownAnswers();
+    testVariants();
+    testMonteCarlo();
+    testHMACKnownAnswers();
+    testPBKDF2();
+    testHasherPool();
+    testAsync();
+    testMerkleFile();
+    testCDC();
+    testStats();
+    testDifferential();
+
+    printf("%d checks, %d failed\n", numChecks, numFailures);
+    return numFailures == 0 ? 0 : 1;
+}